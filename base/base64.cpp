@@ -0,0 +1,298 @@
+/**
+ * @file base64.cpp
+ * @author lc
+ * @brief Implementation of the vectorized base64 encoder/decoder
+ * @see base64.h
+ *
+ * The SIMD encoders follow the well known pshufb approach: each 12 byte group is shuffled so that every
+ * 32-bit lane holds one 3 byte triplet, the four 6-bit indices are isolated with two multiplies, and the
+ * indices are mapped to ASCII by adding a per-range offset looked up with pshufb.
+ *
+ * @version 0.1
+ * @date 2024-03-06
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "base64.h"
+
+#include <cstdint>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define XP_BASE64_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define XP_TARGET(x)
+#else
+#define XP_TARGET(x) __attribute__((target(x)))
+#endif
+#endif
+
+namespace XPlaneChatBot {
+namespace Base {
+
+namespace {
+
+const char base64_chars[] =
+"ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+"abcdefghijklmnopqrstuvwxyz"
+"0123456789+/";
+
+/// @brief Reverse lookup table: 0..63 for valid characters, 0xff otherwise
+struct DecodeTable {
+    uint8_t values[256];
+    DecodeTable() {
+        for (int i = 0; i < 256; ++i) {
+            values[i] = 0xff;
+        }
+        for (uint8_t i = 0; i < 64; ++i) {
+            values[static_cast<uint8_t>(base64_chars[i])] = i;
+        }
+    }
+};
+
+const DecodeTable decode_table;
+
+/// @brief Encode the trailing (or whole) input one triplet at a time; handles padding
+size_t encode_scalar(const uint8_t* src, size_t len, char* out) {
+    char* dst = out;
+    size_t i = 0;
+    for (; i + 3 <= len; i += 3) {
+        const uint32_t triplet = (uint32_t(src[i]) << 16) | (uint32_t(src[i + 1]) << 8) | src[i + 2];
+        dst[0] = base64_chars[(triplet >> 18) & 0x3f];
+        dst[1] = base64_chars[(triplet >> 12) & 0x3f];
+        dst[2] = base64_chars[(triplet >> 6) & 0x3f];
+        dst[3] = base64_chars[triplet & 0x3f];
+        dst += 4;
+    }
+
+    const size_t remaining = len - i;
+    if (remaining) {
+        uint32_t triplet = uint32_t(src[i]) << 16;
+        if (remaining == 2) {
+            triplet |= uint32_t(src[i + 1]) << 8;
+        }
+        dst[0] = base64_chars[(triplet >> 18) & 0x3f];
+        dst[1] = base64_chars[(triplet >> 12) & 0x3f];
+        dst[2] = remaining == 2 ? base64_chars[(triplet >> 6) & 0x3f] : '=';
+        dst[3] = '=';
+        dst += 4;
+    }
+    return static_cast<size_t>(dst - out);
+}
+
+#ifdef XP_BASE64_X86
+
+XP_TARGET("ssse3")
+inline __m128i encode_block_ssse3(__m128i in) {
+    // Spread the 12 input bytes so each 32-bit lane holds one triplet as [b1 b0 b2 b1]
+    in = _mm_shuffle_epi8(in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+    // Isolate the four 6-bit indices of every triplet
+    const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    const __m128i indices = _mm_or_si128(t1, t3);
+
+    // Map the indices to ASCII: reduce them to a range id, then add the range's offset
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    const __m128i is_upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    range = _mm_or_si128(range, _mm_and_si128(is_upper, _mm_set1_epi8(13)));
+    const __m128i offsets = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+}
+
+XP_TARGET("ssse3")
+size_t encode_ssse3(const uint8_t* src, size_t len, char* out) {
+    char* dst = out;
+    // Each step consumes 12 bytes but loads 16, so stop while 16 are still readable
+    while (len >= 16) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), encode_block_ssse3(in));
+        src += 12;
+        len -= 12;
+        dst += 16;
+    }
+    return static_cast<size_t>(dst - out) + encode_scalar(src, len, dst);
+}
+
+XP_TARGET("avx2")
+size_t encode_avx2(const uint8_t* src, size_t len, char* out) {
+    char* dst = out;
+    // Each step consumes 24 bytes; the upper lane loads 16 bytes starting at +12
+    while (len >= 28) {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 12));
+        __m256i in = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+        in = _mm256_shuffle_epi8(in, _mm256_set_epi8(
+            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+            10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+
+        const __m256i t0 = _mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00));
+        const __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        const __m256i t2 = _mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0));
+        const __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        const __m256i indices = _mm256_or_si256(t1, t3);
+
+        __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        const __m256i is_upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        range = _mm256_or_si256(range, _mm256_and_si256(is_upper, _mm256_set1_epi8(13)));
+        const __m256i offsets = _mm256_setr_epi8(
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+        const __m256i result = _mm256_add_epi8(_mm256_shuffle_epi8(offsets, range), indices);
+
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), result);
+        src += 24;
+        len -= 24;
+        dst += 32;
+    }
+    return static_cast<size_t>(dst - out) + encode_ssse3(src, len, dst);
+}
+
+bool cpu_has_avx2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false; // The OS does not save the YMM registers
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+bool cpu_has_ssse3() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+#endif // XP_BASE64_X86
+
+using EncodeFunc = size_t(*)(const uint8_t*, size_t, char*);
+
+struct Encoder {
+    EncodeFunc func{ &encode_scalar };
+    const char* name{ "scalar" };
+    Encoder() {
+#ifdef XP_BASE64_X86
+        if (cpu_has_avx2()) {
+            func = &encode_avx2;
+            name = "avx2";
+        }
+        else if (cpu_has_ssse3()) {
+            func = &encode_ssse3;
+            name = "ssse3";
+        }
+#endif
+    }
+};
+
+const Encoder& encoder() {
+    static const Encoder instance; // CPU detection runs once, thread-safe
+    return instance;
+}
+
+} // namespace
+
+size_t base64_encode_into(const void* data, size_t len, char* out) {
+    return encoder().func(static_cast<const uint8_t*>(data), len, out);
+}
+
+void base64_encode_into(const void* data, size_t len, std::string& out) {
+    out.resize(base64_encoded_length(len));
+    if (len) {
+        base64_encode_into(data, len, &out[0]);
+    }
+}
+
+bool base64_decode_into(const char* in, size_t len, void* out, size_t& out_len) {
+    out_len = 0;
+    if (len % 4 != 0) {
+        return false;
+    }
+    if (len == 0) {
+        return true;
+    }
+
+    size_t padding = 0;
+    if (in[len - 1] == '=') {
+        padding = (in[len - 2] == '=') ? 2 : 1;
+    }
+
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(in);
+    uint8_t* dst = static_cast<uint8_t*>(out);
+    const size_t full = len - (padding ? 4 : 0);
+
+    for (size_t i = 0; i < full; i += 4) {
+        const uint8_t a = decode_table.values[src[i]];
+        const uint8_t b = decode_table.values[src[i + 1]];
+        const uint8_t c = decode_table.values[src[i + 2]];
+        const uint8_t d = decode_table.values[src[i + 3]];
+        if ((a | b | c | d) & 0x80) {
+            return false;
+        }
+        const uint32_t triplet = (uint32_t(a) << 18) | (uint32_t(b) << 12) | (uint32_t(c) << 6) | d;
+        dst[0] = static_cast<uint8_t>(triplet >> 16);
+        dst[1] = static_cast<uint8_t>(triplet >> 8);
+        dst[2] = static_cast<uint8_t>(triplet);
+        dst += 3;
+    }
+
+    if (padding) {
+        const uint8_t* last = src + full;
+        const uint8_t a = decode_table.values[last[0]];
+        const uint8_t b = decode_table.values[last[1]];
+        const uint8_t c = padding == 1 ? decode_table.values[last[2]] : 0;
+        if ((a | b | c) & 0x80) {
+            return false;
+        }
+        const uint32_t triplet = (uint32_t(a) << 18) | (uint32_t(b) << 12) | (uint32_t(c) << 6);
+        *dst++ = static_cast<uint8_t>(triplet >> 16);
+        if (padding == 1) {
+            *dst++ = static_cast<uint8_t>(triplet >> 8);
+        }
+    }
+
+    out_len = static_cast<size_t>(dst - static_cast<uint8_t*>(out));
+    return true;
+}
+
+bool base64_decode_into(const char* in, size_t len, std::vector<char>& out) {
+    out.resize(base64_decoded_max_length(len));
+    size_t written = 0;
+    if (!base64_decode_into(in, len, out.data(), written)) {
+        out.clear();
+        return false;
+    }
+    out.resize(written);
+    return true;
+}
+
+const char* base64_implementation() {
+    return encoder().name;
+}
+
+} // namespace Base
+} // namespace XPlaneChatBot
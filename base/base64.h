@@ -0,0 +1,61 @@
+/**
+ * @file base64.h
+ * @author lc
+ * @brief Vectorized base64 encoder/decoder that writes into caller-owned buffers
+ *
+ * Encoding picks the widest implementation the CPU supports at runtime (AVX2, SSSE3 or scalar).
+ * All implementations produce byte-identical output to the scalar reference.
+ *
+ * @version 0.1
+ * @date 2024-03-06
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_BASE_BASE64_H
+#define XPROTECTION_BASE_BASE64_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace XPlaneChatBot {
+namespace Base {
+
+/// @brief Number of characters (including padding) needed to encode len bytes
+constexpr size_t base64_encoded_length(size_t len) { return ((len + 2) / 3) * 4; }
+
+/// @brief Upper bound on the number of bytes produced by decoding len characters
+constexpr size_t base64_decoded_max_length(size_t len) { return (len / 4) * 3 + 3; }
+
+/**
+ * @brief Encode len bytes into out, which must have room for base64_encoded_length(len) characters
+ * @return Number of characters written (no terminating null is written)
+ */
+size_t base64_encode_into(const void* data, size_t len, char* out);
+
+/**
+ * @brief Encode len bytes into out, reusing its capacity (out is resized, not reallocated if large enough)
+ */
+void base64_encode_into(const void* data, size_t len, std::string& out);
+
+/**
+ * @brief Decode len characters into out, which must have room for base64_decoded_max_length(len) bytes
+ * @param out_len Set to the number of bytes written
+ * @return False if the input is not valid padded base64
+ */
+bool base64_decode_into(const char* in, size_t len, void* out, size_t& out_len);
+
+/**
+ * @brief Decode len characters into out, reusing its capacity
+ * @return False if the input is not valid padded base64 (out is left empty)
+ */
+bool base64_decode_into(const char* in, size_t len, std::vector<char>& out);
+
+/// @brief Name of the encoder selected for this CPU ("avx2", "ssse3" or "scalar")
+const char* base64_implementation();
+
+} // namespace Base
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_BASE_BASE64_H
@@ -0,0 +1,111 @@
+/**
+ * @file boundedqueue.h
+ * @author lc
+ * @brief Blocking bounded multi-producer/multi-consumer queue used to connect long-lived pipeline stages
+ *
+ * push() blocks while the queue is full, so a slow stage throttles the stages feeding it instead of letting
+ * work pile up. close() wakes everybody: producers fail from then on and consumers drain what is left.
+ *
+ * @version 0.1
+ * @date 2024-04-29
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_BASE_BOUNDEDQUEUE_H
+#define XPROTECTION_BASE_BOUNDEDQUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace XPlaneChatBot {
+namespace Base {
+
+/// @brief Bounded blocking queue (thread-safe)
+template <typename T>
+class BoundedQueue {
+public:
+    /// @param capacity Maximum number of queued elements (at least 1)
+    explicit BoundedQueue(size_t capacity)
+        : m_capacity(capacity > 0 ? capacity : 1)
+    {}
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /// @brief Wait for room and append value; returns false if the queue is closed
+    bool push(T value) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [this] { return m_closed || m_items.size() < m_capacity; });
+        if (m_closed) {
+            return false;
+        }
+        m_items.push_back(std::move(value));
+        lock.unlock();
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    /// @brief Wait for an element; returns std::nullopt once the queue is closed and drained
+    std::optional<T> pop() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [this] { return m_closed || !m_items.empty(); });
+        if (m_items.empty()) {
+            return std::nullopt;
+        }
+        T value = std::move(m_items.front());
+        m_items.pop_front();
+        lock.unlock();
+        m_notFull.notify_one();
+        return value;
+    }
+
+    /// @brief Stop accepting elements and wake all waiting threads
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+        }
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+
+    /// @brief Drop everything queued (the queue stays open)
+    void clear() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_items.clear();
+        }
+        m_notFull.notify_all();
+    }
+
+    /// @brief Number of queued elements (snapshot)
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_items.size();
+    }
+
+    size_t capacity() const { return m_capacity; }
+
+    bool closed() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_closed;
+    }
+
+private:
+    const size_t m_capacity;
+    std::deque<T> m_items;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+    bool m_closed{ false };
+};
+
+} // namespace Base
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_BASE_BOUNDEDQUEUE_H
@@ -0,0 +1,85 @@
+/**
+ * @file cancellation.h
+ * @author lc
+ * @brief Cancellation token shared by everything working on behalf of one request
+ *
+ * The owner calls cancel(); workers either poll isCancelled() at convenient points or register a callback with
+ * onCancel() to interrupt a blocking wait. Cancellation is one-way: a cancelled token stays cancelled.
+ *
+ * @version 0.1
+ * @date 2024-06-17
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_BASE_CANCELLATION_H
+#define XPROTECTION_BASE_CANCELLATION_H
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace XPlaneChatBot {
+namespace Base {
+
+/// @brief One-shot cancellation flag with callbacks (thread-safe)
+class CancellationToken {
+public:
+    using Callback = std::function<void()>;
+
+    CancellationToken() = default;
+    CancellationToken(const CancellationToken&) = delete;
+    CancellationToken& operator=(const CancellationToken&) = delete;
+
+    /// @brief Set the flag and run the registered callbacks on the calling thread (only the first call does anything)
+    void cancel() {
+        std::vector<Callback> callbacks;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_cancelled.exchange(true)) {
+                return;
+            }
+            callbacks.swap(m_callbacks);
+        }
+        for (Callback& callback : callbacks) {
+            callback();
+        }
+    }
+
+    bool isCancelled() const { return m_cancelled.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Run callback when the token is cancelled, or right away if it already is
+     *
+     * Callbacks are kept until the token is cancelled or destroyed, so they must stay harmless if whatever they
+     * interrupt has finished in the meantime (capture weak pointers or ids rather than raw pointers).
+     */
+    void onCancel(Callback callback) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_cancelled.load()) {
+                m_callbacks.push_back(std::move(callback));
+                return;
+            }
+        }
+        callback();
+    }
+
+private:
+    std::atomic<bool> m_cancelled{ false };
+    std::mutex m_mutex;
+    std::vector<Callback> m_callbacks;
+};
+
+/// @brief True if token is set and cancelled (a null token never cancels)
+inline bool isCancelled(const std::shared_ptr<CancellationToken>& token) {
+    return token && token->isCancelled();
+}
+
+} // namespace Base
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_BASE_CANCELLATION_H
@@ -0,0 +1,371 @@
+/**
+ * @file coroutine.h
+ * @author lc
+ * @brief Minimal C++20 coroutine support: executors, a lazy Task and an async channel
+ *
+ * + Executor: where coroutines are resumed. ThreadPoolExecutor resumes them on its worker threads,
+ *   ManualExecutor resumes them when runPending() is called, e.g. from an X-Plane flight loop callback.
+ * + Task<T>: lazily started coroutine that can be co_awaited; spawn() runs one to completion on an executor.
+ * + AsyncChannel<T>: producers on any thread push values, one coroutine consumes them with co_await next().
+ *   The consumer is always resumed through its executor, never inline on the producer's thread.
+ *
+ * @version 0.1
+ * @date 2024-06-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_BASE_COROUTINE_H
+#define XPROTECTION_BASE_COROUTINE_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace XPlaneChatBot {
+namespace Base {
+
+/// @brief Resumes coroutines on some thread(s)
+class Executor {
+public:
+    virtual ~Executor() = default;
+
+    /// @brief Resume handle on one of the executor's threads (thread-safe)
+    virtual void schedule(std::coroutine_handle<> handle) = 0;
+
+    /// @brief co_await executor.switchTo() continues the coroutine on this executor
+    auto switchTo() {
+        struct Awaiter {
+            Executor& executor;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) { executor.schedule(handle); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{ *this };
+    }
+};
+
+/// @brief Executor drained explicitly by its owner (for instance once per flight loop)
+class ManualExecutor : public Executor {
+public:
+    void schedule(std::coroutine_handle<> handle) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ready.push_back(handle);
+    }
+
+    /// @brief Resume up to maxCount coroutines that were ready when called; returns how many were resumed
+    size_t runPending(size_t maxCount = std::numeric_limits<size_t>::max()) {
+        std::deque<std::coroutine_handle<>> ready;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const size_t count = std::min(maxCount, m_ready.size());
+            ready.assign(m_ready.begin(), m_ready.begin() + static_cast<std::ptrdiff_t>(count));
+            m_ready.erase(m_ready.begin(), m_ready.begin() + static_cast<std::ptrdiff_t>(count));
+        }
+        for (std::coroutine_handle<> handle : ready) {
+            handle.resume();
+        }
+        return ready.size();
+    }
+
+    size_t pending() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_ready.size();
+    }
+
+private:
+    mutable std::mutex m_mutex;
+    std::deque<std::coroutine_handle<>> m_ready;
+};
+
+/// @brief Executor with a fixed set of worker threads
+class ThreadPoolExecutor : public Executor {
+public:
+    explicit ThreadPoolExecutor(size_t threads = 1) {
+        for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) {
+            m_threads.emplace_back([this] { work(); });
+        }
+    }
+
+    /// @brief Joins the workers; coroutines still suspended at that point are not resumed
+    ~ThreadPoolExecutor() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    ThreadPoolExecutor(const ThreadPoolExecutor&) = delete;
+    ThreadPoolExecutor& operator=(const ThreadPoolExecutor&) = delete;
+
+    void schedule(std::coroutine_handle<> handle) override {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_ready.push_back(handle);
+        }
+        m_wake.notify_one();
+    }
+
+private:
+    void work() {
+        while (true) {
+            std::coroutine_handle<> handle;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [this] { return m_stopping || !m_ready.empty(); });
+                if (m_ready.empty()) {
+                    return;
+                }
+                handle = m_ready.front();
+                m_ready.pop_front();
+            }
+            handle.resume();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::coroutine_handle<>> m_ready;
+    bool m_stopping{ false };
+    std::vector<std::thread> m_threads;
+};
+
+
+template <typename T = void>
+class Task;
+
+namespace detail {
+
+struct TaskPromiseBase {
+    std::coroutine_handle<> continuation{ std::noop_coroutine() };
+    std::exception_ptr exception;
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+
+    /// @brief Hands control back to the awaiting coroutine (symmetric transfer, no stack growth)
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            return handle.promise().continuation;
+        }
+        void await_resume() const noexcept {}
+    };
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    void unhandled_exception() { exception = std::current_exception(); }
+};
+
+template <typename T>
+struct TaskPromise : TaskPromiseBase {
+    std::optional<T> value;
+
+    Task<T> get_return_object();
+    void return_value(T result) { value = std::move(result); }
+    T result() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+        return std::move(*value);
+    }
+};
+
+template <>
+struct TaskPromise<void> : TaskPromiseBase {
+    Task<void> get_return_object();
+    void return_void() {}
+    void result() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+} // namespace detail
+
+/// @brief Lazily started coroutine; runs when first co_awaited and resumes the awaiting coroutine when done
+template <typename T>
+class Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using Handle = std::coroutine_handle<promise_type>;
+
+    explicit Task(Handle handle) : m_handle(handle) {}
+    Task(Task&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+    Task& operator=(Task&& other) noexcept {
+        if (this != &other) {
+            if (m_handle) {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, {});
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return !m_handle || m_handle.done(); }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+        m_handle.promise().continuation = awaiting;
+        return m_handle;
+    }
+    T await_resume() { return m_handle.promise().result(); }
+
+private:
+    Handle m_handle;
+};
+
+namespace detail {
+
+template <typename T>
+Task<T> TaskPromise<T>::get_return_object() { return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this)); }
+
+inline Task<void> TaskPromise<void>::get_return_object() { return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this)); }
+
+/// @brief Fire-and-forget coroutine that frees itself when it finishes
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+} // namespace detail
+
+/**
+ * @brief Run task to completion on executor without waiting for it
+ * @param onDone Called when the task finishes, with the exception it threw (if any)
+ */
+inline detail::Detached spawn(Executor& executor, Task<void> task, std::function<void(std::exception_ptr)> onDone = {}) {
+    co_await executor.switchTo();
+    std::exception_ptr error;
+    try {
+        co_await task;
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+    if (onDone) {
+        onDone(error);
+    }
+}
+
+
+/**
+ * @brief Multi-producer, single-consumer channel awaited by a coroutine
+ *
+ * Values are queued without limit; the consumer is resumed through the executor given at construction.
+ */
+template <typename T>
+class AsyncChannel {
+public:
+    explicit AsyncChannel(Executor& executor) : m_executor(executor) {}
+
+    AsyncChannel(const AsyncChannel&) = delete;
+    AsyncChannel& operator=(const AsyncChannel&) = delete;
+
+    /// @brief Queue a value (any thread); returns false once the channel is closed
+    bool push(T value) {
+        std::coroutine_handle<> waiter;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_closed) {
+                return false;
+            }
+            m_values.push_back(std::move(value));
+            waiter = std::exchange(m_waiter, {});
+        }
+        if (waiter) {
+            m_executor.schedule(waiter);
+        }
+        return true;
+    }
+
+    /// @brief No more values will be pushed; the consumer drains the queue and then gets std::nullopt
+    void close() {
+        std::coroutine_handle<> waiter;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_closed = true;
+            waiter = std::exchange(m_waiter, {});
+        }
+        if (waiter) {
+            m_executor.schedule(waiter);
+        }
+    }
+
+    bool closed() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_closed;
+    }
+
+    /// @brief Values queued and not yet consumed
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_values.size();
+    }
+
+    /// @brief co_await next() gives the next value, or std::nullopt once the channel is closed and drained
+    auto next() {
+        struct Awaiter {
+            AsyncChannel& channel;
+            bool await_ready() const {
+                std::lock_guard<std::mutex> lock(channel.m_mutex);
+                return !channel.m_values.empty() || channel.m_closed;
+            }
+            bool await_suspend(std::coroutine_handle<> handle) {
+                std::lock_guard<std::mutex> lock(channel.m_mutex);
+                if (!channel.m_values.empty() || channel.m_closed) {
+                    return false; // Became ready in the meantime
+                }
+                channel.m_waiter = handle;
+                return true;
+            }
+            std::optional<T> await_resume() {
+                std::lock_guard<std::mutex> lock(channel.m_mutex);
+                if (channel.m_values.empty()) {
+                    return std::nullopt;
+                }
+                T value = std::move(channel.m_values.front());
+                channel.m_values.pop_front();
+                return value;
+            }
+        };
+        return Awaiter{ *this };
+    }
+
+private:
+    Executor& m_executor;
+    mutable std::mutex m_mutex;
+    std::deque<T> m_values;
+    std::coroutine_handle<> m_waiter;
+    bool m_closed{ false };
+};
+
+} // namespace Base
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_BASE_COROUTINE_H
@@ -0,0 +1,165 @@
+/**
+ * @file echocanceller.cpp
+ * @author lc
+ * @brief Implementation of the NLMS echo canceller
+ * @see echocanceller.h
+ * @version 0.1
+ * @date 2024-07-01
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "echocanceller.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define XP_ECHOCANCELLER_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace XPlaneChatBot {
+namespace Base {
+
+namespace {
+
+constexpr double kPowerSmoothing = 0.001; ///< ERLE power averaging, about 60 ms at 16 kHz
+constexpr double kRegularization = 1e-6; ///< Per tap, keeps the step bounded when the reference is quiet
+
+float dot(const float* a, const float* b, size_t n) {
+#ifdef XP_ECHOCANCELLER_SSE
+    // n is a multiple of 8: two independent accumulators hide the add latency
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (size_t i = 0; i < n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    acc0 = _mm_add_ps(acc0, acc1);
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, acc0);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+#endif
+}
+
+/// @brief y += alpha * x
+void axpy(float alpha, const float* x, float* y, size_t n) {
+#ifdef XP_ECHOCANCELLER_SSE
+    const __m128 scale = _mm_set1_ps(alpha);
+    for (size_t i = 0; i < n; i += 8) {
+        _mm_storeu_ps(y + i, _mm_add_ps(_mm_loadu_ps(y + i), _mm_mul_ps(scale, _mm_loadu_ps(x + i))));
+        _mm_storeu_ps(y + i + 4, _mm_add_ps(_mm_loadu_ps(y + i + 4), _mm_mul_ps(scale, _mm_loadu_ps(x + i + 4))));
+    }
+#else
+    for (size_t i = 0; i < n; ++i) {
+        y[i] += alpha * x[i];
+    }
+#endif
+}
+
+} // namespace
+
+
+EchoCanceller::EchoCanceller(int sampleRate, const EchoCancellerConfig& config)
+    : m_sampleRate(sampleRate)
+    , m_config(config)
+{
+    const size_t taps = static_cast<size_t>(std::max(m_config.filterMs, 1)) * static_cast<size_t>(sampleRate) / 1000;
+    m_taps = std::max<size_t>((taps + 7) / 8 * 8, 8);
+    m_delay = static_cast<size_t>(std::max(m_config.bulkDelayMs, 0)) * static_cast<size_t>(sampleRate) / 1000;
+    m_span = m_taps + m_delay;
+    m_holdSamples = std::max(m_config.doubleTalkHoldMs, 0) * sampleRate / 1000;
+    // The peak falls by 60 dB over the filter length, so it covers the echo tail
+    m_peakDecay = static_cast<float>(std::pow(10.0, -3.0 / static_cast<double>(m_taps)));
+    reset();
+}
+
+void EchoCanceller::reset() {
+    m_weights.assign(m_taps, 0.0f);
+    m_history.assign(m_span * 2, 0.0f);
+    m_write = 0;
+    m_windowEnergy = 0.0;
+    m_farPeak = 0.0f;
+    m_holdRemaining = 0;
+    m_farEndRun = 0;
+    m_micPower = 0.0;
+    m_errorPower = 0.0;
+    m_stats = EchoCancellerStats{};
+}
+
+void EchoCanceller::process(float* mic, const float* reference, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        mic[i] = processSample(mic[i], reference[i]);
+    }
+}
+
+void EchoCanceller::process(int16_t* mic, const int16_t* reference, size_t count) {
+    m_scratchMic.resize(count);
+    m_scratchReference.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        m_scratchMic[i] = static_cast<float>(mic[i]) / 32768.0f;
+        m_scratchReference[i] = static_cast<float>(reference[i]) / 32768.0f;
+    }
+    process(m_scratchMic.data(), m_scratchReference.data(), count);
+    for (size_t i = 0; i < count; ++i) {
+        const float scaled = std::round(m_scratchMic[i] * 32768.0f);
+        mic[i] = static_cast<int16_t>(std::clamp(scaled, -32768.0f, 32767.0f));
+    }
+}
+
+float EchoCanceller::processSample(float mic, float reference) {
+    // The window is the m_taps samples ending m_delay samples before the newest reference
+    m_write = m_write + 1 == m_span ? 0 : m_write + 1;
+    const float leaving = m_history[m_write]; // Oldest sample of the previous window
+    m_history[m_write] = reference;
+    m_history[m_write + m_span] = reference;
+    const float* window = m_history.data() + m_write + 1;
+    const float entering = window[m_taps - 1];
+    m_windowEnergy = std::max(0.0, m_windowEnergy + static_cast<double>(entering) * entering - static_cast<double>(leaving) * leaving);
+
+    ++m_stats.samples;
+    m_farPeak = std::max(std::fabs(entering), m_farPeak * m_peakDecay);
+    if (m_farPeak < m_config.farEndFloor) {
+        m_farEndRun = 0;
+        return mic; // Nothing is playing, nothing to cancel or learn from
+    }
+    ++m_stats.farEndSamples;
+    ++m_farEndRun;
+
+    const float error = mic - dot(m_weights.data(), window, m_taps);
+
+    // Geigel detector: a microphone peak the echo path cannot explain is the near end talking
+    if (std::fabs(mic) > m_config.doubleTalkThreshold * m_farPeak) {
+        m_holdRemaining = m_holdSamples;
+    }
+    if (m_holdRemaining > 0) {
+        --m_holdRemaining;
+        ++m_stats.doubleTalkSamples;
+    }
+    else {
+        const double norm = m_windowEnergy + kRegularization * static_cast<double>(m_taps);
+        axpy(static_cast<float>(m_config.stepSize * error / norm), window, m_weights.data(), m_taps);
+        m_micPower += kPowerSmoothing * (static_cast<double>(mic) * mic - m_micPower);
+        m_errorPower += kPowerSmoothing * (static_cast<double>(error) * error - m_errorPower);
+    }
+    return error;
+}
+
+EchoCancellerStats EchoCanceller::getStats() const {
+    EchoCancellerStats stats = m_stats;
+    if (m_errorPower > 0.0 && m_micPower > 0.0) {
+        stats.erleDb = 10.0 * std::log10(m_micPower / m_errorPower);
+    }
+    return stats;
+}
+
+} // namespace Base
+} // namespace XPlaneChatBot
@@ -0,0 +1,111 @@
+/**
+ * @file echocanceller.h
+ * @author lc
+ * @brief Acoustic echo canceller that removes the speaker signal from the microphone signal
+ *
+ * A normalized LMS adaptive filter (vectorized with SSE) models the path from the speaker to the microphone and
+ * subtracts its estimate of the echo from every captured sample. The reference is delayed by a fixed bulk delay
+ * (the stream latencies) so the taps only have to cover the room response. A Geigel double-talk detector freezes
+ * adaptation while the near end speaks, so the filter does not unlearn the echo path during a barge-in.
+ *
+ * The reference must be the exact signal sent to the speaker, sample-aligned with the capture (both sides of one
+ * full-duplex stream) and at the same rate. Only mono streams are supported.
+ *
+ * @version 0.1
+ * @date 2024-07-01
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_BASE_ECHOCANCELLER_H
+#define XPROTECTION_BASE_ECHOCANCELLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace XPlaneChatBot {
+namespace Base {
+
+/// @brief Tuning parameters of the echo canceller
+struct EchoCancellerConfig {
+    int filterMs{ 128 }; ///< Room response covered by the adaptive filter
+    int bulkDelayMs{ 0 }; ///< Reference delay ahead of the filter (output + input latency of the stream)
+    float stepSize{ 0.5f }; ///< NLMS step (0..1], larger converges faster and is noisier
+    float doubleTalkThreshold{ 0.5f }; ///< Near end counts as talking above this fraction of the far-end peak
+    int doubleTalkHoldMs{ 60 }; ///< Adaptation stays frozen this long after double talk
+    float farEndFloor{ 1e-3f }; ///< Far-end peak below which the speaker counts as silent (about -60 dBFS)
+};
+
+/// @brief Echo canceller activity (see EchoCanceller::getStats)
+struct EchoCancellerStats {
+    uint64_t samples{ 0 }; ///< Samples processed
+    uint64_t farEndSamples{ 0 }; ///< Samples processed while the speaker was playing
+    uint64_t doubleTalkSamples{ 0 }; ///< Samples with adaptation frozen by the double-talk detector
+    double erleDb{ 0.0 }; ///< Echo return loss enhancement while the far end alone is active (smoothed)
+};
+
+/// @brief Mono NLMS echo canceller (not thread-safe, one instance per capture stream)
+class EchoCanceller {
+public:
+    /**
+     * @brief Size the filter for a sample rate
+     * @param sampleRate Rate of both the microphone and the reference
+     * @param config Filter length, delay and adaptation parameters
+     */
+    explicit EchoCanceller(int sampleRate, const EchoCancellerConfig& config = EchoCancellerConfig{});
+
+    /**
+     * @brief Remove the echo from a block of microphone samples in place
+     * @param mic Captured samples, replaced by the echo-cancelled signal
+     * @param reference Samples sent to the speaker at the same positions
+     * @param count Number of samples in both
+     */
+    void process(float* mic, const float* reference, size_t count);
+
+    /// @brief Same as above for int16 PCM (output is rounded and clipped)
+    void process(int16_t* mic, const int16_t* reference, size_t count);
+
+    /// @brief Forget the learned echo path and the reference history
+    void reset();
+
+    /// @brief True while adaptation is frozen because the near end is talking over the far end
+    bool isDoubleTalk() const { return m_holdRemaining > 0; }
+
+    /// @brief Samples since the far end started playing without a break (0 while it is silent)
+    uint64_t farEndRunSamples() const { return m_farEndRun; }
+
+    EchoCancellerStats getStats() const;
+
+    size_t taps() const { return m_taps; }
+    int sampleRate() const { return m_sampleRate; }
+    const EchoCancellerConfig& config() const { return m_config; }
+
+private:
+    float processSample(float mic, float reference);
+
+    int m_sampleRate;
+    EchoCancellerConfig m_config;
+    size_t m_taps{ 0 }; ///< Filter length, a multiple of 8
+    size_t m_delay{ 0 }; ///< Bulk delay in samples
+    size_t m_span{ 0 }; ///< Reference samples kept: m_taps + m_delay
+    std::vector<float> m_weights; ///< Oldest tap first, like the reference window
+    std::vector<float> m_history; ///< Reference ring of m_span samples stored twice, so every window is contiguous
+    size_t m_write{ 0 }; ///< Ring index of the newest reference sample
+    double m_windowEnergy{ 0.0 }; ///< Sum of squares of the current reference window
+    float m_farPeak{ 0.0f }; ///< Decaying peak of the delayed reference
+    float m_peakDecay{ 1.0f }; ///< Per-sample decay of m_farPeak
+    int m_holdSamples{ 0 }; ///< Double-talk hold length
+    int m_holdRemaining{ 0 };
+    uint64_t m_farEndRun{ 0 }; ///< Consecutive samples with the far end active
+    double m_micPower{ 0.0 }; ///< Smoothed powers for the ERLE estimate
+    double m_errorPower{ 0.0 };
+    EchoCancellerStats m_stats;
+    std::vector<float> m_scratchMic; ///< Float conversion buffers for the int16 path
+    std::vector<float> m_scratchReference;
+};
+
+} // namespace Base
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_BASE_ECHOCANCELLER_H
@@ -0,0 +1,204 @@
+/**
+ * @file resampler.cpp
+ * @author lc
+ * @brief Implementation of the polyphase resampler
+ * @see resampler.h
+ * @version 0.1
+ * @date 2024-04-22
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define XP_RESAMPLER_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace XPlaneChatBot {
+namespace Base {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+/// @brief Filter parameters per quality level
+struct FilterSpec {
+    int zeroCrossings; ///< Sinc lobes on each side of the centre, at the lower of the two rates
+    double passband; ///< Cutoff as a fraction of the lower Nyquist frequency
+    double beta; ///< Kaiser window shape
+};
+
+FilterSpec specFor(ResamplerQuality quality) {
+    switch (quality) {
+    case ResamplerQuality::Fast: return { 6, 0.85, 6.0 };
+    case ResamplerQuality::High: return { 24, 0.95, 10.0 };
+    default: return { 12, 0.90, 8.0 };
+    }
+}
+
+/// @brief Zeroth order modified Bessel function of the first kind (series expansion)
+double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    const double halfX = x / 2.0;
+    for (int k = 1; k < 50; ++k) {
+        term *= (halfX / k) * (halfX / k);
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+float dot(const float* a, const float* b, size_t n) {
+#ifdef XP_RESAMPLER_SSE
+    // n is a multiple of 8: two independent accumulators hide the add latency
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (size_t i = 0; i < n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    acc0 = _mm_add_ps(acc0, acc1);
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, acc0);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#else
+    float sum = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+#endif
+}
+
+} // namespace
+
+
+PolyphaseResampler::PolyphaseResampler(int inputRate, int outputRate, ResamplerQuality quality)
+    : m_inputRate(inputRate)
+    , m_outputRate(outputRate)
+    , m_quality(quality)
+{
+    const int divisor = std::gcd(inputRate, outputRate);
+    m_up = outputRate / divisor;
+    m_down = inputRate / divisor;
+    design();
+    reset();
+}
+
+void PolyphaseResampler::design() {
+    if (isPassthrough()) {
+        m_taps = 0;
+        m_coeffs.clear();
+        return;
+    }
+
+    // Prototype runs at L * inputRate; its cutoff is set by whichever of the two rates is lower
+    const FilterSpec spec = specFor(m_quality);
+    const int factor = std::max(m_up, m_down);
+    const double cutoff = spec.passband / (2.0 * factor); // Cycles per prototype sample
+    const size_t prototypeLength = static_cast<size_t>(2 * spec.zeroCrossings * factor + 1);
+    const size_t tapsPerPhase = (prototypeLength + m_up - 1) / m_up;
+    m_taps = (tapsPerPhase + 7) & ~static_cast<size_t>(7);
+
+    const double centre = (prototypeLength - 1) / 2.0;
+    const double windowNorm = besselI0(spec.beta);
+    std::vector<double> prototype(static_cast<size_t>(m_up) * m_taps, 0.0);
+    for (size_t n = 0; n < prototypeLength; ++n) {
+        const double t = n - centre;
+        const double x = 2.0 * cutoff * t;
+        const double sinc = (t == 0.0) ? 1.0 : std::sin(kPi * x) / (kPi * x);
+        const double ratio = t / centre;
+        const double window = besselI0(spec.beta * std::sqrt(std::max(0.0, 1.0 - ratio * ratio))) / windowNorm;
+        prototype[n] = 2.0 * cutoff * m_up * sinc * window; // Gain L makes up for the zeros inserted by upsampling
+    }
+
+    // Phase p uses prototype[p + j * L] against input x[i - j]; store it reversed so the dot product walks forward
+    m_coeffs.assign(static_cast<size_t>(m_up) * m_taps, 0.0f);
+    for (int p = 0; p < m_up; ++p) {
+        float* phase = m_coeffs.data() + static_cast<size_t>(p) * m_taps;
+        for (size_t j = 0; j < m_taps; ++j) {
+            phase[m_taps - 1 - j] = static_cast<float>(prototype[p + j * m_up]);
+        }
+    }
+}
+
+void PolyphaseResampler::reset() {
+    m_history.assign(m_taps > 0 ? m_taps - 1 : 0, 0.0f);
+    m_nextInput = m_history.size();
+    m_phase = 0;
+}
+
+double PolyphaseResampler::latencyInputSamples() const {
+    if (isPassthrough()) {
+        return 0.0;
+    }
+    const FilterSpec spec = specFor(m_quality);
+    return static_cast<double>(spec.zeroCrossings) * std::max(m_up, m_down) / m_up;
+}
+
+size_t PolyphaseResampler::maxOutput(size_t count) const {
+    // Outputs are produced while their newest input is available; one extra covers the phase carried over
+    return (count * static_cast<size_t>(m_up)) / static_cast<size_t>(m_down) + 2;
+}
+
+size_t PolyphaseResampler::process(const float* in, size_t count, float* out) {
+    if (isPassthrough()) {
+        std::copy(in, in + count, out);
+        return count;
+    }
+    m_history.insert(m_history.end(), in, in + count);
+    return run(out);
+}
+
+size_t PolyphaseResampler::process(const int16_t* in, size_t count, int16_t* out) {
+    if (isPassthrough()) {
+        std::copy(in, in + count, out);
+        return count;
+    }
+    constexpr float toFloat = 1.0f / 32768.0f;
+    const size_t start = m_history.size();
+    m_history.resize(start + count);
+    for (size_t i = 0; i < count; ++i) {
+        m_history[start + i] = in[i] * toFloat;
+    }
+
+    m_scratch.resize(maxOutput(count));
+    const size_t produced = run(m_scratch.data());
+    for (size_t i = 0; i < produced; ++i) {
+        const float scaled = std::round(m_scratch[i] * 32768.0f);
+        out[i] = static_cast<int16_t>(std::clamp(scaled, -32768.0f, 32767.0f));
+    }
+    return produced;
+}
+
+size_t PolyphaseResampler::run(float* out) {
+    size_t produced = 0;
+    const float* history = m_history.data();
+    while (m_nextInput < m_history.size()) {
+        const float* coeffs = m_coeffs.data() + static_cast<size_t>(m_phase) * m_taps;
+        out[produced++] = dot(coeffs, history + m_nextInput + 1 - m_taps, m_taps);
+
+        m_phase += m_down;
+        m_nextInput += static_cast<size_t>(m_phase / m_up);
+        m_phase %= m_up;
+    }
+
+    // Keep only the history the next outputs still need
+    const size_t keepFrom = std::min(m_nextInput, m_history.size()) + 1 - m_taps;
+    m_history.erase(m_history.begin(), m_history.begin() + static_cast<std::ptrdiff_t>(keepFrom));
+    m_nextInput -= keepFrom;
+    return produced;
+}
+
+} // namespace Base
+} // namespace XPlaneChatBot
@@ -0,0 +1,103 @@
+/**
+ * @file resampler.h
+ * @author lc
+ * @brief Streaming polyphase FIR resampler for converting between device and codec/STT sample rates
+ *
+ * The ratio is reduced to L/M and a Kaiser windowed sinc prototype is split into L phases, so each output
+ * sample costs one dot product of tapsPerPhase() coefficients (vectorized with SSE). Only mono streams are
+ * supported; the filter state carries across calls so blocks can be of any size.
+ *
+ * @version 0.1
+ * @date 2024-04-22
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_BASE_RESAMPLER_H
+#define XPROTECTION_BASE_RESAMPLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace XPlaneChatBot {
+namespace Base {
+
+/// @brief Quality/latency trade-off of the resampler filter
+enum class ResamplerQuality {
+    Fast, ///< 0.4 ms group delay at 16 kHz, ~65 dB stopband, passband to 85% of Nyquist
+    Balanced, ///< Default: 0.75 ms group delay at 16 kHz, ~80 dB stopband, passband to 90% of Nyquist
+    High, ///< 1.5 ms group delay at 16 kHz, ~100 dB stopband, passband to 95% of Nyquist
+};
+
+static const std::string resamplerQualityToString(const ResamplerQuality& quality) {
+    switch (quality) {
+    case ResamplerQuality::Fast: return "Fast";
+    case ResamplerQuality::Balanced: return "Balanced";
+    case ResamplerQuality::High: return "High";
+    default: return "Unknown";
+    }
+}
+
+/// @brief Mono streaming rational-ratio resampler (not thread-safe, one instance per stream)
+class PolyphaseResampler {
+public:
+    /**
+     * @brief Design the filter for a rate pair
+     * @param inputRate Sample rate of the data passed to process()
+     * @param outputRate Sample rate of the data produced
+     * @param quality Filter length and passband trade-off
+     */
+    PolyphaseResampler(int inputRate, int outputRate, ResamplerQuality quality = ResamplerQuality::Balanced);
+
+    /**
+     * @brief Resample a block
+     * @param in Input samples
+     * @param count Number of input samples
+     * @param out Output buffer, must hold at least maxOutput(count) samples
+     * @return Number of samples written to out
+     */
+    size_t process(const float* in, size_t count, float* out);
+
+    /// @brief Same as above for int16 PCM (output is rounded and clipped)
+    size_t process(const int16_t* in, size_t count, int16_t* out);
+
+    /// @brief Upper bound on the output of one process() call with count input samples
+    size_t maxOutput(size_t count) const;
+
+    /// @brief Forget the filter history (start of a new stream)
+    void reset();
+
+    /// @brief True if the rates are equal and process() only copies
+    bool isPassthrough() const { return m_up == m_down; }
+
+    /// @brief Delay introduced by the filter, in input samples
+    double latencyInputSamples() const;
+
+    int inputRate() const { return m_inputRate; }
+    int outputRate() const { return m_outputRate; }
+    ResamplerQuality quality() const { return m_quality; }
+    size_t tapsPerPhase() const { return m_taps; }
+
+private:
+    void design();
+    size_t run(float* out);
+
+    int m_inputRate;
+    int m_outputRate;
+    ResamplerQuality m_quality;
+    int m_up{ 1 }; ///< L: interpolation factor of the reduced ratio
+    int m_down{ 1 }; ///< M: decimation factor of the reduced ratio
+    size_t m_taps{ 0 }; ///< Coefficients per phase, padded to a multiple of 8
+    std::vector<float> m_coeffs; ///< m_up phases of m_taps coefficients each, stored time-reversed
+    std::vector<float> m_history; ///< Last m_taps - 1 inputs followed by the current block
+    size_t m_nextInput{ 0 }; ///< Index in m_history of the newest input used by the next output
+    int m_phase{ 0 }; ///< Phase (0..m_up-1) of the next output
+    std::vector<float> m_scratch; ///< Float conversion buffer for the int16 path
+};
+
+} // namespace Base
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_BASE_RESAMPLER_H
@@ -0,0 +1,159 @@
+/**
+ * @file ringbuffer.h
+ * @author lc
+ * @brief Wait-free single-producer/single-consumer ring buffer used to hand data across real-time threads
+ *
+ * The producer only ever writes the head index and the consumer only ever writes the tail index,
+ * so neither side takes a lock, allocates or blocks. This makes it safe to call from PortAudio callbacks.
+ *
+ * @version 0.1
+ * @date 2024-03-04
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_BASE_RINGBUFFER_H
+#define XPROTECTION_BASE_RINGBUFFER_H
+
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <algorithm>
+#include <utility>
+
+namespace XPlaneChatBot {
+namespace Base {
+
+/// @brief Size of a cache line, used to keep producer and consumer indices from false sharing
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * @brief Bounded wait-free single-producer/single-consumer ring buffer
+ *
+ * Exactly one thread may call the producer methods (write, push) and exactly one thread may call
+ * the consumer methods (read, pop, discard). The observers (size, freeSpace) may be called from anywhere
+ * but only give a snapshot.
+ *
+ * @tparam T Element type. Bulk methods are a plain memcpy when T is trivially copyable.
+ */
+template <typename T>
+class SpscRingBuffer {
+public:
+    /// @brief Construct the ring buffer; the capacity is rounded up to the next power of two
+    /// @param capacity Minimum number of elements the buffer must hold
+    explicit SpscRingBuffer(size_t capacity)
+        : m_capacity(roundUpPow2(capacity))
+        , m_mask(m_capacity - 1)
+        , m_storage(new T[m_capacity])
+    {}
+
+    SpscRingBuffer(const SpscRingBuffer&) = delete;
+    SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+    /// @brief (Producer) Write up to count elements, returns the number actually written
+    size_t write(const T* data, size_t count) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        size_t available = m_capacity - (head - m_tailCache);
+        if (available < count) {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            available = m_capacity - (head - m_tailCache);
+        }
+        const size_t n = std::min(count, available);
+        const size_t offset = head & m_mask;
+        const size_t first = std::min(n, m_capacity - offset);
+        std::copy(data, data + first, m_storage.get() + offset);
+        std::copy(data + first, data + n, m_storage.get());
+        m_head.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    /// @brief (Producer) Move a single element in, returns false if the buffer is full
+    bool push(T&& value) {
+        const size_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tailCache == m_capacity) {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (head - m_tailCache == m_capacity) {
+                return false;
+            }
+        }
+        m_storage[head & m_mask] = std::move(value);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief (Consumer) Read up to count elements, returns the number actually read
+    size_t read(T* out, size_t count) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        size_t available = m_headCache - tail;
+        if (available < count) {
+            m_headCache = m_head.load(std::memory_order_acquire);
+            available = m_headCache - tail;
+        }
+        const size_t n = std::min(count, available);
+        const size_t offset = tail & m_mask;
+        const size_t first = std::min(n, m_capacity - offset);
+        std::copy(m_storage.get() + offset, m_storage.get() + offset + first, out);
+        std::copy(m_storage.get(), m_storage.get() + (n - first), out + first);
+        m_tail.store(tail + n, std::memory_order_release);
+        return n;
+    }
+
+    /// @brief (Consumer) Move a single element out, returns false if the buffer is empty
+    bool pop(T& out) {
+        const size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (m_headCache == tail) {
+            m_headCache = m_head.load(std::memory_order_acquire);
+            if (m_headCache == tail) {
+                return false;
+            }
+        }
+        out = std::move(m_storage[tail & m_mask]);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief (Consumer) Drop everything currently queued
+    void discard() {
+        m_headCache = m_head.load(std::memory_order_acquire);
+        m_tail.store(m_headCache, std::memory_order_release);
+    }
+
+    /// @brief Number of elements currently queued (snapshot)
+    size_t size() const {
+        const size_t tail = m_tail.load(std::memory_order_acquire);
+        const size_t head = m_head.load(std::memory_order_acquire);
+        return head - tail;
+    }
+
+    /// @brief Number of elements that can still be written (snapshot)
+    size_t freeSpace() const { return m_capacity - size(); }
+
+    /// @brief Total number of elements the buffer can hold
+    size_t capacity() const { return m_capacity; }
+
+    /// @brief True if nothing is queued (snapshot)
+    bool empty() const { return size() == 0; }
+
+private:
+    static size_t roundUpPow2(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const size_t m_capacity; ///< Capacity in elements (power of two)
+    const size_t m_mask; ///< Index mask (capacity - 1)
+    std::unique_ptr<T[]> m_storage; ///< Element storage
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_head{ 0 }; ///< Next write position (written by producer only)
+    size_t m_tailCache{ 0 }; ///< Producer's cached copy of the tail
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> m_tail{ 0 }; ///< Next read position (written by consumer only)
+    size_t m_headCache{ 0 }; ///< Consumer's cached copy of the head
+};
+
+} // namespace Base
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_BASE_RINGBUFFER_H
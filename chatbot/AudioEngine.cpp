@@ -0,0 +1,264 @@
+/**
+ * @file AudioEngine.cpp
+ * @author zah
+ * @brief Implementation of the session audio engine
+ * @see AudioEngine.h
+ * @version 0.1
+ * @date 2024-07-01
+ *
+ */
+
+#include "AudioEngine.h"
+
+#include "base/logger.h"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+
+namespace XPlaneChatBot {
+namespace Chat {
+
+namespace {
+    constexpr int kFallbackRate = 48000;
+    constexpr int kChannels = 1;
+}
+
+
+AudioEngine::AudioEngine(const AudioEngineConfig& config)
+    : m_config(config)
+{
+    m_err = Pa_Initialize();
+    if (m_err != paNoError) {
+        Base::Logger::log("PortAudio initialization error: " + std::string(Pa_GetErrorText(m_err)), Base::ERR, __FUNCTION__);
+        return;
+    }
+    m_initialized = true;
+
+    if (!m_config.duplex || !openDuplex()) {
+        openSeparate();
+    }
+}
+
+AudioEngine::~AudioEngine() {
+    closeStream(m_duplexStream);
+    closeStream(m_inputStream);
+    closeStream(m_outputStream);
+    if (m_initialized) {
+        m_err = Pa_Terminate();
+        if (m_err != paNoError) {
+            Base::Logger::log("PortAudio termination error: " + std::string(Pa_GetErrorText(m_err)), Base::ERR, __FUNCTION__);
+        }
+    }
+}
+
+int AudioEngine::nativeOutputRate(int fallbackRate) {
+    // PortAudio initialization is reference counted, so this is safe while the streams are open
+    if (Pa_Initialize() != paNoError) {
+        return fallbackRate;
+    }
+    const PaDeviceIndex device = Pa_GetDefaultOutputDevice();
+    const PaDeviceInfo* info = device == paNoDevice ? nullptr : Pa_GetDeviceInfo(device);
+    const int rate = info ? static_cast<int>(info->defaultSampleRate) : 0;
+    Pa_Terminate();
+    return rate > 0 ? rate : fallbackRate;
+}
+
+int AudioEngine::nativeInputRate(int fallbackRate) {
+    if (Pa_Initialize() != paNoError) {
+        return fallbackRate;
+    }
+    const PaDeviceIndex device = Pa_GetDefaultInputDevice();
+    const PaDeviceInfo* info = device == paNoDevice ? nullptr : Pa_GetDeviceInfo(device);
+    const int rate = info ? static_cast<int>(info->defaultSampleRate) : 0;
+    Pa_Terminate();
+    return rate > 0 ? rate : fallbackRate;
+}
+
+bool AudioEngine::openDuplex() {
+    // The speaker's rate first: TTS is resampled to it anyway, and the microphone is resampled to the STT rate
+    const int outputRate = nativeOutputRate(kFallbackRate);
+    const int inputRate = nativeInputRate(outputRate);
+    const int rates[] = { outputRate, inputRate };
+    for (size_t i = 0; i < (inputRate == outputRate ? 1u : 2u); ++i) {
+        const int rate = rates[i];
+        const unsigned long frames = static_cast<unsigned long>(rate * std::max(m_config.bufferMs, 1) / 1000);
+        m_err = Pa_OpenDefaultStream(&m_duplexStream, kChannels, kChannels, paFloat32, rate, frames, &AudioEngine::duplexCallback, this);
+        if (m_err != paNoError) {
+            Base::Logger::log("No duplex stream at " + std::to_string(rate) + " Hz: " + std::string(Pa_GetErrorText(m_err)), Base::WARN, __FUNCTION__);
+            m_duplexStream = nullptr;
+            continue;
+        }
+        Pa_SetStreamFinishedCallback(m_duplexStream, &AudioEngine::outputFinished);
+        if (const PaStreamInfo* info = Pa_GetStreamInfo(m_duplexStream)) {
+            m_inputLatencyMs = info->inputLatency * 1000.0;
+            m_outputLatencyMs = info->outputLatency * 1000.0;
+        }
+        m_inputRate = rate;
+        m_outputRate = rate;
+        if (!start(m_duplexStream, "duplex")) {
+            continue;
+        }
+        Base::Logger::log(
+            "Duplex audio stream started at " + std::to_string(rate) + " Hz (latency in " + std::to_string(static_cast<int>(m_inputLatencyMs))
+            + " ms, out " + std::to_string(static_cast<int>(m_outputLatencyMs)) + " ms)",
+            Base::INFO, __FUNCTION__
+        );
+        return true;
+    }
+    return false;
+}
+
+void AudioEngine::openSeparate() {
+    Base::Logger::log("Opening separate input and output streams, echo cancellation is not available", Base::WARN, __FUNCTION__);
+    m_outputRate = nativeOutputRate(kFallbackRate);
+    m_err = Pa_OpenDefaultStream(&m_outputStream, 0, kChannels, paFloat32, m_outputRate,
+        static_cast<unsigned long>(m_outputRate * std::max(m_config.bufferMs, 1) / 1000), &AudioEngine::outputCallback, this);
+    if (m_err != paNoError) {
+        Base::Logger::log("PortAudio output stream open error: " + std::string(Pa_GetErrorText(m_err)), Base::ERR, __FUNCTION__);
+        m_outputStream = nullptr;
+    }
+    else {
+        Pa_SetStreamFinishedCallback(m_outputStream, &AudioEngine::outputFinished);
+        start(m_outputStream, "output");
+    }
+
+    m_inputRate = nativeInputRate(m_outputRate);
+    m_err = Pa_OpenDefaultStream(&m_inputStream, kChannels, 0, paFloat32, m_inputRate,
+        static_cast<unsigned long>(m_inputRate * std::max(m_config.bufferMs, 1) / 1000), &AudioEngine::inputCallback, this);
+    if (m_err != paNoError) {
+        Base::Logger::log("PortAudio input stream open error: " + std::string(Pa_GetErrorText(m_err)), Base::ERR, __FUNCTION__);
+        m_inputStream = nullptr;
+    }
+    else {
+        start(m_inputStream, "input");
+    }
+}
+
+bool AudioEngine::start(PaStream* stream, const char* name) {
+    m_err = Pa_StartStream(stream);
+    if (m_err == paNoError) {
+        return true;
+    }
+    Base::Logger::log("PortAudio " + std::string(name) + " stream start error: " + std::string(Pa_GetErrorText(m_err)), Base::ERR, __FUNCTION__);
+    PaStream*& owner = stream == m_duplexStream ? m_duplexStream : stream == m_inputStream ? m_inputStream : m_outputStream;
+    Pa_CloseStream(owner);
+    owner = nullptr;
+    return false;
+}
+
+void AudioEngine::closeStream(PaStream*& stream) {
+    if (stream == nullptr) {
+        return;
+    }
+    m_err = Pa_AbortStream(stream); // Nobody is left to listen to the rest
+    if (m_err != paNoError) {
+        Base::Logger::log("PortAudio stream stop error: " + std::string(Pa_GetErrorText(m_err)), Base::ERR, __FUNCTION__);
+    }
+    Pa_CloseStream(stream);
+    stream = nullptr;
+}
+
+void AudioEngine::setRenderCallback(RenderCallback render, std::function<void()> stopped) {
+    m_renderEnabled = false;
+    while (m_renderBusy) {
+        std::this_thread::yield(); // At most one callback period
+    }
+    m_render = std::move(render);
+    m_renderStopped = std::move(stopped);
+    m_renderEnabled = static_cast<bool>(m_render);
+}
+
+void AudioEngine::setCaptureCallback(CaptureCallback capture) {
+    m_captureEnabled = false;
+    while (m_captureBusy) {
+        std::this_thread::yield();
+    }
+    m_capture = std::move(capture);
+    m_captureEnabled = static_cast<bool>(m_capture);
+}
+
+AudioEngineStats AudioEngine::getStats() const {
+    AudioEngineStats stats;
+    stats.duplex = isDuplex();
+    stats.inputRate = m_inputRate;
+    stats.outputRate = m_outputRate;
+    stats.inputLatencyMs = m_inputLatencyMs;
+    stats.outputLatencyMs = m_outputLatencyMs;
+    stats.callbacks = m_callbacks.load();
+    stats.inputOverflows = m_inputOverflows.load();
+    stats.outputUnderflows = m_outputUnderflows.load();
+    return stats;
+}
+
+
+int AudioEngine::duplexCallback(const void* input, void* output, unsigned long frames,
+    const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags, void* userData)
+{
+    UNUSED(timeInfo);
+    // Real-time thread: no logging, locking or allocation in here
+    AudioEngine* engine = static_cast<AudioEngine*>(userData);
+    float* out = static_cast<float*>(output);
+    const size_t count = static_cast<size_t>(frames) * kChannels;
+    engine->render(out, count, statusFlags);
+    if (input != nullptr) {
+        engine->capture(static_cast<const float*>(input), out, count, statusFlags); // The speaker block is the echo reference
+    }
+    return paContinue;
+}
+
+int AudioEngine::outputCallback(const void* input, void* output, unsigned long frames,
+    const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags, void* userData)
+{
+    UNUSED(input);
+    UNUSED(timeInfo);
+    static_cast<AudioEngine*>(userData)->render(static_cast<float*>(output), static_cast<size_t>(frames) * kChannels, statusFlags);
+    return paContinue;
+}
+
+int AudioEngine::inputCallback(const void* input, void* output, unsigned long frames,
+    const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags, void* userData)
+{
+    UNUSED(output);
+    UNUSED(timeInfo);
+    if (input != nullptr) {
+        static_cast<AudioEngine*>(userData)->capture(static_cast<const float*>(input), nullptr, static_cast<size_t>(frames) * kChannels, statusFlags);
+    }
+    return paContinue;
+}
+
+void AudioEngine::outputFinished(void* userData) {
+    AudioEngine* engine = static_cast<AudioEngine*>(userData);
+    engine->m_renderBusy = true;
+    if (engine->m_renderEnabled && engine->m_renderStopped) {
+        engine->m_renderStopped();
+    }
+    engine->m_renderBusy = false;
+}
+
+void AudioEngine::render(float* out, size_t count, PaStreamCallbackFlags flags) {
+    m_callbacks.fetch_add(1, std::memory_order_relaxed);
+    if (flags & paOutputUnderflow) {
+        m_outputUnderflows.fetch_add(1, std::memory_order_relaxed);
+    }
+    std::fill(out, out + count, 0.0f); // Silence unless the source has something
+    m_renderBusy = true; // Before checking the flag, see setRenderCallback
+    if (m_renderEnabled) {
+        m_render(out, count);
+    }
+    m_renderBusy = false;
+}
+
+void AudioEngine::capture(const float* mic, const float* reference, size_t count, PaStreamCallbackFlags flags) {
+    if (flags & paInputOverflow) {
+        m_inputOverflows.fetch_add(1, std::memory_order_relaxed);
+    }
+    m_captureBusy = true;
+    if (m_captureEnabled) {
+        m_capture(mic, reference, count, flags);
+    }
+    m_captureBusy = false;
+}
+
+} // namespace Chat
+} // namespace XPlaneChatBot
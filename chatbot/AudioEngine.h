@@ -0,0 +1,144 @@
+/**
+ * @file AudioEngine.h
+ * @author zah
+ * @brief Owner of PortAudio and of the session's audio streams, shared by the transcriber and the player
+ *
+ * PortAudio is initialized once here and a single full-duplex stream carries both the microphone and the speaker.
+ * Every callback hands the captured block to the capture callback together with the block rendered for the
+ * speaker in the same callback, which is the sample-aligned reference an echo canceller needs. This is what lets
+ * the microphone stay live while the assistant speaks.
+ *
+ * When the devices cannot be opened as one duplex stream (e.g. they do not share a sample rate), the engine falls
+ * back to separate input and output streams at their native rates; capture then has no echo reference and the
+ * chatbot listens and speaks in turns, as before.
+ *
+ * Both callbacks run on PortAudio's real-time threads and must not lock, allocate or block.
+ *
+ * @version 0.1
+ * @date 2024-07-01
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_CHAT_AUDIOENGINE_H
+#define XPROTECTION_CHAT_AUDIOENGINE_H
+
+#include <portaudio.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+namespace XPlaneChatBot {
+	namespace Chat {
+
+		/// @brief How the engine opens its streams
+		struct AudioEngineConfig {
+			int bufferMs{ 20 }; ///< Callback period
+			bool duplex{ true }; ///< Try a single full-duplex stream first (required for echo cancellation)
+		};
+
+		/// @brief Stream setup and callback counters of the engine
+		struct AudioEngineStats {
+			bool duplex{ false }; ///< Microphone and speaker run on one stream
+			int inputRate{ 0 };
+			int outputRate{ 0 };
+			double inputLatencyMs{ 0.0 }; ///< As reported by PortAudio
+			double outputLatencyMs{ 0.0 };
+			uint64_t callbacks{ 0 }; ///< Speaker callbacks
+			uint64_t inputOverflows{ 0 }; ///< Callbacks where PortAudio reported lost input
+			uint64_t outputUnderflows{ 0 }; ///< Callbacks where PortAudio reported a gap in the output
+		};
+
+		/// @brief Process audio I/O for one chat session
+		class AudioEngine {
+		public:
+			/// @brief Fill the speaker buffer (zeroed beforehand) with count mono samples
+			using RenderCallback = std::function<void(float* out, size_t count)>;
+
+			/**
+			 * @brief Receive count captured mono samples
+			 * @param reference What was rendered for the speaker in the same callback; null without a duplex stream
+			 */
+			using CaptureCallback = std::function<void(const float* mic, const float* reference, size_t count, PaStreamCallbackFlags flags)>;
+
+			/// @brief Initialize PortAudio and start the streams
+			explicit AudioEngine(const AudioEngineConfig& config = AudioEngineConfig{});
+
+			/// @brief Stops the streams (the stopped callback is called) and terminates PortAudio
+			~AudioEngine();
+
+			AudioEngine(const AudioEngine&) = delete;
+			AudioEngine& operator=(const AudioEngine&) = delete;
+
+			/// @brief Default sample rate of the default output device (fallbackRate if it cannot be queried)
+			static int nativeOutputRate(int fallbackRate);
+
+			/// @brief Default sample rate of the default input device (fallbackRate if it cannot be queried)
+			static int nativeInputRate(int fallbackRate);
+
+			bool isDuplex() const { return m_duplexStream != nullptr; }
+			bool hasInput() const { return m_duplexStream != nullptr || m_inputStream != nullptr; }
+			bool hasOutput() const { return m_duplexStream != nullptr || m_outputStream != nullptr; }
+			int inputRate() const { return m_inputRate; }
+			int outputRate() const { return m_outputRate; }
+
+			/// @brief Delay from a rendered sample to its echo in the capture, as far as PortAudio knows (duplex only)
+			double echoPathDelayMs() const { return m_inputLatencyMs + m_outputLatencyMs; }
+
+			/**
+			 * @brief Install the speaker source (any thread); waits for a callback in progress before returning
+			 * @param stopped Called once if the output stream stops for good (device lost or engine destroyed)
+			 */
+			void setRenderCallback(RenderCallback render, std::function<void()> stopped = {});
+
+			/// @brief Install the microphone sink (any thread); waits for a callback in progress before returning
+			void setCaptureCallback(CaptureCallback capture);
+
+			AudioEngineStats getStats() const;
+
+		private:
+			static int duplexCallback(const void* input, void* output, unsigned long frames,
+				const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags, void* userData);
+			static int outputCallback(const void* input, void* output, unsigned long frames,
+				const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags, void* userData);
+			static int inputCallback(const void* input, void* output, unsigned long frames,
+				const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags, void* userData);
+			static void outputFinished(void* userData);
+
+			bool openDuplex();
+			void openSeparate();
+			bool start(PaStream* stream, const char* name);
+			void render(float* out, size_t count, PaStreamCallbackFlags flags);
+			void capture(const float* mic, const float* reference, size_t count, PaStreamCallbackFlags flags);
+			void closeStream(PaStream*& stream);
+
+			const AudioEngineConfig m_config;
+			PaError m_err{ paNoError };
+			bool m_initialized{ false };
+			PaStream* m_duplexStream{ nullptr };
+			PaStream* m_inputStream{ nullptr }; ///< Fallback when there is no duplex stream
+			PaStream* m_outputStream{ nullptr };
+			int m_inputRate{ 0 };
+			int m_outputRate{ 0 };
+			double m_inputLatencyMs{ 0.0 };
+			double m_outputLatencyMs{ 0.0 };
+
+			// A callback only runs while its "enabled" flag is set; the setters clear it and wait for "busy" to drop
+			RenderCallback m_render;
+			std::function<void()> m_renderStopped;
+			std::atomic<bool> m_renderEnabled{ false };
+			std::atomic<bool> m_renderBusy{ false };
+			CaptureCallback m_capture;
+			std::atomic<bool> m_captureEnabled{ false };
+			std::atomic<bool> m_captureBusy{ false };
+
+			std::atomic<uint64_t> m_callbacks{ 0 };
+			std::atomic<uint64_t> m_inputOverflows{ 0 };
+			std::atomic<uint64_t> m_outputUnderflows{ 0 };
+		};
+
+	} // namespace Chat
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_CHAT_AUDIOENGINE_H
@@ -0,0 +1,117 @@
+/**
+ * @file AudioFrameWriter.cpp
+ * @author zah
+ * @brief Implementation of the pooled audio frame writer
+ * @see AudioFrameWriter.h
+ * @version 0.1
+ * @date 2024-03-11
+ *
+ */
+
+#include "AudioFrameWriter.h"
+
+#include <cstring>
+
+namespace XPlaneChatBot {
+namespace Chat {
+
+namespace {
+    constexpr char kJsonPrefix[] = "{\"audio_data\":\"";
+    constexpr char kJsonSuffix[] = "\"}";
+    constexpr size_t kJsonPrefixLength = sizeof(kJsonPrefix) - 1;
+    constexpr size_t kJsonSuffixLength = sizeof(kJsonSuffix) - 1;
+
+    // A handful of buffers covers the frame in flight plus any the websocket layer is still holding
+    constexpr size_t kPoolSize = 4;
+}
+
+
+FramePool::FramePool(size_t buffers, size_t bufferCapacity)
+    : m_bufferCapacity(bufferCapacity)
+{
+    m_free.reserve(buffers);
+    for (size_t i = 0; i < buffers; ++i) {
+        auto* buffer = new std::string();
+        buffer->reserve(m_bufferCapacity);
+        m_free.push_back(buffer);
+    }
+}
+
+FramePool::~FramePool() {
+    for (auto* buffer : m_free) {
+        delete buffer;
+    }
+}
+
+FramePool::Frame FramePool::acquire() {
+    std::string* buffer = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_free.empty()) {
+            buffer = m_free.back();
+            m_free.pop_back();
+        }
+        else {
+            ++m_misses;
+        }
+    }
+    if (!buffer) {
+        buffer = new std::string();
+        buffer->reserve(m_bufferCapacity);
+    }
+    return Frame(buffer, Releaser{ this });
+}
+
+void FramePool::release(std::string* buffer) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_free.push_back(buffer); // Grows by at most the number of misses
+}
+
+
+AudioFrameWriter::AudioFrameWriter(AudioFrameMode mode, size_t maxChunkSamples)
+    : m_mode(mode)
+    , m_pool(kPoolSize, kJsonPrefixLength + Base::base64_encoded_length(maxChunkSamples * sizeof(int16_t)) + kJsonSuffixLength)
+{
+}
+
+size_t AudioFrameWriter::frameSize(size_t count) const {
+    const size_t bytes = count * sizeof(int16_t);
+    if (m_mode == AudioFrameMode::BinaryPcm) {
+        return bytes;
+    }
+    return kJsonPrefixLength + Base::base64_encoded_length(bytes) + kJsonSuffixLength;
+}
+
+FramePool::Frame AudioFrameWriter::write(const int16_t* samples, size_t count) {
+    FramePool::Frame frame = m_pool.acquire();
+    std::string& out = *frame;
+    const size_t bytes = count * sizeof(int16_t);
+
+    // resize() within the reserved capacity never reallocates
+    out.resize(frameSize(count));
+    char* dst = &out[0];
+
+    if (m_mode == AudioFrameMode::BinaryPcm) {
+        std::memcpy(dst, samples, bytes);
+        return frame;
+    }
+
+    std::memcpy(dst, kJsonPrefix, kJsonPrefixLength);
+    dst += kJsonPrefixLength;
+    dst += Base::base64_encode_into(samples, bytes, dst);
+    std::memcpy(dst, kJsonSuffix, kJsonSuffixLength);
+    return frame;
+}
+
+const std::string& AudioFrameWriter::terminateMessage() {
+    static const std::string message{ "{\"terminate_session\":true}" };
+    return message;
+}
+
+const std::string& AudioFrameWriter::forceEndUtteranceMessage() {
+    static const std::string message{ "{\"force_end_utterance\":true}" };
+    return message;
+}
+
+} // namespace Chat
+} // namespace XPlaneChatBot
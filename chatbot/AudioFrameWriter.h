@@ -0,0 +1,126 @@
+/**
+ * @file AudioFrameWriter.h
+ * @author zah
+ * @brief Allocation-free serialization of captured audio into websocket frames for the streaming STT endpoint
+ *
+ * Frames are written straight into recycled buffers taken from a FramePool, so steady-state streaming
+ * performs no heap allocation and no JSON DOM work. Two wire formats are supported:
+ * + Base64Json: the text frame {"audio_data":"<base64 PCM>"} expected by the AssemblyAI realtime API
+ * + BinaryPcm: raw little-endian int16 PCM in a binary frame, for endpoints that accept it (no 33% base64 overhead)
+ *
+ * @version 0.1
+ * @date 2024-03-11
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_CHAT_AUDIOFRAMEWRITER_H
+#define XPROTECTION_CHAT_AUDIOFRAMEWRITER_H
+
+#include "base/base64.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+
+namespace XPlaneChatBot {
+	namespace Chat {
+
+		/// @brief Wire format used for outgoing audio frames
+		enum class AudioFrameMode {
+			Base64Json, ///< Text frame {"audio_data":"..."} (AssemblyAI realtime default)
+			BinaryPcm, ///< Binary frame of raw int16 PCM
+		};
+
+		static const std::string audioFrameModeToString(const AudioFrameMode& mode) {
+			switch (mode) {
+			case AudioFrameMode::Base64Json: return "Base64Json";
+			case AudioFrameMode::BinaryPcm: return "BinaryPcm";
+			default: return "Unknown";
+			}
+		}
+
+		/// @brief Pool of reusable frame buffers; released buffers keep their capacity
+		class FramePool {
+		public:
+			/// @brief Returns the buffer to the pool when the frame goes out of scope
+			struct Releaser {
+				FramePool* pool;
+				void operator()(std::string* buffer) const { pool->release(buffer); }
+			};
+			using Frame = std::unique_ptr<std::string, Releaser>;
+
+			/**
+			 * @brief Construct the pool and preallocate its buffers
+			 * @param buffers Number of buffers to preallocate
+			 * @param bufferCapacity Capacity reserved in each buffer (largest frame expected)
+			 */
+			FramePool(size_t buffers, size_t bufferCapacity);
+			~FramePool();
+
+			FramePool(const FramePool&) = delete;
+			FramePool& operator=(const FramePool&) = delete;
+
+			/// @brief Take a buffer from the pool (allocates only if the pool is exhausted)
+			Frame acquire();
+
+			/// @brief Number of times acquire() had to allocate because the pool was empty
+			size_t misses() const { return m_misses; }
+
+		private:
+			void release(std::string* buffer);
+
+			std::vector<std::string*> m_free; ///< Buffers ready to be handed out
+			std::mutex m_mutex; ///< Protects m_free
+			size_t m_bufferCapacity; ///< Capacity reserved for new buffers
+			size_t m_misses{ 0 }; ///< Allocations caused by an empty pool
+		};
+
+		/// @brief Serializes int16 PCM chunks into websocket frames without intermediate copies
+		class AudioFrameWriter {
+		public:
+			/**
+			 * @brief Construct the writer
+			 * @param mode Wire format to produce
+			 * @param maxChunkSamples Largest chunk that will be written, used to size the pooled buffers
+			 */
+			AudioFrameWriter(AudioFrameMode mode, size_t maxChunkSamples);
+
+			/// @brief Change the wire format (only between sessions)
+			void setMode(AudioFrameMode mode) { m_mode = mode; }
+			AudioFrameMode getMode() const { return m_mode; }
+
+			/// @brief True if frames must be sent as binary websocket messages
+			bool isBinary() const { return m_mode == AudioFrameMode::BinaryPcm; }
+
+			/**
+			 * @brief Serialize a chunk of samples into a pooled frame
+			 * @param samples Interleaved int16 samples
+			 * @param count Number of samples
+			 * @return Frame ready to send; it returns to the pool when destroyed
+			 */
+			FramePool::Frame write(const int16_t* samples, size_t count);
+
+			/// @brief Exact size of the frame write() produces for count samples
+			size_t frameSize(size_t count) const;
+
+			/// @brief The terminate_session control message (always a text frame)
+			static const std::string& terminateMessage();
+
+			/// @brief The force_end_utterance control message, finalizes the current utterance without closing the session
+			static const std::string& forceEndUtteranceMessage();
+
+			/// @brief Number of frames that could not be served from the pool
+			size_t poolMisses() const { return m_pool.misses(); }
+
+		private:
+			AudioFrameMode m_mode; ///< Wire format
+			FramePool m_pool; ///< Recycled frame buffers
+		};
+
+	} // namespace Chat
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_CHAT_AUDIOFRAMEWRITER_H
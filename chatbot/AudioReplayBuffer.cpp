@@ -0,0 +1,128 @@
+/**
+ * @file AudioReplayBuffer.cpp
+ * @author zah
+ * @brief Implementation of the reconnect-safe audio replay buffer
+ * @see AudioReplayBuffer.h
+ * @version 0.1
+ * @date 2024-04-08
+ *
+ */
+
+#include "AudioReplayBuffer.h"
+
+#include <utility>
+
+namespace XPlaneChatBot {
+namespace Chat {
+
+
+AudioReplayBuffer::AudioReplayBuffer(int sampleRate, int channels, const ReplayConfig& config)
+    : m_config(config)
+    , m_sampleRate(sampleRate)
+    , m_channels(channels)
+{
+}
+
+void AudioReplayBuffer::setConfig(const ReplayConfig& config) {
+    m_config = config;
+    while (!m_pending.empty() && m_heldSamples * sizeof(int16_t) > m_config.memoryCapBytes) {
+        evictOldest();
+    }
+}
+
+void AudioReplayBuffer::append(const int16_t* samples, size_t count, uint64_t position, bool deferred, bool speech) {
+    // Make room first so the cap is never exceeded
+    while (!m_pending.empty() && (m_heldSamples + count) * sizeof(int16_t) > m_config.memoryCapBytes) {
+        evictOldest();
+    }
+
+    Chunk chunk;
+    if (!m_spare.empty()) {
+        chunk.samples = std::move(m_spare.back());
+        m_spare.pop_back();
+    }
+    chunk.samples.assign(samples, samples + count);
+    chunk.position = position;
+    chunk.captured = std::chrono::steady_clock::now();
+    chunk.deferred = deferred;
+    chunk.speech = speech;
+    m_heldSamples += count;
+    m_pending.push_back(std::move(chunk));
+}
+
+void AudioReplayBuffer::popFront() {
+    if (m_pending.empty()) {
+        return;
+    }
+    Chunk& chunk = m_pending.front();
+    if (chunk.deferred) {
+        m_stats.replayedMs += samplesToMs(chunk.samples.size());
+    }
+    m_heldSamples -= chunk.samples.size();
+    m_spare.push_back(std::move(chunk.samples));
+    m_pending.pop_front();
+}
+
+void AudioReplayBuffer::deferAll() {
+    for (auto& chunk : m_pending) {
+        chunk.deferred = true;
+    }
+}
+
+size_t AudioReplayBuffer::shedSilence() {
+    if (m_pending.size() < 2) {
+        return 0;
+    }
+    // The newest chunk may be the silence right before speech resumes, keep it as pre-roll
+    size_t shed = 0;
+    size_t i = 0;
+    while (i + 1 < m_pending.size()) {
+        Chunk& chunk = m_pending[i];
+        if (chunk.speech) {
+            ++i;
+            continue;
+        }
+        m_stats.silenceShedMs += samplesToMs(chunk.samples.size());
+        m_heldSamples -= chunk.samples.size();
+        m_spare.push_back(std::move(chunk.samples));
+        m_pending.erase(m_pending.begin() + static_cast<std::ptrdiff_t>(i));
+        ++shed;
+    }
+    return shed;
+}
+
+std::chrono::milliseconds AudioReplayBuffer::oldestAge(std::chrono::steady_clock::time_point now) const {
+    if (m_pending.empty()) {
+        return std::chrono::milliseconds(0);
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now - m_pending.front().captured);
+}
+
+void AudioReplayBuffer::clear() {
+    while (!m_pending.empty()) {
+        evictOldest();
+    }
+}
+
+void AudioReplayBuffer::evictOldest() {
+    Chunk& chunk = m_pending.front();
+    m_stats.droppedMs += samplesToMs(chunk.samples.size());
+    ++m_stats.droppedChunks;
+    m_heldSamples -= chunk.samples.size();
+    m_spare.push_back(std::move(chunk.samples));
+    m_pending.pop_front();
+}
+
+ReplayStats AudioReplayBuffer::getStats() const {
+    ReplayStats stats = m_stats;
+    stats.pendingMs = samplesToMs(m_heldSamples);
+    stats.memoryBytes = m_heldSamples * sizeof(int16_t);
+    return stats;
+}
+
+uint64_t AudioReplayBuffer::samplesToMs(size_t samples) const {
+    return static_cast<uint64_t>(samples) * 1000 / (static_cast<uint64_t>(m_sampleRate) * m_channels);
+}
+
+} // namespace Chat
+} // namespace XPlaneChatBot
@@ -0,0 +1,124 @@
+/**
+ * @file AudioReplayBuffer.h
+ * @author zah
+ * @brief Bounded, time-indexed store of captured audio that has to reach the STT server
+ *
+ * Every chunk the sender decides to stream is appended here with its capture position before it is sent.
+ * While the websocket is reconnecting the chunks simply stay pending; once it is open again the sender replays
+ * the pending tail in bursts (faster than real time) and then carries on with live audio. Memory is capped;
+ * when the cap is hit the oldest audio is evicted and accounted as dropped.
+ *
+ * @version 0.1
+ * @date 2024-04-08
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_CHAT_AUDIOREPLAYBUFFER_H
+#define XPROTECTION_CHAT_AUDIOREPLAYBUFFER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace XPlaneChatBot {
+	namespace Chat {
+
+		/// @brief Tuning parameters for the replay buffer
+		struct ReplayConfig {
+			size_t memoryCapBytes{ 640 * 1024 }; ///< Maximum audio kept (20 s of 16 kHz mono int16)
+			int maxBurstChunks{ 5 }; ///< Pending chunks sent per sender tick while catching up
+		};
+
+		/// @brief Replay accounting (see IXTranscriber::get_replay_stats)
+		struct ReplayStats {
+			uint64_t reconnects{ 0 }; ///< Times the socket came back after being down mid-session
+			uint64_t replayedMs{ 0 }; ///< Audio sent late, after waiting for the socket
+			uint64_t droppedMs{ 0 }; ///< Unsent audio evicted because of the memory cap or a session end
+			uint64_t droppedChunks{ 0 }; ///< Chunks making up droppedMs
+			uint64_t silenceShedMs{ 0 }; ///< Silent audio discarded on purpose to catch up (not counted in droppedMs)
+			uint64_t pendingMs{ 0 }; ///< Audio currently waiting to be sent
+			size_t memoryBytes{ 0 }; ///< Audio currently held
+		};
+
+		/// @brief Single-threaded replay store (owned by the transcriber's sender thread)
+		class AudioReplayBuffer {
+		public:
+			/// @brief A chunk waiting to be sent
+			struct Chunk {
+				std::vector<int16_t> samples; ///< Interleaved samples
+				uint64_t position{ 0 }; ///< Capture position of the first sample
+				std::chrono::steady_clock::time_point captured{}; ///< When the chunk was read from the capture ring
+				bool deferred{ false }; ///< True if it could not be sent when it was captured
+				bool speech{ true }; ///< False if the voice activity detector heard no speech in it
+			};
+
+			/**
+			 * @brief Construct the buffer
+			 * @param sampleRate Samples per second per channel
+			 * @param channels Interleaved channel count
+			 * @param config Memory cap and replay burst size
+			 */
+			AudioReplayBuffer(int sampleRate, int channels, const ReplayConfig& config = ReplayConfig{});
+
+			void setConfig(const ReplayConfig& config);
+			const ReplayConfig& getConfig() const { return m_config; }
+
+			/**
+			 * @brief Queue a chunk for sending
+			 * @param deferred True if the socket is not able to take it right now
+			 * @param speech False for silence, which may be shed under backpressure
+			 */
+			void append(const int16_t* samples, size_t count, uint64_t position, bool deferred, bool speech = true);
+
+			/// @brief Oldest chunk waiting to be sent, or nullptr
+			const Chunk* front() const { return m_pending.empty() ? nullptr : &m_pending.front(); }
+
+			/// @brief Pending chunk by age (0 is the oldest), or nullptr
+			const Chunk* pending(size_t index) const { return index < m_pending.size() ? &m_pending[index] : nullptr; }
+
+			/// @brief Mark the oldest chunk as sent; its storage is recycled
+			void popFront();
+
+			/// @brief Mark every pending chunk as deferred (the socket went down)
+			void deferAll();
+
+			/**
+			 * @brief Discard pending silent chunks, keeping speech and the newest chunk
+			 * @return Number of chunks discarded
+			 */
+			size_t shedSilence();
+
+			/// @brief How long the oldest pending chunk has been waiting (zero if nothing is pending)
+			std::chrono::milliseconds oldestAge(std::chrono::steady_clock::time_point now) const;
+
+			/// @brief Drop everything pending; counted as dropped audio
+			void clear();
+
+			/// @brief Number of chunks waiting
+			size_t pendingChunks() const { return m_pending.size(); }
+
+			/// @brief Record that the socket came back after an outage
+			void noteReconnect() { ++m_stats.reconnects; }
+
+			ReplayStats getStats() const;
+
+		private:
+			uint64_t samplesToMs(size_t samples) const;
+			void evictOldest();
+
+			ReplayConfig m_config;
+			const int m_sampleRate;
+			const int m_channels;
+			std::deque<Chunk> m_pending; ///< Chunks in capture order
+			std::vector<std::vector<int16_t>> m_spare; ///< Recycled chunk storage
+			size_t m_heldSamples{ 0 }; ///< Samples currently held in m_pending
+			ReplayStats m_stats;
+		};
+
+	} // namespace Chat
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_CHAT_AUDIOREPLAYBUFFER_H
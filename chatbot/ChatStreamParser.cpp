@@ -0,0 +1,393 @@
+/**
+ * @file ChatStreamParser.cpp
+ * @author zah
+ * @brief Implementation of the chat completion stream parser
+ * @see ChatStreamParser.h
+ * @version 0.1
+ * @date 2024-06-10
+ *
+ */
+
+#include "ChatStreamParser.h"
+
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+namespace XPlaneChatBot {
+namespace Chat {
+
+namespace {
+    constexpr size_t npos = std::string_view::npos;
+    constexpr size_t kMaxDepth = 16; ///< Deeper events are left to the JSON parser
+
+    /// @brief Find the blank line ending an event: returns its position and sets the delimiter length
+    size_t findEventEnd(std::string_view data, size_t from, size_t& delimiter) {
+        while (from < data.size()) {
+            const void* found = std::memchr(data.data() + from, '\n', data.size() - from);
+            if (found == nullptr) {
+                return npos;
+            }
+            const size_t newline = static_cast<size_t>(static_cast<const char*>(found) - data.data());
+            if (newline + 1 < data.size() && data[newline + 1] == '\n') {
+                delimiter = 2;
+                return newline;
+            }
+            if (newline + 2 < data.size() && data[newline + 1] == '\r' && data[newline + 2] == '\n') {
+                delimiter = 3;
+                return newline;
+            }
+            from = newline + 1;
+        }
+        return npos;
+    }
+
+    bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+    size_t skipSpace(std::string_view json, size_t pos) {
+        while (pos < json.size() && isSpace(json[pos])) {
+            ++pos;
+        }
+        return pos;
+    }
+
+    /// @brief Skip the JSON string opening at pos; returns the position after its closing quote, or npos
+    size_t skipString(std::string_view json, size_t pos, bool& escaped) {
+        for (size_t i = pos + 1; i < json.size(); ++i) {
+            i = json.find_first_of("\"\\", i);
+            if (i == npos) {
+                return npos;
+            }
+            if (json[i] == '"') {
+                return i + 1;
+            }
+            escaped = true;
+            ++i; // Skip the escaped character
+        }
+        return npos;
+    }
+
+    bool parseHex4(std::string_view text, size_t pos, uint32_t& value) {
+        if (pos + 4 > text.size()) {
+            return false;
+        }
+        value = 0;
+        for (size_t i = pos; i < pos + 4; ++i) {
+            const char c = text[i];
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= static_cast<uint32_t>(c - '0');
+            else if (c >= 'a' && c <= 'f') value |= static_cast<uint32_t>(c - 'a' + 10);
+            else if (c >= 'A' && c <= 'F') value |= static_cast<uint32_t>(c - 'A' + 10);
+            else return false;
+        }
+        return true;
+    }
+
+    void appendUtf8(uint32_t codePoint, std::string& out) {
+        if (codePoint < 0x80) {
+            out += static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800) {
+            out += static_cast<char>(0xC0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000) {
+            out += static_cast<char>(0xE0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else {
+            out += static_cast<char>(0xF0 | (codePoint >> 18));
+            out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    /// @brief Resolve the escapes of a JSON string body (without its quotes); false if an escape is invalid
+    bool unescape(std::string_view raw, std::string& out) {
+        out.clear();
+        out.reserve(raw.size());
+        for (size_t i = 0; i < raw.size(); ++i) {
+            const size_t backslash = raw.find('\\', i);
+            out.append(raw.substr(i, backslash == npos ? npos : backslash - i));
+            if (backslash == npos) {
+                break;
+            }
+            i = backslash + 1;
+            if (i >= raw.size()) {
+                return false;
+            }
+            switch (raw[i]) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                uint32_t codePoint = 0;
+                if (!parseHex4(raw, i + 1, codePoint)) {
+                    return false;
+                }
+                i += 4;
+                if (codePoint >= 0xD800 && codePoint <= 0xDBFF) { // High surrogate, the low one must follow
+                    uint32_t low = 0;
+                    if (i + 2 >= raw.size() || raw[i + 1] != '\\' || raw[i + 2] != 'u' || !parseHex4(raw, i + 3, low)
+                        || low < 0xDC00 || low > 0xDFFF) {
+                        return false;
+                    }
+                    i += 6;
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+                else if (codePoint >= 0xDC00 && codePoint <= 0xDFFF) {
+                    return false;
+                }
+                appendUtf8(codePoint, out);
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+
+void ChatStreamParser::reset() {
+    m_pending.clear();
+    m_finished = false;
+}
+
+bool ChatStreamParser::feed(std::string_view data, const DeltaCallback& onDelta) {
+    m_stats.bytes += data.size();
+    if (m_finished) {
+        return true;
+    }
+
+    if (!m_pending.empty()) {
+        // Complete the split event: copy only up to the first blank line of data (it may also straddle the two)
+        size_t delimiter = 0;
+        const size_t end = findEventEnd(data, 0, delimiter);
+        const std::string_view head = end == npos ? data : data.substr(0, end + delimiter);
+        const size_t oldSize = m_pending.size();
+        m_pending.append(head);
+        m_stats.bufferedBytes += head.size();
+
+        const size_t consumed = parseEvents(m_pending, oldSize > 3 ? oldSize - 3 : 0, onDelta, 1);
+        if (consumed == 0) {
+            return m_finished; // Still incomplete, all of data is buffered
+        }
+        data.remove_prefix(consumed - oldSize);
+        m_pending.clear();
+        if (m_finished) {
+            return true;
+        }
+    }
+
+    // The rest is parsed where curl left it; only an unfinished last event is copied
+    const size_t consumed = parseEvents(data, 0, onDelta);
+    if (!m_finished && consumed < data.size()) {
+        m_pending.assign(data.substr(consumed));
+        m_stats.bufferedBytes += m_pending.size();
+    }
+    return m_finished;
+}
+
+size_t ChatStreamParser::parseEvents(std::string_view data, size_t searchFrom, const DeltaCallback& onDelta, size_t maxEvents) {
+    size_t consumed = 0;
+    for (size_t count = 0; count < maxEvents && !m_finished; ++count) {
+        size_t delimiter = 0;
+        const size_t end = findEventEnd(data, std::max(consumed, searchFrom), delimiter);
+        if (end == npos) {
+            break;
+        }
+        parseEvent(data.substr(consumed, end - consumed), onDelta);
+        consumed = end + delimiter;
+    }
+    return consumed;
+}
+
+void ChatStreamParser::parseEvent(std::string_view event, const DeltaCallback& onDelta) {
+    std::string_view data;
+    size_t dataLines = 0;
+    while (!event.empty()) {
+        const size_t newline = event.find('\n');
+        std::string_view line = event.substr(0, newline);
+        event.remove_prefix(newline == npos ? event.size() : newline + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.empty() || line.front() == ':') {
+            continue; // Comment (keep-alive)
+        }
+        const size_t colon = line.find(':');
+        if (line.substr(0, colon) != "data") {
+            continue; // event:, id:, retry: are not used by the API
+        }
+        std::string_view value = colon == npos ? std::string_view() : line.substr(colon + 1);
+        if (!value.empty() && value.front() == ' ') {
+            value.remove_prefix(1);
+        }
+        // Several data lines make one value joined with newlines
+        if (dataLines == 0) {
+            data = value;
+        }
+        else {
+            if (dataLines == 1) {
+                m_data.assign(data);
+            }
+            m_data += '\n';
+            m_data.append(value);
+            data = m_data;
+        }
+        ++dataLines;
+    }
+    if (dataLines > 0) {
+        parseData(data, onDelta);
+    }
+}
+
+void ChatStreamParser::parseData(std::string_view data, const DeltaCallback& onDelta) {
+    ++m_stats.events;
+    if (data == "[DONE]") {
+        m_finished = true;
+        return;
+    }
+    if (scanDelta(data, onDelta)) {
+        ++m_stats.scanned;
+        return;
+    }
+    ++m_stats.fallbacks;
+    parseJson(data, onDelta);
+}
+
+bool ChatStreamParser::scanDelta(std::string_view json, const DeltaCallback& onDelta) {
+    std::string_view containerKeys[kMaxDepth]; ///< Key that introduced each open object or array
+    size_t depth = 0;
+    std::string_view key; ///< Key whose value comes next
+    bool sawChoices = false;
+    size_t deltas = 0;
+    bool hasContent = false;
+    bool contentEscaped = false;
+    std::string_view content; ///< Raw string body, escapes unresolved
+    bool finished = false;
+
+    // Nothing is reported until the whole event has been walked, so a failed scan has no side effects
+    size_t pos = 0;
+    while (pos < json.size()) {
+        const char c = json[pos];
+        if (c == '{' || c == '[') {
+            if (depth == kMaxDepth) {
+                return false;
+            }
+            if (c == '{' && key == "delta") {
+                ++deltas;
+            }
+            containerKeys[depth++] = key;
+            key = {};
+            ++pos;
+        }
+        else if (c == '}' || c == ']') {
+            if (depth == 0) {
+                return false;
+            }
+            --depth;
+            key = {};
+            ++pos;
+        }
+        else if (c == ',') {
+            key = {};
+            ++pos;
+        }
+        else if (c == '"') {
+            bool escaped = false;
+            const size_t end = skipString(json, pos, escaped);
+            if (end == npos) {
+                return false;
+            }
+            const size_t next = skipSpace(json, end);
+            if (next >= json.size() || json[next] != ':') {
+                key = {}; // A string value
+                pos = end;
+                continue;
+            }
+            key = json.substr(pos + 1, end - pos - 2);
+            pos = skipSpace(json, next + 1);
+            if (key == "choices") {
+                sawChoices = true;
+            }
+            else if (key == "content" && depth > 0 && containerKeys[depth - 1] == "delta") {
+                if (json.compare(pos, 4, "null") == 0) {
+                    pos += 4;
+                }
+                else if (pos < json.size() && json[pos] == '"') {
+                    const size_t valueEnd = skipString(json, pos, contentEscaped);
+                    if (valueEnd == npos || hasContent) {
+                        return false;
+                    }
+                    hasContent = true;
+                    content = json.substr(pos + 1, valueEnd - pos - 2);
+                    pos = valueEnd;
+                }
+                else {
+                    return false;
+                }
+                key = {};
+            }
+            else if (key == "finish_reason") {
+                if (pos < json.size() && json[pos] == '"') {
+                    finished = true;
+                }
+                else if (json.compare(pos, 4, "null") != 0) {
+                    return false;
+                }
+            }
+        }
+        else {
+            ++pos; // Whitespace, colons, numbers and literals
+        }
+    }
+    if (depth != 0 || !sawChoices || deltas > 1) {
+        return false; // Truncated, not a completion chunk, or several choices
+    }
+
+    if (hasContent && !content.empty()) {
+        if (contentEscaped) {
+            if (!unescape(content, m_unescaped)) {
+                return false;
+            }
+            content = m_unescaped;
+        }
+        onDelta(content);
+    }
+    if (finished) {
+        m_finished = true;
+    }
+    return true;
+}
+
+void ChatStreamParser::parseJson(std::string_view json, const DeltaCallback& onDelta) {
+    nlohmann::json parsed = nlohmann::json::parse(json.begin(), json.end(), nullptr, false);
+    if (parsed.is_discarded() || !parsed.is_object() || !parsed.contains("choices") || !parsed["choices"].is_array()) {
+        return; // Not a completion chunk, continue with the next event
+    }
+    for (const auto& choice : parsed["choices"]) {
+        if (choice.contains("delta") && choice["delta"].contains("content") && choice["delta"]["content"].is_string()) {
+            const std::string& chunk = choice["delta"]["content"].get_ref<const std::string&>();
+            if (!chunk.empty()) {
+                onDelta(chunk);
+            }
+        }
+        if (choice.contains("finish_reason") && !choice["finish_reason"].is_null()) {
+            m_finished = true;
+        }
+    }
+}
+
+} // namespace Chat
+} // namespace XPlaneChatBot
@@ -0,0 +1,90 @@
+/**
+ * @file ChatStreamParser.h
+ * @author zah
+ * @brief Parser for the server-sent events of a streamed chat completion
+ *
+ * Bytes are fed as they arrive from the network, events may be split across feeds. Complete events are parsed in
+ * place: only the bytes of an unfinished event are kept between feeds, and the buffer holding them is compacted once
+ * per feed rather than once per event. The content delta and finish_reason are picked out of each event by a small
+ * scanner; a full JSON parse is only done for events the scanner does not recognize. The stream ends with the
+ * "[DONE]" event or with a non-null finish_reason.
+ *
+ * @version 0.1
+ * @date 2024-06-10
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_CHAT_CHATSTREAMPARSER_H
+#define XPROTECTION_CHAT_CHATSTREAMPARSER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace XPlaneChatBot {
+	namespace Chat {
+
+		/// @brief Event counters of a ChatStreamParser
+		struct StreamParserStats {
+			uint64_t bytes{ 0 }; ///< Bytes fed
+			uint64_t events{ 0 }; ///< Data events parsed
+			uint64_t scanned{ 0 }; ///< Events handled by the delta scanner
+			uint64_t fallbacks{ 0 }; ///< Events that needed the full JSON parse
+			uint64_t bufferedBytes{ 0 }; ///< Bytes copied because an event was split across feeds
+		};
+
+		/// @brief Incremental parser of a chat/completions SSE stream
+		class ChatStreamParser {
+		public:
+			/// @brief Receives a content delta; the view is only valid during the call
+			using DeltaCallback = std::function<void(std::string_view delta)>;
+
+			/**
+			 * @brief Parse newly received bytes
+			 * @param data Bytes received from the network
+			 * @param onDelta Called with the content of each complete event
+			 * @return True once the completion has finished ([DONE] or finish_reason received)
+			 */
+			bool feed(std::string_view data, const DeltaCallback& onDelta);
+
+			bool finished() const { return m_finished; }
+
+			/// @brief Forget buffered bytes and start a new stream (the statistics are kept)
+			void reset();
+
+			const StreamParserStats& getStats() const { return m_stats; }
+
+		private:
+			/**
+			 * @brief Parse the complete events at the start of data
+			 * @param searchFrom Where to start looking for the end of the first event
+			 * @param maxEvents Stop after this many events
+			 * @return Number of bytes consumed
+			 */
+			size_t parseEvents(std::string_view data, size_t searchFrom, const DeltaCallback& onDelta, size_t maxEvents = std::string_view::npos);
+
+			/// @brief Handle one event (without its terminating blank line)
+			void parseEvent(std::string_view event, const DeltaCallback& onDelta);
+
+			/// @brief Handle the data of one event
+			void parseData(std::string_view data, const DeltaCallback& onDelta);
+
+			/// @brief Targeted scan for choices[0].delta.content and finish_reason; false if the event needs parseJson
+			bool scanDelta(std::string_view json, const DeltaCallback& onDelta);
+
+			/// @brief Full JSON parse of an event (any number of choices, unusual layouts)
+			void parseJson(std::string_view json, const DeltaCallback& onDelta);
+
+			std::string m_pending; ///< Bytes of the unfinished event
+			std::string m_data; ///< Joined value of a multi-line data field
+			std::string m_unescaped; ///< Content delta with its JSON escapes resolved
+			bool m_finished{ false };
+			StreamParserStats m_stats;
+		};
+
+	} // namespace Chat
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_CHAT_CHATSTREAMPARSER_H
@@ -0,0 +1,156 @@
+/**
+ * @file DecodeWorker.cpp
+ * @author zah
+ * @brief Implementation of the TTS decode worker
+ * @see DecodeWorker.h
+ * @version 0.1
+ * @date 2024-07-08
+ *
+ */
+
+#include "DecodeWorker.h"
+
+#include "base/logger.h"
+#include "chatbot/openai.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+namespace XPlaneChatBot {
+namespace openai {
+
+namespace {
+    /// Windowed streams are topped up at least this often while they hold undecoded audio (a tenth of the default window)
+    constexpr std::chrono::milliseconds kTopUpInterval{ 20 };
+
+    double toMs(std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+}
+
+
+DecodeWorker& DecodeWorker::instance() {
+    static DecodeWorker worker;
+    return worker;
+}
+
+DecodeWorker::~DecodeWorker() {
+    stop();
+}
+
+void DecodeWorker::add(std::shared_ptr<SharedAudioData> audio) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_stopping) {
+        lock.unlock();
+        Base::Logger::log("Decode worker is stopped, stream not decoded", Base::ERR, __FUNCTION__);
+        audio->cancel(); // Do not leave the player waiting
+        return;
+    }
+    m_streams.push_back(std::move(audio));
+    ++m_stats.streams;
+    m_stats.activeStreams = m_streams.size();
+    m_stats.peakActiveStreams = std::max(m_stats.peakActiveStreams, m_streams.size());
+    if (!m_thread.joinable()) {
+        m_thread = std::thread(&DecodeWorker::run, this);
+    }
+}
+
+void DecodeWorker::notify() {
+    if (m_pending.exchange(true)) {
+        return; // The worker has not started the pass that will see it yet
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex); // Orders the wake-up after the worker's predicate check
+    }
+    m_wake.notify_one();
+}
+
+void DecodeWorker::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping) {
+            return;
+        }
+        m_stopping = true;
+    }
+    m_wake.notify_one();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const std::shared_ptr<SharedAudioData>& audio : m_streams) {
+        audio->cancel();
+    }
+    m_streams.clear();
+    m_stats.activeStreams = 0;
+    Base::Logger::log("Decode worker stopped", Base::DEBUG, __FUNCTION__);
+}
+
+DecodeStats DecodeWorker::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void DecodeWorker::run() {
+    std::vector<std::shared_ptr<SharedAudioData>> streams; // Decoded without holding the lock
+    std::unique_lock<std::mutex> lock(m_mutex);
+    bool topUp = false; // A stream held audio back for its window in the last pass
+    while (true) {
+        const auto woken = [this] { return m_stopping || m_pending.load(); };
+        if (topUp) {
+            // Playback drains the windows without notifying, so poll while they have something left to decode
+            if (!m_wake.wait_for(lock, kTopUpInterval, woken)) {
+                ++m_stats.topUpPasses;
+            }
+        }
+        else {
+            m_wake.wait(lock, woken);
+        }
+        if (m_stopping) {
+            return;
+        }
+        m_pending = false; // Bytes queued from here on trigger another pass
+        streams.assign(m_streams.begin(), m_streams.end());
+        lock.unlock();
+
+        uint64_t bytes = 0;
+        size_t samples = 0;
+        size_t pendingBytes = 0;
+        double aheadMs = 0.0;
+        bool finished = false;
+        topUp = false;
+        const auto start = std::chrono::steady_clock::now();
+        for (const std::shared_ptr<SharedAudioData>& audio : streams) {
+            size_t consumed = 0;
+            samples += audio->decodePending(&consumed);
+            bytes += consumed;
+            pendingBytes += audio->pendingEncodedBytes();
+            aheadMs += 1000.0 * static_cast<double>(audio->bufferedSamples()) / (static_cast<double>(audio->getOutputRate()) * CHANNELS);
+            finished = finished || audio->isEndOfData();
+            topUp = topUp || (audio->isWindowed() && audio->hasUndecodedData());
+        }
+        const double passMs = toMs(std::chrono::steady_clock::now() - start);
+        streams.clear(); // The worker must not keep finished streams alive
+
+        lock.lock();
+        if (finished) {
+            m_streams.erase(std::remove_if(m_streams.begin(), m_streams.end(),
+                [](const std::shared_ptr<SharedAudioData>& audio) { return audio->isEndOfData(); }), m_streams.end());
+        }
+        ++m_stats.passes;
+        m_stats.activeStreams = m_streams.size();
+        m_stats.bytesDecoded += bytes;
+        m_stats.audioDecodedMs += 1000.0 * static_cast<double>(samples) / (static_cast<double>(SAMPLE_RATE) * CHANNELS);
+        m_stats.decodeMs += passMs;
+        m_stats.maxPassMs = std::max(m_stats.maxPassMs, passMs);
+        if (m_stats.audioDecodedMs > 0.0) {
+            m_stats.realtimeFactor = m_stats.decodeMs / m_stats.audioDecodedMs;
+        }
+        m_stats.pendingBytes = pendingBytes;
+        m_stats.decodeAheadMs = aheadMs;
+        m_stats.peakDecodeAheadMs = std::max(m_stats.peakDecodeAheadMs, aheadMs);
+    }
+}
+
+} // namespace openai
+} // namespace XPlaneChatBot
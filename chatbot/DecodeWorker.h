@@ -0,0 +1,89 @@
+/**
+ * @file DecodeWorker.h
+ * @author zah
+ * @brief Decode stage of the TTS audio: one thread decodes the Ogg Opus streams of every request in flight
+ *
+ * The HTTP engine's data callback only copies the received bytes into the request's SharedAudioData byte queue and
+ * wakes the worker, so socket reads are never held up by Ogg page sync, Opus decoding, resampling or logging. The
+ * worker then decodes, in one pass, whatever every registered stream has queued, and signals end of data on a stream
+ * once its download is complete and its last bytes are decoded.
+ *
+ * Streams with a decode window are only decoded a little ahead of playback; while one of them holds audio back, the
+ * worker also wakes on a short timer to top its window up as the player drains it.
+ *
+ * @version 0.1
+ * @date 2024-07-08
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XP_DECODE_WORKER_H_
+#define XP_DECODE_WORKER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace XPlaneChatBot {
+namespace openai {
+    class SharedAudioData;
+
+    /// @brief Decode worker activity
+    struct DecodeStats {
+        uint64_t streams{ 0 }; ///< Streams registered
+        size_t activeStreams{ 0 }; ///< Streams not fully decoded yet
+        size_t peakActiveStreams{ 0 };
+        uint64_t passes{ 0 }; ///< Passes over the active streams
+        uint64_t topUpPasses{ 0 }; ///< Of which started by the window timer rather than new bytes
+        uint64_t bytesDecoded{ 0 }; ///< Ogg Opus bytes consumed
+        double audioDecodedMs{ 0.0 }; ///< Audio produced
+        double decodeMs{ 0.0 }; ///< Time spent decoding (the worker never blocks while decoding, so this is its CPU time)
+        double maxPassMs{ 0.0 }; ///< Longest pass
+        double realtimeFactor{ 0.0 }; ///< decodeMs / audioDecodedMs
+        size_t pendingBytes{ 0 }; ///< Received and not yet decoded, over the active streams, after the last pass
+        double decodeAheadMs{ 0.0 }; ///< Decoded and not yet played, over the active streams, after the last pass
+        double peakDecodeAheadMs{ 0.0 };
+    };
+
+    /// @brief Process-wide decode thread for the TTS streams
+    class DecodeWorker {
+    public:
+        /// @brief The process-wide worker (its thread starts with the first stream)
+        static DecodeWorker& instance();
+
+        DecodeWorker(const DecodeWorker&) = delete;
+        DecodeWorker& operator=(const DecodeWorker&) = delete;
+
+        /// @brief Decode a stream until it ends or is cancelled (call before its request starts)
+        void add(std::shared_ptr<SharedAudioData> audio);
+
+        /// @brief New bytes were queued or a download finished (any thread, cheap enough for the data callback)
+        void notify();
+
+        /// @brief Cancel the streams left and join the thread (call before the plugin is unloaded)
+        void stop();
+
+        DecodeStats getStats() const;
+
+    private:
+        DecodeWorker() = default;
+        ~DecodeWorker();
+
+        void run();
+
+        std::thread m_thread;
+        mutable std::mutex m_mutex; ///< Guards m_streams, m_stopping and m_stats
+        std::condition_variable m_wake;
+        std::atomic<bool> m_pending{ false }; ///< Set by notify(), cleared by the worker before each pass
+        std::vector<std::shared_ptr<SharedAudioData>> m_streams; ///< Active streams
+        bool m_stopping{ false };
+        DecodeStats m_stats;
+    };
+
+} // namespace openai
+} // namespace XPlaneChatBot
+#endif // XP_DECODE_WORKER_H_
@@ -0,0 +1,157 @@
+/**
+ * @file HttpConnectionPool.cpp
+ * @author zah
+ * @brief Implementation of the curl handle pool
+ * @see HttpConnectionPool.h
+ * @version 0.1
+ * @date 2024-05-27
+ *
+ */
+
+#include "HttpConnectionPool.h"
+
+#include "base/logger.h"
+
+#include <algorithm>
+#include <string>
+
+namespace XPlaneChatBot {
+namespace openai {
+
+HttpConnectionPool& HttpConnectionPool::instance() {
+    static HttpConnectionPool pool;
+    return pool;
+}
+
+HttpConnectionPool::HttpConnectionPool() {
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    m_share = curl_share_init();
+    if (m_share == nullptr) {
+        Base::Logger::log("curl_share_init() failed, handles will not share caches", Base::ERR, __FUNCTION__);
+        return;
+    }
+    curl_share_setopt(m_share, CURLSHOPT_LOCKFUNC, &HttpConnectionPool::lockShared);
+    curl_share_setopt(m_share, CURLSHOPT_UNLOCKFUNC, &HttpConnectionPool::unlockShared);
+    curl_share_setopt(m_share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900 // 7.57.0
+    curl_share_setopt(m_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+}
+
+HttpConnectionPool::~HttpConnectionPool() {
+    for (CURL* handle : m_idle) {
+        curl_easy_cleanup(handle);
+    }
+    m_idle.clear();
+    if (m_share) {
+        curl_share_cleanup(m_share);
+    }
+    curl_global_cleanup();
+}
+
+void HttpConnectionPool::lockShared(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+    static_cast<HttpConnectionPool*>(userptr)->m_shareLocks[data].lock();
+}
+
+void HttpConnectionPool::unlockShared(CURL*, curl_lock_data data, void* userptr) {
+    static_cast<HttpConnectionPool*>(userptr)->m_shareLocks[data].unlock();
+}
+
+void HttpConnectionPool::configure(CURL* handle) const {
+    if (m_share) {
+        curl_easy_setopt(handle, CURLOPT_SHARE, m_share);
+    }
+    curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS); // HTTP/2 when the server offers it over TLS
+    curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L); // Prefer multiplexing on an existing connection to opening a new one
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPIDLE, 30L);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPINTVL, 15L);
+    curl_easy_setopt(handle, CURLOPT_TCP_NODELAY, 1L);
+    curl_easy_setopt(handle, CURLOPT_DNS_CACHE_TIMEOUT, 300L);
+    curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L); // Handles are used from several threads
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, 0L); // Ignore SSL (as before)
+}
+
+HttpConnectionPool::Lease HttpConnectionPool::acquire() {
+    CURL* handle = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.leases;
+        if (!m_idle.empty()) {
+            handle = m_idle.back();
+            m_idle.pop_back();
+        }
+    }
+    if (handle) {
+        curl_easy_reset(handle); // Clears the options of the last request; keeps its connections and caches
+    }
+    else {
+        handle = curl_easy_init();
+        if (handle == nullptr) {
+            Base::Logger::log("curl_easy_init() failed", Base::ERR, __FUNCTION__);
+            return Lease(this, nullptr);
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_stats.handlesCreated;
+    }
+    configure(handle);
+    return Lease(this, handle);
+}
+
+void HttpConnectionPool::giveBack(CURL* handle) {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_idle.size() < kMaxIdleHandles) {
+        m_idle.push_back(handle);
+        return;
+    }
+    lock.unlock();
+    curl_easy_cleanup(handle);
+}
+
+void HttpConnectionPool::recordRequest(CURL* handle) {
+    long newConnections = 0;
+    long httpVersion = 0;
+    curl_off_t connectUs = 0;
+    curl_off_t appConnectUs = 0;
+    curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &newConnections);
+    curl_easy_getinfo(handle, CURLINFO_HTTP_VERSION, &httpVersion);
+    curl_easy_getinfo(handle, CURLINFO_CONNECT_TIME_T, &connectUs);
+    curl_easy_getinfo(handle, CURLINFO_APPCONNECT_TIME_T, &appConnectUs);
+    const double setupMs = static_cast<double>(std::max(connectUs, appConnectUs)) / 1000.0; // TLS done, or TCP for plain HTTP
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.requests;
+    if (httpVersion == CURL_HTTP_VERSION_2_0) {
+        ++m_stats.http2Requests;
+    }
+    if (newConnections > 0) {
+        ++m_stats.freshConnections;
+        m_freshSetupTotalMs += setupMs;
+    }
+    else {
+        ++m_stats.reusedConnections;
+        m_reusedSetupTotalMs += setupMs;
+    }
+}
+
+PoolStats HttpConnectionPool::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    PoolStats stats = m_stats;
+    stats.idleHandles = m_idle.size();
+    if (stats.freshConnections > 0) {
+        stats.freshSetupMs = m_freshSetupTotalMs / static_cast<double>(stats.freshConnections);
+    }
+    if (stats.reusedConnections > 0) {
+        stats.reusedSetupMs = m_reusedSetupTotalMs / static_cast<double>(stats.reusedConnections);
+    }
+    if (stats.freshConnections > 0) {
+        stats.savedSetupMs = std::max(0.0, stats.freshSetupMs - stats.reusedSetupMs) * static_cast<double>(stats.reusedConnections);
+    }
+    return stats;
+}
+
+} // namespace openai
+} // namespace XPlaneChatBot
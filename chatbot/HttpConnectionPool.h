@@ -0,0 +1,117 @@
+/**
+ * @file HttpConnectionPool.h
+ * @author zah
+ * @brief Process-wide pool of long-lived curl handles for the OpenAI client
+ *
+ * Handles are borrowed for one request and handed back afterwards, so the connections they keep alive (and the
+ * DNS, TLS session and connection caches shared between them) survive from one request to the next. A request on a
+ * warm handle skips DNS resolution and the TCP and TLS handshakes. HTTP/2 is negotiated when the server offers it.
+ *
+ * @version 0.1
+ * @date 2024-05-27
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XP_HTTP_CONNECTION_POOL_H_
+#define XP_HTTP_CONNECTION_POOL_H_
+
+#include <curl/curl.h>
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace XPlaneChatBot {
+namespace openai {
+    /// @brief Handle and connection reuse statistics of the pool
+    struct PoolStats {
+        uint64_t handlesCreated{ 0 }; ///< curl easy handles created
+        uint64_t leases{ 0 }; ///< Requests that borrowed a handle
+        uint64_t requests{ 0 }; ///< Requests whose timings were recorded
+        uint64_t freshConnections{ 0 }; ///< Requests that had to open a new connection
+        uint64_t reusedConnections{ 0 }; ///< Requests sent on a kept-alive connection
+        uint64_t http2Requests{ 0 }; ///< Requests answered over HTTP/2
+        double freshSetupMs{ 0.0 }; ///< Average DNS + TCP + TLS time of the fresh connections
+        double reusedSetupMs{ 0.0 }; ///< Average setup time of the reused connections
+        double savedSetupMs{ 0.0 }; ///< Estimated setup time saved by reuse (reused requests x difference of the averages)
+        size_t idleHandles{ 0 };
+    };
+
+    /// @brief Pool of configured curl easy handles sharing DNS, TLS session and connection caches
+    class HttpConnectionPool {
+    public:
+        /// @brief A handle borrowed from the pool, returned when destroyed
+        class Lease {
+        public:
+            Lease(HttpConnectionPool* pool, CURL* handle) : m_pool(pool), m_handle(handle) {}
+            ~Lease() { release(); }
+
+            Lease(Lease&& other) noexcept : m_pool(other.m_pool), m_handle(other.m_handle) { other.m_handle = nullptr; }
+            Lease& operator=(Lease&& other) noexcept {
+                if (this != &other) {
+                    release();
+                    m_pool = other.m_pool;
+                    m_handle = other.m_handle;
+                    other.m_handle = nullptr;
+                }
+                return *this;
+            }
+            Lease(const Lease&) = delete;
+            Lease& operator=(const Lease&) = delete;
+
+            CURL* get() const { return m_handle; }
+            explicit operator bool() const { return m_handle != nullptr; }
+
+        private:
+            void release() {
+                if (m_handle) {
+                    m_pool->giveBack(m_handle);
+                    m_handle = nullptr;
+                }
+            }
+
+            HttpConnectionPool* m_pool;
+            CURL* m_handle;
+        };
+
+        /// @brief The process-wide pool (initializes curl on first use)
+        static HttpConnectionPool& instance();
+
+        HttpConnectionPool(const HttpConnectionPool&) = delete;
+        HttpConnectionPool& operator=(const HttpConnectionPool&) = delete;
+
+        /// @brief Borrow a handle reset to the pool defaults (keep-alive, HTTP/2, shared caches)
+        Lease acquire();
+
+        /// @brief Record the connection timings of a request performed on handle
+        void recordRequest(CURL* handle);
+
+        PoolStats getStats() const;
+
+    private:
+        HttpConnectionPool();
+        ~HttpConnectionPool();
+
+        void giveBack(CURL* handle);
+        void configure(CURL* handle) const;
+
+        static void lockShared(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr);
+        static void unlockShared(CURL* handle, curl_lock_data data, void* userptr);
+
+        static constexpr size_t kMaxIdleHandles = 8; ///< Handles beyond this are cleaned up when returned
+
+        CURLSH* m_share{ nullptr }; ///< DNS, TLS session and connection caches shared by all handles
+        std::array<std::mutex, CURL_LOCK_DATA_LAST> m_shareLocks;
+
+        mutable std::mutex m_mutex; ///< Guards the idle list and the statistics
+        std::vector<CURL*> m_idle;
+        PoolStats m_stats;
+        double m_freshSetupTotalMs{ 0.0 };
+        double m_reusedSetupTotalMs{ 0.0 };
+    };
+
+} // namespace openai
+} // namespace XPlaneChatBot
+#endif // XP_HTTP_CONNECTION_POOL_H_
@@ -0,0 +1,661 @@
+/**
+ * @file HttpEngine.cpp
+ * @author zah
+ * @brief Implementation of the curl_multi HTTP engine
+ * @see HttpEngine.h
+ * @version 0.1
+ * @date 2024-06-03
+ *
+ */
+
+#include "HttpEngine.h"
+
+#include "base/logger.h"
+
+#include <algorithm>
+
+namespace XPlaneChatBot {
+namespace openai {
+
+namespace {
+    constexpr int kPollTimeoutMs = 1000; ///< Upper bound on a wait; submit, cancel, stop and deadlines wake the loop early
+    constexpr size_t kFirstByteSamples = 64; ///< Window of the first-byte p95
+    constexpr size_t kMinFirstByteSamples = 16; ///< Below this the configured hedge delay is used
+    constexpr std::chrono::milliseconds kMinHedgeDelay{ 100 };
+
+    using namespace std::chrono_literals;
+
+    /// @brief Throttled or failed on the server's side: worth another attempt
+    bool isRetryableStatus(long status) {
+        return status == 429 || status >= 500;
+    }
+
+    /// @brief Policy of the endpoints without one of their own
+    RequestPolicy defaultPolicy() {
+        RequestPolicy policy;
+        policy.firstByteTimeout = 30s;
+        policy.stallTimeout = 30s;
+        policy.maxRetries = 1;
+        return policy;
+    }
+
+    RequestPolicy chatPolicy() {
+        RequestPolicy policy;
+        policy.connectTimeout = 5s;
+        policy.firstByteTimeout = 15s;
+        policy.stallTimeout = 10s;
+        policy.totalTimeout = 120s;
+        policy.maxRetries = 2; // Not hedged: a duplicate completion costs tokens
+        return policy;
+    }
+
+    /// @brief A TTS sentence is short, so a slow one is hedged or retried early
+    RequestPolicy speechPolicy() {
+        RequestPolicy policy;
+        policy.connectTimeout = 5s;
+        policy.firstByteTimeout = 5s;
+        policy.stallTimeout = 5s;
+        policy.totalTimeout = 60s;
+        policy.maxRetries = 2;
+        policy.hedge = true;
+        policy.hedgeDelay = 1500ms;
+        return policy;
+    }
+
+    double toMs(std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+
+    /// @brief Whether a deadline of length limit (0 = none) starting at start has passed
+    bool expired(std::chrono::steady_clock::time_point start, std::chrono::milliseconds limit, std::chrono::steady_clock::time_point now) {
+        return limit.count() > 0 && now - start >= limit;
+    }
+}
+
+
+HttpEngine& HttpEngine::instance() {
+    HttpConnectionPool::instance(); // Constructed first so it outlives the engine (it owns curl_global_init)
+    static HttpEngine engine;
+    return engine;
+}
+
+HttpEngine::HttpEngine() {
+    m_endpoints[""].policy = defaultPolicy();
+    m_endpoints["chat/completions"].policy = chatPolicy();
+    m_endpoints["audio/speech"].policy = speechPolicy();
+
+    m_multi = curl_multi_init();
+    if (m_multi == nullptr) {
+        Base::Logger::log("curl_multi_init() failed", Base::ERR, __FUNCTION__);
+        return;
+    }
+    curl_multi_setopt(m_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX); // Concurrent streams share one HTTP/2 connection
+    curl_multi_setopt(m_multi, CURLMOPT_MAX_HOST_CONNECTIONS, 4L);
+}
+
+HttpEngine::~HttpEngine() {
+    stop();
+    if (m_multi) {
+        curl_multi_cleanup(m_multi);
+    }
+}
+
+HttpEngine::RequestId HttpEngine::submit(HttpRequest request) {
+    const RequestId id = m_nextId++;
+    auto call = std::make_unique<Call>();
+    call->id = id;
+    call->request = std::move(request);
+
+    if (Base::isCancelled(call->request.cancelToken)) {
+        HttpResult result;
+        result.code = CURLE_ABORTED_BY_CALLBACK;
+        result.cancelled = true;
+        complete(*call, result);
+        return id;
+    }
+    std::shared_ptr<Base::CancellationToken> token = call->request.cancelToken;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_stopping || m_multi == nullptr) {
+        lock.unlock();
+        Base::Logger::log("HTTP engine is stopped, request not sent", Base::ERR, __FUNCTION__);
+        HttpResult result;
+        result.code = CURLE_FAILED_INIT;
+        result.cancelled = true;
+        complete(*call, result);
+        return id;
+    }
+    m_pending.push_back(std::move(call));
+    ++m_stats.submitted;
+    if (!m_thread.joinable()) {
+        m_thread = std::thread(&HttpEngine::run, this);
+    }
+    lock.unlock();
+    curl_multi_wakeup(m_multi);
+    if (token) {
+        // Wakes the loop right away; the progress callback also checks the token. Finished ids are ignored
+        token->onCancel([this, id] { cancel(id); });
+    }
+    return id;
+}
+
+std::future<HttpResult> HttpEngine::submitAsync(HttpRequest request, RequestId* id) {
+    auto promise = std::make_shared<std::promise<HttpResult>>();
+    std::future<HttpResult> future = promise->get_future();
+    request.onComplete = [promise, onComplete = std::move(request.onComplete)](const HttpResult& result) {
+        if (onComplete) {
+            onComplete(result);
+        }
+        promise->set_value(result);
+    };
+    const RequestId requestId = submit(std::move(request));
+    if (id) {
+        *id = requestId;
+    }
+    return future;
+}
+
+void HttpEngine::cancel(RequestId id) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_thread.joinable()) {
+            return;
+        }
+        m_cancels.push_back(id);
+    }
+    curl_multi_wakeup(m_multi);
+}
+
+void HttpEngine::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping) {
+            return;
+        }
+        m_stopping = true;
+    }
+    if (m_multi) {
+        curl_multi_wakeup(m_multi);
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    Base::Logger::log("HTTP engine stopped", Base::DEBUG, __FUNCTION__);
+}
+
+EngineStats HttpEngine::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void HttpEngine::setPolicy(const std::string& endpoint, const RequestPolicy& policy) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_endpoints[endpoint].policy = policy; // Requests already running keep the policy they started with
+}
+
+RequestPolicy HttpEngine::getPolicy(const std::string& endpoint) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_endpoints.find(endpoint);
+    return it != m_endpoints.end() ? it->second.policy : m_endpoints.at("").policy;
+}
+
+EndpointStats HttpEngine::getEndpointStats(const std::string& endpoint) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_endpoints.find(endpoint);
+    return it != m_endpoints.end() ? it->second.stats : EndpointStats{};
+}
+
+
+void HttpEngine::run() {
+    std::vector<std::unique_ptr<Call>> pending;
+    std::vector<RequestId> cancels;
+    std::vector<Attempt*> abandoned;
+    while (true) {
+        bool stopping = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            pending.swap(m_pending);
+            cancels.swap(m_cancels);
+            stopping = m_stopping;
+            ++m_stats.wakeups;
+        }
+        for (std::unique_ptr<Call>& call : pending) {
+            startCall(std::move(call));
+        }
+        pending.clear();
+        for (RequestId id : cancels) {
+            auto it = m_active.find(id);
+            if (it != m_active.end()) {
+                it->second->cancelled = true;
+                finishCall(id, CURLE_ABORTED_BY_CALLBACK);
+            }
+        }
+        cancels.clear();
+
+        if (stopping) {
+            while (!m_active.empty()) {
+                m_active.begin()->second->cancelled = true;
+                finishCall(m_active.begin()->first, CURLE_ABORTED_BY_CALLBACK);
+            }
+            break;
+        }
+
+        int running = 0;
+        curl_multi_perform(m_multi, &running);
+
+        int queued = 0;
+        while (CURLMsg* message = curl_multi_info_read(m_multi, &queued)) {
+            if (message->msg != CURLMSG_DONE) {
+                continue;
+            }
+            Attempt* attempt = nullptr;
+            curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &attempt);
+            if (attempt) {
+                attemptDone(attempt, message->data.result); // message is invalid after this
+            }
+        }
+
+        // Attempts that lost to another one cannot be removed from within the write callback
+        for (auto& [id, call] : m_active) {
+            for (const std::unique_ptr<Attempt>& attempt : call->attempts) {
+                if (attempt->abandoned) {
+                    abandoned.push_back(attempt.get());
+                }
+            }
+            for (Attempt* attempt : abandoned) {
+                removeAttempt(*call, attempt);
+            }
+            abandoned.clear();
+        }
+
+        const Clock::time_point now = Clock::now();
+        checkDeadlines(now);
+
+        const auto untilDeadline = std::chrono::duration_cast<std::chrono::milliseconds>(timeToNextDeadline(now));
+        const int timeoutMs = static_cast<int>(std::clamp<long long>(untilDeadline.count() + 1, 0, kPollTimeoutMs));
+        curl_multi_poll(m_multi, nullptr, 0, timeoutMs, nullptr);
+    }
+}
+
+void HttpEngine::startCall(std::unique_ptr<Call> call) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        call->endpoint = endpointOf(call->request);
+        auto it = m_endpoints.find(call->endpoint);
+        call->policy = it != m_endpoints.end() ? it->second.policy : m_endpoints[""].policy;
+        ++m_endpoints[call->endpoint].stats.requests;
+    }
+    call->started = Clock::now();
+    if (!startAttempt(*call, false)) {
+        HttpResult result;
+        result.code = CURLE_FAILED_INIT;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ++m_stats.failed;
+        }
+        complete(*call, result);
+        return;
+    }
+    const RequestId id = call->id;
+    m_active.emplace(id, std::move(call));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.active = m_active.size();
+    m_stats.peakActive = std::max(m_stats.peakActive, m_stats.active);
+}
+
+bool HttpEngine::startAttempt(Call& call, bool hedge) {
+    HttpConnectionPool::Lease lease = HttpConnectionPool::instance().acquire();
+    if (!lease) {
+        return false;
+    }
+    auto attempt = std::make_unique<Attempt>();
+    attempt->call = &call;
+    attempt->lease = std::move(lease);
+    attempt->hedge = hedge;
+    CURL* curl = attempt->lease.get();
+    const HttpRequest& request = call.request;
+
+    for (const std::string& header : request.headers) {
+        attempt->headers = curl_slist_append(attempt->headers, header.c_str());
+    }
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, attempt->headers);
+    curl_easy_setopt(curl, CURLOPT_URL, request.url.c_str());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(request.body.size()));
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request.body.data()); // Owned by the call
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, &HttpEngine::writeCallback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, attempt.get());
+    curl_easy_setopt(curl, CURLOPT_PRIVATE, attempt.get());
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, &HttpEngine::progressCallback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, attempt.get());
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    if (call.policy.connectTimeout.count() > 0) {
+        curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, static_cast<long>(call.policy.connectTimeout.count()));
+    }
+
+    const CURLMcode added = curl_multi_add_handle(m_multi, curl);
+    if (added != CURLM_OK) {
+        Base::Logger::log("curl_multi_add_handle failed: " + std::string(curl_multi_strerror(added)), Base::ERR, __FUNCTION__);
+        curl_slist_free_all(attempt->headers);
+        return false;
+    }
+    attempt->started = Clock::now();
+    call.attempts.push_back(std::move(attempt));
+    ++call.attemptCount;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.attempts;
+    return true;
+}
+
+void HttpEngine::removeAttempt(Call& call, Attempt* attempt) {
+    auto it = std::find_if(call.attempts.begin(), call.attempts.end(),
+        [attempt](const std::unique_ptr<Attempt>& candidate) { return candidate.get() == attempt; });
+    if (it == call.attempts.end()) {
+        return;
+    }
+    curl_multi_remove_handle(m_multi, attempt->lease.get());
+    curl_slist_free_all(attempt->headers);
+    call.attempts.erase(it); // The lease goes back to the pool with the attempt
+}
+
+void HttpEngine::attemptDone(Attempt* attempt, CURLcode code) {
+    Call& call = *attempt->call;
+    if (call.cancelled || Base::isCancelled(call.request.cancelToken)) {
+        call.cancelled = true;
+        finishCall(call.id, CURLE_ABORTED_BY_CALLBACK);
+        return;
+    }
+    if (attempt == call.winner) {
+        finishCall(call.id, code);
+        return;
+    }
+    if (attempt->abandoned) {
+        removeAttempt(call, attempt);
+        return;
+    }
+    if (code == CURLE_OK && !attempt->rejected) {
+        long status = 0;
+        curl_easy_getinfo(attempt->lease.get(), CURLINFO_RESPONSE_CODE, &status);
+        if (isRetryableStatus(status)) {
+            attempt->rejected = true; // An error status without a body: nothing to deliver, retry or fail
+            call.status = status;
+        }
+    }
+    if (code == CURLE_OK && !attempt->rejected) {
+        call.winner = attempt; // Completed without a body byte; it still is the answer
+        call.hedgeWon = attempt->hedge;
+        finishCall(call.id, code);
+        return;
+    }
+
+    // Failed before delivering anything
+    const bool timedOut = code == CURLE_OPERATION_TIMEDOUT;
+    if (timedOut) {
+        countEndpoint(call.endpoint, &EndpointStats::timeouts);
+    }
+    if (!attempt->rejected) {
+        Base::Logger::log("HTTP attempt failed: " + std::string(curl_easy_strerror(code)), Base::WARN, __FUNCTION__);
+    }
+    call.lastError = attempt->rejected ? CURLE_HTTP_RETURNED_ERROR : code;
+    removeAttempt(call, attempt);
+    if (call.attempts.empty()) {
+        attemptFailed(call); // Otherwise the hedge (or the original) may still answer
+    }
+}
+
+void HttpEngine::attemptFailed(Call& call) {
+    const Clock::time_point now = Clock::now();
+    if (call.retries < call.policy.maxRetries && !expired(call.started, call.policy.totalTimeout, now)) {
+        // Full jitter: spreads the retries of requests that failed together
+        const long long cap = std::min<long long>(call.policy.retryMaxDelay.count(), call.policy.retryBaseDelay.count() << std::min(call.retries, 16));
+        std::uniform_int_distribution<long long> delay(0, std::max<long long>(cap, 0));
+        ++call.retries;
+        call.retryAt = now + std::chrono::milliseconds(delay(m_random));
+        countEndpoint(call.endpoint, &EndpointStats::retries);
+        return; // Started by checkDeadlines()
+    }
+    finishCall(call.id, call.lastError, call.lastError == CURLE_OPERATION_TIMEDOUT);
+}
+
+void HttpEngine::checkDeadlines(Clock::time_point now) {
+    std::vector<RequestId> ids;
+    ids.reserve(m_active.size());
+    for (const auto& [id, call] : m_active) {
+        ids.push_back(id);
+    }
+    std::vector<Attempt*> late;
+    for (RequestId id : ids) {
+        auto it = m_active.find(id);
+        if (it == m_active.end()) {
+            continue;
+        }
+        Call& call = *it->second;
+        const RequestPolicy& policy = call.policy;
+
+        if (expired(call.started, policy.totalTimeout, now)) {
+            countEndpoint(call.endpoint, &EndpointStats::timeouts);
+            finishCall(id, CURLE_OPERATION_TIMEDOUT, true);
+            continue;
+        }
+        if (call.attempts.empty()) {
+            if (now >= call.retryAt && !startAttempt(call, false)) {
+                call.lastError = CURLE_FAILED_INIT;
+                attemptFailed(call);
+            }
+            continue;
+        }
+        if (call.winner) {
+            if (expired(call.lastData, policy.stallTimeout, now)) {
+                countEndpoint(call.endpoint, &EndpointStats::stalls);
+                Base::Logger::log("Response stalled for " + std::to_string(policy.stallTimeout.count()) + " ms", Base::WARN, __FUNCTION__);
+                finishCall(id, CURLE_OPERATION_TIMEDOUT, true);
+            }
+            continue;
+        }
+
+        late.clear();
+        for (const std::unique_ptr<Attempt>& attempt : call.attempts) {
+            if (expired(attempt->started, policy.firstByteTimeout, now)) {
+                late.push_back(attempt.get());
+            }
+        }
+        for (Attempt* attempt : late) {
+            countEndpoint(call.endpoint, &EndpointStats::timeouts);
+            removeAttempt(call, attempt);
+        }
+        if (call.attempts.empty()) {
+            call.lastError = CURLE_OPERATION_TIMEDOUT;
+            attemptFailed(call);
+            continue;
+        }
+        if (policy.hedge && !call.hedged && call.attempts.size() == 1 && now - call.attempts.front()->started >= hedgeDelay(call)) {
+            call.hedged = true;
+            if (startAttempt(call, true)) {
+                countEndpoint(call.endpoint, &EndpointStats::hedgesFired);
+            }
+        }
+    }
+}
+
+HttpEngine::Clock::duration HttpEngine::timeToNextDeadline(Clock::time_point now) const {
+    Clock::time_point next = now + std::chrono::milliseconds(kPollTimeoutMs);
+    auto consider = [&next](Clock::time_point start, std::chrono::milliseconds limit) {
+        if (limit.count() > 0) {
+            next = std::min(next, start + limit);
+        }
+    };
+    for (const auto& [id, call] : m_active) {
+        consider(call->started, call->policy.totalTimeout);
+        if (call->attempts.empty()) {
+            next = std::min(next, call->retryAt);
+        }
+        else if (call->winner) {
+            consider(call->lastData, call->policy.stallTimeout);
+        }
+        else {
+            for (const std::unique_ptr<Attempt>& attempt : call->attempts) {
+                consider(attempt->started, call->policy.firstByteTimeout);
+            }
+            if (call->policy.hedge && !call->hedged) {
+                consider(call->attempts.front()->started, hedgeDelay(*call));
+            }
+        }
+    }
+    return std::max(Clock::duration::zero(), next - now);
+}
+
+void HttpEngine::finishCall(RequestId id, CURLcode code, bool timedOut) {
+    auto it = m_active.find(id);
+    if (it == m_active.end()) {
+        return;
+    }
+    std::unique_ptr<Call> call = std::move(it->second);
+    m_active.erase(it);
+
+    HttpResult result;
+    result.code = code;
+    result.cancelled = call->cancelled;
+    result.timedOut = timedOut && !call->cancelled;
+    result.ok = code == CURLE_OK && !call->cancelled && !timedOut;
+    result.status = call->status;
+    result.attempts = call->attemptCount;
+    if (call->winner) {
+        CURL* curl = call->winner->lease.get();
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &result.status);
+        if (result.ok) {
+            HttpConnectionPool::instance().recordRequest(curl);
+        }
+    }
+    while (!call->attempts.empty()) {
+        removeAttempt(*call, call->attempts.back().get());
+    }
+    call->winner = nullptr;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.active = m_active.size();
+        if (result.cancelled) {
+            ++m_stats.cancelled;
+        }
+        else if (result.ok) {
+            ++m_stats.completed;
+        }
+        else {
+            ++m_stats.failed;
+        }
+    }
+    if (call->firstByteMs >= 0.0) {
+        recordFirstByte(*call, call->firstByteMs);
+    }
+    if (call->hedged) {
+        countEndpoint(call->endpoint, call->hedgeWon ? &EndpointStats::hedgesWon : &EndpointStats::hedgesWasted);
+    }
+    if (!result.ok && !result.cancelled) {
+        Base::Logger::log("HTTP request failed after " + std::to_string(result.attempts) + " attempt(s): " + std::string(curl_easy_strerror(code)),
+            Base::ERR, __FUNCTION__);
+    }
+    complete(*call, result);
+}
+
+void HttpEngine::complete(Call& call, const HttpResult& result) {
+    if (call.request.onComplete) {
+        call.request.onComplete(result);
+    }
+}
+
+std::string HttpEngine::endpointOf(const HttpRequest& request) const {
+    if (!request.endpoint.empty()) {
+        return request.endpoint;
+    }
+    std::string_view path(request.url);
+    path = path.substr(0, path.find('?'));
+    std::string best;
+    for (const auto& [name, endpoint] : m_endpoints) {
+        if (name.size() > best.size() && path.size() >= name.size() && path.compare(path.size() - name.size(), name.size(), name) == 0) {
+            best = name;
+        }
+    }
+    return best;
+}
+
+std::chrono::milliseconds HttpEngine::hedgeDelay(const Call& call) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_endpoints.find(call.endpoint);
+    if (it == m_endpoints.end() || it->second.firstByteMs.size() < kMinFirstByteSamples) {
+        return call.policy.hedgeDelay;
+    }
+    const auto p95 = std::chrono::milliseconds(static_cast<long long>(it->second.stats.firstByteP95Ms));
+    return std::max(p95, kMinHedgeDelay);
+}
+
+void HttpEngine::recordFirstByte(const Call& call, double ms) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Endpoint& endpoint = m_endpoints[call.endpoint];
+    if (endpoint.firstByteMs.size() < kFirstByteSamples) {
+        endpoint.firstByteMs.push_back(ms);
+    }
+    else {
+        endpoint.firstByteMs[endpoint.nextSample] = ms;
+        endpoint.nextSample = (endpoint.nextSample + 1) % kFirstByteSamples;
+    }
+    if (endpoint.firstByteMs.size() >= kMinFirstByteSamples) {
+        std::vector<double> sorted = endpoint.firstByteMs;
+        const size_t rank = (sorted.size() * 95 + 99) / 100 - 1;
+        std::nth_element(sorted.begin(), sorted.begin() + static_cast<std::ptrdiff_t>(rank), sorted.end());
+        endpoint.stats.firstByteP95Ms = sorted[rank];
+    }
+}
+
+void HttpEngine::countEndpoint(const std::string& endpoint, uint64_t EndpointStats::* counter) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++(m_endpoints[endpoint].stats.*counter);
+}
+
+size_t HttpEngine::writeCallback(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    Attempt* attempt = static_cast<Attempt*>(userdata);
+    Call& call = *attempt->call;
+    const size_t realSize = size * nmemb;
+    if (call.cancelled || attempt->abandoned || Base::isCancelled(call.request.cancelToken)) {
+        return 0;
+    }
+    const Clock::time_point now = Clock::now();
+    if (call.winner == nullptr) {
+        long status = 0;
+        curl_easy_getinfo(attempt->lease.get(), CURLINFO_RESPONSE_CODE, &status);
+        if (isRetryableStatus(status) && call.retries < call.policy.maxRetries) {
+            attempt->rejected = true; // Retried; the caller never sees this body
+            call.status = status;
+            return 0;
+        }
+        // First byte: this attempt answers, the others are dropped
+        call.winner = attempt;
+        call.hedgeWon = attempt->hedge;
+        call.firstByteMs = toMs(now - attempt->started);
+        for (const std::unique_ptr<Attempt>& other : call.attempts) {
+            if (other.get() != attempt) {
+                other->abandoned = true;
+            }
+        }
+    }
+    else if (call.winner != attempt) {
+        attempt->abandoned = true;
+        return 0;
+    }
+    call.lastData = now;
+    if (call.request.onData && !call.request.onData(ptr, realSize)) {
+        call.cancelled = true;
+        return 0; // Makes curl abort the transfer
+    }
+    return realSize;
+}
+
+int HttpEngine::progressCallback(void* userdata, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+    const Attempt* attempt = static_cast<const Attempt*>(userdata);
+    const Call& call = *attempt->call;
+    // Non-zero aborts the transfer
+    return call.cancelled || attempt->abandoned || Base::isCancelled(call.request.cancelToken) ? 1 : 0;
+}
+
+} // namespace openai
+} // namespace XPlaneChatBot
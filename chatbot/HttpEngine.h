@@ -0,0 +1,225 @@
+/**
+ * @file HttpEngine.h
+ * @author zah
+ * @brief Asynchronous HTTP engine: one I/O thread drives every OpenAI stream through curl_multi
+ *
+ * Requests are submitted from any thread and run concurrently on the engine thread, which multiplexes them over
+ * HTTP/2 where the server allows it. Response bytes and the completion are delivered through callbacks that run
+ * on the engine thread, so they must be short and must not block. A request can be cancelled at any time, with
+ * cancel(), through its cancellation token, or by returning false from its data callback.
+ *
+ * Every request follows the RequestPolicy of its endpoint (setPolicy()):
+ * + deadlines: connect, first byte, stall between bytes and total time
+ * + retries: an attempt that fails before any byte reached the caller (connection error, timeout, HTTP 429/5xx) is
+ *   retried after a jittered exponential backoff
+ * + hedging: when the first byte is later than the endpoint's p95, a duplicate attempt is fired. The first attempt
+ *   to deliver a byte wins and the other one is aborted; only the winner's bytes reach the data callback.
+ *
+ * @version 0.1
+ * @date 2024-06-03
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XP_HTTP_ENGINE_H_
+#define XP_HTTP_ENGINE_H_
+
+#include "base/cancellation.h"
+#include "chatbot/HttpConnectionPool.h"
+
+#include <curl/curl.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace XPlaneChatBot {
+namespace openai {
+    /// @brief Outcome of an HTTP request
+    struct HttpResult {
+        bool ok{ false }; ///< Transfer succeeded (the status code is not checked)
+        CURLcode code{ CURLE_OK };
+        long status{ 0 }; ///< HTTP response code
+        bool cancelled{ false }; ///< Cancelled by cancel(), the token, the data callback or stop()
+        bool timedOut{ false }; ///< A deadline of the policy expired (code is CURLE_OPERATION_TIMEDOUT)
+        int attempts{ 0 }; ///< Transfers started, retries and hedges included
+    };
+
+    /// @brief Latency budgets and retry/hedging behaviour of an endpoint (a 0 duration disables that deadline)
+    struct RequestPolicy {
+        std::chrono::milliseconds connectTimeout{ 10000 }; ///< Per attempt, DNS + TCP + TLS
+        std::chrono::milliseconds firstByteTimeout{ 0 }; ///< Per attempt, from its start to the first response byte
+        std::chrono::milliseconds stallTimeout{ 0 }; ///< Longest silence between two response bytes
+        std::chrono::milliseconds totalTimeout{ 0 }; ///< Whole request, retries included
+        int maxRetries{ 0 }; ///< Attempts after the first one, only while nothing has been delivered
+        std::chrono::milliseconds retryBaseDelay{ 200 }; ///< Backoff before retry n is random in [0, base * 2^n]
+        std::chrono::milliseconds retryMaxDelay{ 2000 };
+        bool hedge{ false }; ///< Fire a duplicate attempt when the first byte is late
+        std::chrono::milliseconds hedgeDelay{ 1000 }; ///< Hedge budget until enough first-byte times have been seen (then their p95)
+    };
+
+    /// @brief Deadline, retry and hedging counters of an endpoint
+    struct EndpointStats {
+        uint64_t requests{ 0 };
+        uint64_t timeouts{ 0 }; ///< Attempts aborted by the connect, first-byte or total deadline
+        uint64_t stalls{ 0 }; ///< Requests aborted because the response stalled
+        uint64_t retries{ 0 };
+        uint64_t hedgesFired{ 0 };
+        uint64_t hedgesWon{ 0 }; ///< The duplicate delivered the first byte
+        uint64_t hedgesWasted{ 0 }; ///< The duplicate lost or failed
+        double firstByteP95Ms{ 0.0 }; ///< Over the recent requests (0 until enough were seen)
+    };
+
+    /// @brief A request for the engine; the callbacks run on the engine thread
+    struct HttpRequest {
+        std::string url;
+        std::string body; ///< POST body
+        std::vector<std::string> headers;
+        std::function<bool(const char* data, size_t size)> onData; ///< Response bytes as they arrive; return false to cancel
+        std::function<void(const HttpResult& result)> onComplete; ///< Called exactly once
+        std::shared_ptr<Base::CancellationToken> cancelToken; ///< Aborts the request when cancelled (optional)
+        std::string endpoint; ///< Policy to follow; empty picks the one whose name ends the url path (see setPolicy)
+    };
+
+    /// @brief Engine activity counters
+    struct EngineStats {
+        uint64_t submitted{ 0 };
+        uint64_t completed{ 0 }; ///< Finished successfully
+        uint64_t failed{ 0 };
+        uint64_t cancelled{ 0 };
+        size_t active{ 0 }; ///< Transfers running now
+        size_t peakActive{ 0 };
+        uint64_t wakeups{ 0 }; ///< Iterations of the event loop
+        uint64_t attempts{ 0 }; ///< Transfers started, retries and hedges included
+    };
+
+    /// @brief Process-wide curl_multi event loop
+    class HttpEngine {
+    public:
+        using RequestId = uint64_t;
+
+        /// @brief The process-wide engine (its thread starts with the first request)
+        static HttpEngine& instance();
+
+        HttpEngine(const HttpEngine&) = delete;
+        HttpEngine& operator=(const HttpEngine&) = delete;
+
+        /// @brief Start a request; onComplete is called even if it cannot be started
+        RequestId submit(HttpRequest request);
+
+        /// @brief Start a request and get its result as a future (onComplete, if set, is called first)
+        std::future<HttpResult> submitAsync(HttpRequest request, RequestId* id = nullptr);
+
+        /// @brief Abort a request; its onComplete is called with cancelled set. Unknown or finished ids are ignored
+        void cancel(RequestId id);
+
+        /// @brief Cancel every request and join the engine thread (call before the plugin is unloaded)
+        void stop();
+
+        EngineStats getStats() const;
+
+        /**
+         * @brief Set the policy of an endpoint
+         * @param endpoint Name matched against the end of the url path, e.g. "audio/speech"
+         */
+        void setPolicy(const std::string& endpoint, const RequestPolicy& policy);
+
+        /// @brief Policy of an endpoint (the default policy for an unknown name)
+        RequestPolicy getPolicy(const std::string& endpoint) const;
+
+        EndpointStats getEndpointStats(const std::string& endpoint) const;
+
+    private:
+        using Clock = std::chrono::steady_clock;
+        struct Call;
+
+        /// @brief One curl transfer of a request (the first one, a retry or a hedge)
+        struct Attempt {
+            Call* call{ nullptr };
+            HttpConnectionPool::Lease lease{ nullptr, nullptr };
+            curl_slist* headers{ nullptr };
+            Clock::time_point started;
+            bool hedge{ false };
+            bool rejected{ false }; ///< Aborted on a retryable HTTP status before delivering anything
+            bool abandoned{ false }; ///< Lost to another attempt, removed after curl_multi_perform
+        };
+
+        /// @brief A request owned by the engine thread while it runs
+        struct Call {
+            RequestId id{ 0 };
+            HttpRequest request;
+            std::string endpoint; ///< Key of the policy and statistics
+            RequestPolicy policy;
+            Clock::time_point started;
+            Clock::time_point retryAt; ///< When to start the next attempt, while none is running
+            Clock::time_point lastData; ///< Last byte delivered
+            std::vector<std::unique_ptr<Attempt>> attempts; ///< Running
+            Attempt* winner{ nullptr }; ///< Attempt whose bytes are delivered
+            int attemptCount{ 0 };
+            int retries{ 0 };
+            long status{ 0 }; ///< HTTP status of the last rejected attempt
+            CURLcode lastError{ CURLE_OK }; ///< Failure of the last attempt
+            double firstByteMs{ -1.0 }; ///< First byte latency of the winner
+            bool hedged{ false };
+            bool hedgeWon{ false };
+            bool cancelled{ false };
+        };
+
+        /// @brief Policy, statistics and recent first-byte times of an endpoint (guarded by m_mutex)
+        struct Endpoint {
+            RequestPolicy policy;
+            EndpointStats stats;
+            std::vector<double> firstByteMs; ///< Ring of the recent samples
+            size_t nextSample{ 0 };
+        };
+
+        HttpEngine();
+        ~HttpEngine();
+
+        void run();
+        void startCall(std::unique_ptr<Call> call);
+        bool startAttempt(Call& call, bool hedge);
+        void removeAttempt(Call& call, Attempt* attempt);
+        void attemptDone(Attempt* attempt, CURLcode code);
+        void attemptFailed(Call& call);
+        void checkDeadlines(Clock::time_point now);
+        Clock::duration timeToNextDeadline(Clock::time_point now) const;
+        void finishCall(RequestId id, CURLcode code, bool timedOut = false);
+        void complete(Call& call, const HttpResult& result);
+
+        std::string endpointOf(const HttpRequest& request) const;
+        std::chrono::milliseconds hedgeDelay(const Call& call) const;
+        void recordFirstByte(const Call& call, double ms);
+        void countEndpoint(const std::string& endpoint, uint64_t EndpointStats::* counter);
+
+        static size_t writeCallback(char* ptr, size_t size, size_t nmemb, void* userdata);
+        static int progressCallback(void* userdata, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
+
+        CURLM* m_multi{ nullptr };
+        std::thread m_thread;
+
+        mutable std::mutex m_mutex; ///< Guards the hand-over lists, m_stopping, m_stats and m_endpoints
+        std::vector<std::unique_ptr<Call>> m_pending; ///< Submitted, not yet started
+        std::vector<RequestId> m_cancels; ///< Cancellations for the engine thread
+        bool m_stopping{ false };
+        EngineStats m_stats;
+        std::map<std::string, Endpoint> m_endpoints; ///< "" is the default policy
+
+        std::unordered_map<RequestId, std::unique_ptr<Call>> m_active; ///< Engine thread only
+        std::mt19937 m_random{ std::random_device{}() }; ///< Retry jitter, engine thread only
+        std::atomic<RequestId> m_nextId{ 1 };
+    };
+
+} // namespace openai
+} // namespace XPlaneChatBot
+#endif // XP_HTTP_ENGINE_H_
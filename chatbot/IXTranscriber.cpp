@@ -1,279 +1,1102 @@
-#include "IXTranscriber.h"
-
-namespace XPlaneChatBot {
-namespace Chat {
-
-
-IXTranscriber::IXTranscriber(int sample_rate)
-    : m_sampleRate(sample_rate)
-    , m_framesPerBuffer(static_cast<int>(sample_rate * 0.2f))
-{
-    // WebSocket initialization
-    ix::initNetSystem(); // For windows
-
-    // PortAudio initialization
-    try {
-        m_audioErr = Pa_Initialize();
-        if (m_audioErr != paNoError) {
-            Base::Logger::log("PortAudio error when initializing: " + std::string(Pa_GetErrorText(m_audioErr)), Base::ERR, __FUNCTION__);
-            return;
-        }
-
-        m_audioErr = Pa_OpenDefaultStream(
-            &m_audioStream,
-            m_channels,
-            0,
-            m_format,
-            m_sampleRate,
-            m_framesPerBuffer,
-            &IXTranscriber::pa_callback,
-            this
-        );
-        if (m_audioErr != paNoError) {
-            Base::Logger::log("PortAudio error when opening stream: " + std::string(Pa_GetErrorText(m_audioErr)), Base::ERR, __FUNCTION__);
-            Pa_Terminate();
-            return;
-        }
-    }
-    catch (const std::exception& e) {
-		Base::Logger::log(std::string("Exception in IXTranscriber constructor: ") + e.what(), Base::ERR, __FUNCTION__);
-		throw;
-	}
-}
-
-IXTranscriber::~IXTranscriber() {
-    if (m_running)
-        stop_transcription();
-    if (m_audioStream) {
-        Pa_CloseStream(m_audioStream);
-    }
-    Pa_Terminate();
-    ix::uninitNetSystem();
-}
-
-
-void IXTranscriber::start_transcription(std::shared_ptr<Message> message) {
-    std::lock_guard<std::mutex> lock(m_startStopMutex);
-    if (m_running) {
-		Base::Logger::log("Transcription already started.", Base::ERR, __FUNCTION__);
-		return;
-	}
-    if (m_webSocket.getReadyState() != ix::ReadyState::Closed) {
-        Base::Logger::log("Connection must be closed to start transcription", Base::ERR, __FUNCTION__);
-        return;
-    }
-
-    m_message = message;
-
-    m_audioErr = Pa_StartStream(m_audioStream);
-    if(m_audioErr != paNoError) {
-        Base::Logger::log("PortAudio error when starting stream: " + std::string(Pa_GetErrorText(m_audioErr)), Base::ERR, __FUNCTION__);
-        Pa_CloseStream(m_audioStream);
-        Pa_Terminate();
-        m_audioStream = nullptr;
-        return;
-    }
-    Base::Logger::log("PortAudio stream started", Base::DEBUG, __FUNCTION__);
-
-    // Set up WebSocket URL and headers
-    std::string url = "wss://api.assemblyai.com/v2/realtime/ws?sample_rate=" + std::to_string(m_sampleRate);
-    m_webSocket.setExtraHeaders({ {"Authorization", m_aaiAPItoken} });
-    m_webSocket.setUrl(url);
-
-    // Initialize WebSocket
-    m_webSocket.setOnMessageCallback([this](const ix::WebSocketMessagePtr& msg) {
-        this->on_message(msg);
-        });
-
-    // Start WebSocket
-    m_webSocket.start();
-    m_webSocket.enableAutomaticReconnection();
-
-    // Per message deflate connection is enabled by default. You can tweak its parameters or disable it
-    m_webSocket.disablePerMessageDeflate();
-    
-    // Optional heart beat, sent every 20 seconds when there is not any traffic
-    // to make sure that load balancers do not kill an idle connection.
-    m_webSocket.setPingInterval(20);
-
-    m_running = true;
-    if (m_message->getType() == MessageType::UserTranscription)
-        m_pauseStartTime = std::chrono::steady_clock::now();
-
-    Base::Logger::log("Transcription started", Base::INFO, __FUNCTION__);
-}
-
-void IXTranscriber::stop_transcription() {
-    std::lock_guard<std::mutex> lock(m_startStopMutex);
-    if (!m_running) {
-        Base::Logger::log("Transcription already stopped.", Base::ERR, __FUNCTION__);
-        return;
-    }
-
-    // Stop portaudio stream
-    m_audioErr = Pa_IsStreamActive(m_audioStream);
-    if (m_audioErr == 1) {
-        m_audioErr = Pa_StopStream(m_audioStream);
-        if (m_audioErr != paNoError) {
-            Base::Logger::log("PortAudio error when stopping stream: " + std::string(Pa_GetErrorText(m_audioErr)), Base::ERR, __FUNCTION__);
-        }
-    }
-
-    ix::WebSocketSendInfo sendInfo = m_webSocket.send(m_terminateMsg);
-    if (sendInfo.success) {
-        Base::Logger::log("Terminate message sent successfully", Base::DEBUG, __FUNCTION__);
-    }
-    else {
-		Base::Logger::log("Terminate message sending failed", Base::ERR, __FUNCTION__);
-	}
-    m_webSocket.stop();   
-
-    m_running = false;
-}
-
-
-int IXTranscriber::pa_callback(const void* inputBuffer, void* outputBuffer,
-    unsigned long framesPerBuffer,
-    const PaStreamCallbackTimeInfo* timeInfo,
-    PaStreamCallbackFlags statusFlags,
-    void* userData) {
-    try {
-        Base::Logger::log("Portaudio callback called", Base::DEBUG, __FUNCTION__);
-        auto* transcriber = static_cast<IXTranscriber*>(userData);
-        int code = transcriber->on_audio_data(inputBuffer, framesPerBuffer);
-        return code;
-    }
-    catch (const std::exception& e) {
-        Base::Logger::log(std::string("Exception in PortAudio callback: ") + e.what(), Base::ERR, __FUNCTION__);
-        throw;
-    }
-}
-
-int IXTranscriber::on_audio_data(const void* inputBuffer, unsigned long framesPerBuffer) 
-{
-    if (!m_running || m_webSocket.getReadyState() != ix::ReadyState::Open) {
-       Base::Logger::log("Audio data received while not running", Base::WARN, __FUNCTION__);
-       return paContinue;
-    }
-
-    // Cast data passed through stream to our structure.
-    const auto* in = static_cast<const int16_t*>(inputBuffer);
-    m_audioDataBuffer.assign(reinterpret_cast<const char*>(in), reinterpret_cast<const char*>(in) + framesPerBuffer * m_channels * sizeof(int16_t)); // Copy the audio data into the buffer
-
-    m_audioJSON["audio_data"] = base64_encode(m_audioDataBuffer);
-    Base::Logger::log("Audio data prepared", Base::DEBUG, __FUNCTION__);
-    ix::WebSocketSendInfo sendInfo = m_webSocket.send(m_audioJSON.dump());
-    if (sendInfo.success) {
-        Base::Logger::log("Audio data sent successfully", Base::DEBUG, __FUNCTION__);
-    }
-    else {
-        Base::Logger::log("Audio data sending failed", Base::ERR, __FUNCTION__);
-    }
-    return paContinue;
-}
-
-
-void IXTranscriber::on_message(const ix::WebSocketMessagePtr& msg) {
-    try {
-        switch (msg->type) {
-        case ix::WebSocketMessageType::Message: {
-            // Parse the JSON message
-            Json json_msg = Json::parse(msg->str);
-            Base::Logger::log("Received message: " + json_msg.dump(2), Base::DEBUG, __FUNCTION__);
-
-            if (json_msg.contains("error")) {
-                Base::Logger::log("Error from websocket: " + json_msg["error"], Base::ERR, __FUNCTION__);
-                return;
-            }
-
-            // Extract the message type
-            std::string message_type = json_msg["message_type"];
-
-            if (message_type == "PartialTranscript") {
-                std::string text = json_msg["text"].get<std::string>();
-                if (!text.empty()) {
-                    Base::Logger::log("Partial message received: " + text, Base::DEBUG, __FUNCTION__);
-                    m_message->setPartialTranscript(text);
-                    if (m_message->getType() == MessageType::UserTranscription)
-                        m_pauseStartTime = std::chrono::steady_clock::now();
-                }
-                else if (m_message->getType() == MessageType::UserTranscription && m_message->receivedFinal()) {
-                    if (isPauseDurationExceeded()) {
-                        Base::Logger::log("Pause duration exceeded threshold", Base::DEBUG, __FUNCTION__);
-                        m_message->stopUpdating();
-                    }
-                }
-            }
-            else if (message_type == "FinalTranscript") {
-                std::string text = json_msg["text"].get<std::string>();
-                if (!text.empty()) {
-                    Base::Logger::log("Final message received: " + text, Base::DEBUG, __FUNCTION__);
-                    m_message->setFinalTranscript(text);
-                    if (m_message->getType() == MessageType::UserTranscription)
-                        m_pauseStartTime = std::chrono::steady_clock::now();
-                }
-            }
-            else if (message_type == "SessionBegins") {
-                std::string session_id = json_msg["session_id"];
-                std::string expires_at = json_msg["expires_at"];
-                if (m_message->getType() == MessageType::UserTranscription)
-                    m_pauseStartTime = std::chrono::steady_clock::now();
-                Base::Logger::log("Session started with ID: " + session_id + " and expires at: " + expires_at, Base::INFO, __FUNCTION__);
-            }
-            else if (message_type == "SessionTerminated") {
-                Base::Logger::log("Session terminated.", Base::INFO, __FUNCTION__);
-            }
-            else {
-                Base::Logger::log("Unknown message type: " + message_type, Base::ERR, __FUNCTION__);
-            }
-            return;
-        }
-        case ix::WebSocketMessageType::Open:
-            Base::Logger::log("WebSocket connection opened with message " + msg->str, Base::INFO, __FUNCTION__);
-            Base::Logger::log(
-                "Connection to " + msg->openInfo.uri
-                + " opened with protocol: " + msg->openInfo.protocol
-                + " and handshake headers:",
-                Base::INFO, __FUNCTION__
-            );
-            for (auto it : msg->openInfo.headers) {
-                Base::Logger::log(it.first + ": " + it.second, Base::INFO, __FUNCTION__);
-            }
-            if (m_message->getType() == MessageType::UserTranscription)
-                m_pauseStartTime = std::chrono::steady_clock::now();
-            return;
-        case ix::WebSocketMessageType::Close:
-            Base::Logger::log("WebSocket connection closed with message " + msg->str, Base::INFO, __FUNCTION__);
-            Base::Logger::log(
-                "Closing connection because error code " + std::to_string(msg->closeInfo.code)
-                + " : " + msg->closeInfo.reason + "(remote ? " + std::to_string(msg->closeInfo.remote) + ")",
-                Base::INFO, __FUNCTION__
-            );
-            return;
-        case ix::WebSocketMessageType::Error:
-            Base::Logger::log("WebSocket error with message " + msg->str, Base::INFO, __FUNCTION__);
-            std::stringstream ss;
-            ss << "Error: " << msg->errorInfo.reason;
-            ss << "\n#retries: " << msg->errorInfo.retries;
-            ss << "\nWait time(ms): " << msg->errorInfo.wait_time;
-            ss << "\nHTTP Status: " << msg->errorInfo.http_status;
-            Base::Logger::log(ss.str(), Base::ERR, __FUNCTION__);
-            return;
-        }
-    }
-    catch (const std::exception& e) {
-		Base::Logger::log(std::string("Exception in WebSocket: ") + e.what(), Base::ERR, __FUNCTION__);
-		throw;
-	}
-}
-
-const bool IXTranscriber::isPauseDurationExceeded() const {
-    auto now = std::chrono::steady_clock::now();
-    return std::chrono::duration_cast<std::chrono::seconds>(now - m_pauseStartTime) >= m_pauseThreshold;
-}
-
-} // namespace Chat
-} // namespace XPlaneChatBot
-
-
-
+#include "IXTranscriber.h"
+
+#include <algorithm>
+
+namespace XPlaneChatBot {
+namespace Chat {
+
+namespace {
+    constexpr size_t kTranscriptEventQueueSize = 256;
+    constexpr size_t kMaxEventBatch = 64; ///< Events applied per frame at most
+    constexpr size_t kCaptureBlock = 256; ///< Samples converted to int16 at a time in the capture callback
+    constexpr int kEchoDelayMarginMs = 20; ///< Reported stream latencies are approximate, start the echo window early
+    constexpr std::chrono::seconds kSenderHandshakeTimeout{ 1 }; ///< Wait for the sender to flush or begin a turn
+    constexpr std::chrono::seconds kForcedFinalTimeout{ 2 }; ///< Give up on the Final owed for a forced end after this
+
+    Base::EchoCancellerConfig echoConfig(const AudioEngine& engine) {
+        Base::EchoCancellerConfig config;
+        config.bulkDelayMs = std::max(0, static_cast<int>(engine.echoPathDelayMs()) - kEchoDelayMarginMs);
+        return config;
+    }
+
+    void toPcm16(const float* in, size_t count, int16_t* out) {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = static_cast<int16_t>(std::clamp(in[i], -1.0f, 1.0f) * 32767.0f);
+        }
+    }
+
+    /// @brief Slow path for messages the targeted parser does not understand
+    bool parseTranscriptMessageWithJson(const std::string& text, TranscriptEvent& event) {
+        const Json json_msg = Json::parse(text, nullptr, false);
+        if (json_msg.is_discarded() || !json_msg.is_object()) {
+            return false;
+        }
+        if (json_msg.contains("error")) {
+            event.type = TranscriptEventType::Error;
+            event.text = json_msg["error"].is_string() ? json_msg["error"].get<std::string>() : json_msg["error"].dump();
+            return true;
+        }
+        if (!json_msg.contains("message_type") || !json_msg["message_type"].is_string()) {
+            return false;
+        }
+        const std::string message_type = json_msg["message_type"].get<std::string>();
+        const auto textOf = [&json_msg](const char* key) {
+            return json_msg.contains(key) && json_msg[key].is_string() ? json_msg[key].get<std::string>() : std::string();
+        };
+        if (message_type == "PartialTranscript") {
+            event.type = TranscriptEventType::Partial;
+            event.text = textOf("text");
+        }
+        else if (message_type == "FinalTranscript") {
+            event.type = TranscriptEventType::Final;
+            event.text = textOf("text");
+        }
+        else if (message_type == "SessionBegins") {
+            event.type = TranscriptEventType::SessionBegins;
+            event.text = textOf("session_id");
+        }
+        else if (message_type == "SessionTerminated") {
+            event.type = TranscriptEventType::SessionTerminated;
+        }
+        else {
+            event.type = TranscriptEventType::Unknown;
+            event.text = message_type;
+        }
+        return true;
+    }
+}
+
+
+IXTranscriber::IXTranscriber(AudioEngine& engine, int sample_rate)
+    : m_engine(engine)
+    , m_captureRate(engine.hasInput() ? engine.inputRate() : sample_rate)
+    , m_captureRing(static_cast<size_t>(std::max(m_captureRate, sample_rate)) * 2) // Two seconds of headroom for network/heap stalls
+    , m_referenceRing(engine.isDuplex() ? static_cast<size_t>(std::max(m_captureRate, sample_rate)) * 2 : 1)
+    , m_captureResampler(m_captureRate, sample_rate)
+    , m_referenceResampler(m_captureRate, sample_rate)
+    , m_echoCancellation(engine.isDuplex())
+    , m_echoCanceller(sample_rate, echoConfig(engine))
+    , m_sampleRate(sample_rate)
+    , m_framesPerBuffer(static_cast<int>(sample_rate * 0.2f))
+    , m_frameWriter(AudioFrameMode::Base64Json, static_cast<size_t>(m_framesPerBuffer) * m_channels)
+    , m_vad(sample_rate)
+    , m_silenceGate(static_cast<int>(1000LL * m_framesPerBuffer / sample_rate))
+    , m_replay(sample_rate, m_channels)
+    , m_transcriptEvents(kTranscriptEventQueueSize)
+{
+    // WebSocket initialization
+    ix::initNetSystem(); // For windows
+
+    // Transcript events are applied on the main thread, where the messages are also drawn
+    m_eventBatch.reserve(kMaxEventBatch);
+    XPLMCreateFlightLoop_t params;
+    params.structSize = sizeof(params);
+    params.phase = xplm_FlightLoop_Phase_BeforeFlightModel;
+    params.callbackFunc = &IXTranscriber::event_flight_loop;
+    params.refcon = this;
+    m_eventFlightLoop = XPLMCreateFlightLoop(&params);
+    XPLMScheduleFlightLoop(m_eventFlightLoop, -1.0f, true);
+
+    if (!m_engine.hasInput()) {
+        Base::Logger::log("No microphone stream to transcribe from", Base::ERR, __FUNCTION__);
+        return;
+    }
+    // The callback stays installed for the session and only writes while a turn is capturing
+    m_engine.setCaptureCallback([this](const float* mic, const float* reference, size_t count, PaStreamCallbackFlags flags) {
+        on_audio_data(mic, reference, count, flags);
+    });
+    Base::Logger::log(
+        "Microphone at " + std::to_string(m_captureRate) + " Hz, resampled to " + std::to_string(m_sampleRate) + " Hz ("
+        + Base::resamplerQualityToString(m_resamplerQuality) + "), echo cancellation "
+        + (m_echoCancellation ? "on (" + std::to_string(m_echoCanceller.taps()) + " taps)" : std::string("off")),
+        Base::INFO, __FUNCTION__
+    );
+}
+
+IXTranscriber::~IXTranscriber() {
+    m_engine.setCaptureCallback({}); // Returns once the callback is out of on_audio_data
+    if (m_running)
+        stop_transcription();
+    {
+        std::lock_guard<std::mutex> lock(m_startStopMutex);
+        if (m_sessionOpen)
+            close_session();
+    }
+    if (m_eventFlightLoop != nullptr) {
+        XPLMDestroyFlightLoop(m_eventFlightLoop);
+        m_eventFlightLoop = nullptr;
+    }
+    ix::uninitNetSystem();
+}
+
+
+void IXTranscriber::start_transcription(std::shared_ptr<Message> message) {
+    std::lock_guard<std::mutex> lock(m_startStopMutex);
+    if (m_running) {
+		Base::Logger::log("Transcription already started.", Base::ERR, __FUNCTION__);
+		return;
+	}
+    if (!m_engine.hasInput()) {
+        Base::Logger::log("No audio stream to transcribe from", Base::ERR, __FUNCTION__);
+        return;
+    }
+
+    // Reuse a pre-warmed or persistent session if there is one, so audio flows without a new handshake
+    const bool warm = m_sessionOpen;
+    {
+        // The capture state belongs to the sender thread, so it resets it (a new sender starts with the reset)
+        std::lock_guard<std::mutex> flushLock(m_flushMutex);
+        m_beginTurnRequested = true;
+    }
+    if (!m_sessionOpen) {
+        open_session();
+    }
+    {
+        std::unique_lock<std::mutex> flushLock(m_flushMutex);
+        if (!m_flushCv.wait_for(flushLock, kSenderHandshakeTimeout, [this] { return !m_beginTurnRequested; })) {
+            // Capture stays off, so the reset still pending cannot throw away any of this turn's audio
+            Base::Logger::log("Sender thread did not begin the turn in time, transcription not started", Base::ERR, __FUNCTION__);
+            return;
+        }
+    }
+
+    uint64_t generation = 0;
+    {
+        std::lock_guard<std::mutex> generationLock(m_generationMutex);
+        generation = ++m_turnGeneration;
+        if (!m_forcedFinalPending) {
+            m_eventGeneration = generation; // Otherwise once the previous turn's forced Final has arrived
+        }
+    }
+    set_current_message(message, generation);
+    m_endpointingActive = (message->getType() == MessageType::UserTranscription);
+    if (m_endpointingActive) {
+        m_endpointer.beginTurn(std::chrono::steady_clock::now());
+    }
+    {
+        std::lock_guard<std::mutex> statsLock(m_sessionStatsMutex);
+        m_turnStart = std::chrono::steady_clock::now();
+        m_waitingFirstPartial = true;
+        if (warm)
+            ++m_sessionStats.warmTurns;
+        else
+            ++m_sessionStats.coldTurns;
+    }
+    m_turnActive = true;
+    m_capturing = true;
+
+    m_running = true;
+
+    Base::Logger::log("Transcription started", Base::INFO, __FUNCTION__);
+}
+
+void IXTranscriber::stop_transcription() {
+    std::lock_guard<std::mutex> lock(m_startStopMutex);
+    if (!m_running) {
+        Base::Logger::log("Transcription already stopped.", Base::ERR, __FUNCTION__);
+        return;
+    }
+
+    // Stop capturing; the engine's stream keeps running for playback and the next turn
+    m_capturing = false;
+
+    // The callback can no longer write, so let the sender flush what is left of the utterance
+    m_turnActive = false;
+    {
+        std::unique_lock<std::mutex> flushLock(m_flushMutex);
+        m_flushRequested = true;
+        if (!m_flushCv.wait_for(flushLock, kSenderHandshakeTimeout, [this] { return !m_flushRequested; })) {
+            // Still requested: the sender sends the tail when it catches up, ahead of anything else
+            Base::Logger::log("Sender thread did not flush the end of the utterance in time", Base::WARN, __FUNCTION__);
+        }
+    }
+    m_endpointingActive = false;
+
+    const CaptureStats stats = get_capture_stats();
+    Base::Logger::log(
+        "Capture stats: sent " + std::to_string(stats.chunksSent) + " chunks, dropped " + std::to_string(stats.chunksDropped)
+        + " chunks, suppressed " + std::to_string(stats.chunksSuppressed) + " silent chunks, "
+        + std::to_string(stats.sendFailures) + " send failures, " + std::to_string(stats.overrunFrames)
+        + " overrun frames, peak queue depth " + std::to_string(stats.peakQueueDepthFrames) + " frames",
+        Base::DEBUG, __FUNCTION__
+    );
+    if (m_echoCancellation) {
+        const Base::EchoCancellerStats echoStats = get_echo_stats();
+        Base::Logger::log(
+            "Echo canceller stats: ERLE " + std::to_string(static_cast<int>(echoStats.erleDb)) + " dB, "
+            + std::to_string(echoStats.farEndSamples * 1000 / static_cast<uint64_t>(m_sampleRate)) + " ms with the speaker on, "
+            + std::to_string(echoStats.doubleTalkSamples * 1000 / static_cast<uint64_t>(m_sampleRate)) + " ms of double talk",
+            Base::DEBUG, __FUNCTION__
+        );
+    }
+    const ReplayStats replayStats = get_replay_stats();
+    Base::Logger::log(
+        "Replay stats: " + std::to_string(replayStats.reconnects) + " reconnects, replayed " + std::to_string(replayStats.replayedMs)
+        + " ms, dropped " + std::to_string(replayStats.droppedMs) + " ms, " + std::to_string(replayStats.pendingMs) + " ms pending",
+        Base::DEBUG, __FUNCTION__
+    );
+    const StreamStats streamStats = get_stream_stats();
+    Base::Logger::log(
+        "Stream stats: peak lag " + std::to_string(streamStats.peakLagMs) + " ms, peak send queue " + std::to_string(streamStats.peakBufferedBytes)
+        + " bytes, " + std::to_string(streamStats.throttleEpisodes) + " throttle episodes, " + std::to_string(streamStats.coalescedFrames)
+        + " coalesced frames, " + std::to_string(streamStats.silenceShedMs) + " ms of silence shed",
+        Base::DEBUG, __FUNCTION__
+    );
+    const EndpointerStats turnStats = m_endpointer.getStats();
+    Base::Logger::log(
+        "Endpointer stats: " + std::to_string(turnStats.turnsEnded) + " turns ended, " + std::to_string(turnStats.falseCutoffs)
+        + " false cut-offs, " + std::to_string(turnStats.forcedEnds) + " forced ends, required silence " + std::to_string(turnStats.requiredSilenceMs) + " ms, median latency "
+        + std::to_string(static_cast<int>(turnStats.medianLatencyMs)) + " ms",
+        Base::DEBUG, __FUNCTION__
+    );
+
+    if (m_sessionMode == SessionMode::Persistent) {
+        // Keep the connection for the next turn, but make the server finalize what it has heard so far. The sender
+        // sends it after the tail and any backlog, once the socket is open (it may be reconnecting)
+        {
+            std::lock_guard<std::mutex> generationLock(m_generationMutex);
+            m_forcedFinalPending = true;
+            m_forceEndSent = false;
+            m_forcedFinalDeadline = std::chrono::steady_clock::time_point::max();
+        }
+        m_forceEndPending = true;
+    }
+    else {
+        close_session();
+    }
+
+    m_running = false;
+}
+
+void IXTranscriber::prewarm() {
+    std::lock_guard<std::mutex> lock(m_startStopMutex);
+    if (m_sessionOpen) {
+        return;
+    }
+    Base::Logger::log("Pre-warming transcription session", Base::DEBUG, __FUNCTION__);
+    open_session();
+}
+
+void IXTranscriber::set_session_mode(SessionMode mode) {
+    std::lock_guard<std::mutex> lock(m_startStopMutex);
+    if (m_running) {
+        Base::Logger::log("Session mode can only be changed while transcription is stopped", Base::ERR, __FUNCTION__);
+        return;
+    }
+    m_sessionMode = mode;
+}
+
+SessionStats IXTranscriber::get_session_stats() const {
+    std::lock_guard<std::mutex> lock(m_sessionStatsMutex);
+    return m_sessionStats;
+}
+
+void IXTranscriber::open_session() {
+    // Set up WebSocket URL and headers
+    std::string url = m_endpoint + "?sample_rate=" + std::to_string(m_sampleRate);
+    m_webSocket.setExtraHeaders({ {"Authorization", m_aaiAPItoken} });
+    m_webSocket.setUrl(url);
+
+    // Initialize WebSocket
+    m_webSocket.setOnMessageCallback([this](const ix::WebSocketMessagePtr& msg) {
+        this->on_message(msg);
+        });
+
+    // Per message deflate connection is enabled by default. You can tweak its parameters or disable it
+    m_webSocket.disablePerMessageDeflate();
+
+    // Optional heart beat, sent every 20 seconds when there is not any traffic
+    // to make sure that load balancers do not kill an idle connection.
+    m_webSocket.setPingInterval(20);
+
+    {
+        std::lock_guard<std::mutex> statsLock(m_sessionStatsMutex);
+        m_handshakeStart = std::chrono::steady_clock::now();
+        m_waitingFirstSessionPartial = true;
+        ++m_sessionStats.sessionsOpened;
+    }
+
+    // Start WebSocket
+    m_webSocket.start();
+    m_webSocket.enableAutomaticReconnection();
+
+    // The sender lives as long as the session: it streams turns and keeps the connection alive in between
+    m_socketWasOpen = false;
+    m_socketEverOpen = false;
+    m_senderRunning = true;
+    m_senderThread = std::thread(&IXTranscriber::sender_loop, this);
+    m_sessionOpen = true;
+}
+
+void IXTranscriber::close_session() {
+    m_senderRunning = false;
+    if (m_senderThread.joinable()) {
+        m_senderThread.join();
+    }
+    {
+        // Nobody is left to serve what the sender had not got to
+        std::lock_guard<std::mutex> flushLock(m_flushMutex);
+        if (m_flushRequested) {
+            Base::Logger::log("Session closed before the end of the utterance was sent", Base::WARN, __FUNCTION__);
+        }
+        m_flushRequested = false;
+        m_beginTurnRequested = false;
+        m_forceEndPending = false;
+    }
+    m_flushCv.notify_all();
+    {
+        // The websocket thread is joined by stop() below, so nothing owed by this session arrives after it
+        std::lock_guard<std::mutex> generationLock(m_generationMutex);
+        m_forcedFinalPending = false;
+        m_eventGeneration = m_turnGeneration;
+    }
+    {
+        // Whatever could not be delivered is lost with the session
+        std::lock_guard<std::mutex> replayLock(m_replayMutex);
+        m_replay.clear();
+    }
+
+    if (m_webSocket.getReadyState() == ix::ReadyState::Open) {
+        ix::WebSocketSendInfo sendInfo = m_webSocket.sendText(AudioFrameWriter::terminateMessage());
+        if (sendInfo.success) {
+            Base::Logger::log("Terminate message sent successfully", Base::DEBUG, __FUNCTION__);
+        }
+        else {
+            Base::Logger::log("Terminate message sending failed", Base::ERR, __FUNCTION__);
+        }
+    }
+    m_webSocket.stop();
+    m_sessionOpen = false;
+}
+
+std::shared_ptr<Message> IXTranscriber::current_message(uint64_t* generation) const {
+    std::lock_guard<std::mutex> lock(m_messageMutex);
+    if (generation) {
+        *generation = m_messageGeneration;
+    }
+    return m_message;
+}
+
+void IXTranscriber::set_current_message(std::shared_ptr<Message> message, uint64_t generation) {
+    std::lock_guard<std::mutex> lock(m_messageMutex);
+    m_message = std::move(message);
+    m_messageGeneration = generation;
+}
+
+uint64_t IXTranscriber::stamp_generation(const TranscriptEvent& event) {
+    std::lock_guard<std::mutex> lock(m_generationMutex);
+    if (m_forcedFinalPending && m_forceEndSent && event.received >= m_forcedFinalDeadline) {
+        m_forcedFinalPending = false; // Nothing came back for the forced end (e.g. the session was replaced by a reconnect)
+        m_eventGeneration = m_turnGeneration;
+    }
+    const uint64_t generation = m_eventGeneration;
+    if (event.type == TranscriptEventType::Final && m_forcedFinalPending && m_forceEndSent) {
+        // The Final of the forced end: everything after it transcribes the turn started since
+        m_forcedFinalPending = false;
+        m_eventGeneration = m_turnGeneration;
+    }
+    return generation;
+}
+
+
+void IXTranscriber::on_audio_data(const float* mic, const float* reference, size_t count, PaStreamCallbackFlags statusFlags)
+{
+    // Real-time thread: no logging, locking or allocation in here
+    if (!m_capturing) {
+        return;
+    }
+    if (statusFlags & paInputOverflow) {
+        m_inputOverflows.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    int16_t block[kCaptureBlock];
+    const bool withReference = m_echoCancellation && reference != nullptr;
+    for (size_t done = 0; done < count; done += kCaptureBlock) {
+        const size_t n = std::min(kCaptureBlock, count - done);
+        // Both rings take a block or neither does, so the sender always finds them aligned
+        if (m_captureRing.freeSpace() < n || (withReference && m_referenceRing.freeSpace() < n)) {
+            m_overrunFrames.fetch_add((count - done) / m_channels, std::memory_order_relaxed);
+            return;
+        }
+        if (withReference) {
+            toPcm16(reference + done, n, block); // Written first: whenever the sender sees the audio, its reference is there
+            m_referenceRing.write(block, n);
+        }
+        toPcm16(mic + done, n, block);
+        m_captureRing.write(block, n);
+    }
+}
+
+void IXTranscriber::sender_loop() {
+    const size_t chunkSamples = static_cast<size_t>(m_framesPerBuffer) * m_channels;
+    const size_t deviceChunkSamples = static_cast<size_t>(m_captureRate / 5) * m_channels; // 200 ms at the device rate
+    std::vector<int16_t> deviceChunk(deviceChunkSamples);
+    std::vector<int16_t> referenceChunk(m_echoCancellation ? deviceChunkSamples : 0);
+    const std::vector<int16_t> keepAliveChunk(static_cast<size_t>(m_sampleRate / 10) * m_channels, 0); // 100 ms of silence
+    m_lastSendTime = std::chrono::steady_clock::now();
+    m_capturePosition = 0;
+
+    while (m_senderRunning) {
+        if (m_beginTurnRequested && !m_flushRequested) {
+            // Only once the previous turn's tail is out, or it would be thrown away
+            begin_turn();
+            {
+                std::lock_guard<std::mutex> flushLock(m_flushMutex);
+                m_beginTurnRequested = false;
+            }
+            m_flushCv.notify_all();
+        }
+        check_end_of_turn();
+        pump_replay_buffer();
+
+        const size_t queued = m_captureRing.size();
+        if (queued > m_peakQueueDepth.load(std::memory_order_relaxed)) {
+            m_peakQueueDepth.store(queued, std::memory_order_relaxed);
+        }
+
+        if (queued >= deviceChunkSamples) {
+            m_captureRing.read(deviceChunk.data(), deviceChunkSamples);
+            if (m_echoCancellation) {
+                m_referenceRing.read(referenceChunk.data(), deviceChunkSamples);
+            }
+            stage_captured_audio(deviceChunk.data(), m_echoCancellation ? referenceChunk.data() : nullptr, deviceChunkSamples);
+            while (m_captureStage.size() - m_captureStageRead >= chunkSamples) {
+                process_audio_chunk(m_captureStage.data() + m_captureStageRead, chunkSamples);
+                m_capturePosition += chunkSamples;
+                m_captureStageRead += chunkSamples;
+            }
+            continue;
+        }
+
+        if (m_flushRequested) {
+            // Send the partial tail so the end of the utterance is not lost
+            const size_t tail = m_captureRing.read(deviceChunk.data(), queued);
+            if (m_echoCancellation) {
+                m_referenceRing.read(referenceChunk.data(), tail);
+            }
+            stage_captured_audio(deviceChunk.data(), m_echoCancellation ? referenceChunk.data() : nullptr, tail);
+            if (m_captureStage.size() > m_captureStageRead) {
+                queue_audio_chunk(m_captureStage.data() + m_captureStageRead, m_captureStage.size() - m_captureStageRead, m_capturePosition, true);
+            }
+            m_captureStage.clear();
+            m_captureStageRead = 0;
+            m_capturePosition = 0;
+            {
+                std::lock_guard<std::mutex> flushLock(m_flushMutex);
+                m_flushRequested = false;
+            }
+            m_flushCv.notify_all();
+            continue;
+        }
+
+        // Between turns, keep a warm session from being closed for inactivity
+        if (!m_turnActive && std::chrono::steady_clock::now() - m_lastSendTime >= m_idleKeepAlive
+            && m_webSocket.getReadyState() == ix::ReadyState::Open) {
+            send_audio_chunk(keepAliveChunk.data(), keepAliveChunk.size());
+        }
+
+        std::this_thread::sleep_for(m_senderPollInterval);
+    }
+}
+
+void IXTranscriber::begin_turn()
+{
+    // Start from empty rings so no stale audio from the previous turn is sent (capture is off, so nothing is writing)
+    m_captureRing.discard();
+    m_referenceRing.discard();
+    m_captureResampler.reset();
+    m_referenceResampler.reset();
+    m_captureStage.clear();
+    m_captureStageRead = 0;
+    m_capturePosition = 0;
+    m_peakQueueDepth = 0;
+    m_vad.reset(std::chrono::steady_clock::now());
+    m_silenceGate.reset();
+    m_prerollChunk.clear();
+    m_userSpeaking = false;
+    m_bargeInPending = false;
+    std::lock_guard<std::mutex> replayLock(m_replayMutex);
+    // Audio the previous turn could not deliver belongs to that turn's message; a pending force end still goes first
+    m_replay.clear();
+    m_forceEndFirst = m_forceEndPending;
+}
+
+void IXTranscriber::stage_captured_audio(const int16_t* samples, const int16_t* reference, size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+    if (m_captureStageRead > 0 && m_captureStageRead >= m_captureStage.size() / 2) {
+        // Framed audio is skipped with m_captureStageRead; the unframed rest is moved to the front only now and then
+        m_captureStage.erase(m_captureStage.begin(), m_captureStage.begin() + static_cast<std::ptrdiff_t>(m_captureStageRead));
+        m_captureStageRead = 0;
+    }
+    const size_t staged = m_captureStage.size();
+    m_captureStage.resize(staged + m_captureResampler.maxOutput(count));
+    const size_t produced = m_captureResampler.process(samples, count, m_captureStage.data() + staged);
+    m_captureStage.resize(staged + produced);
+    if (reference == nullptr) {
+        return;
+    }
+
+    // Same resampler settings and input length, so the reference comes out sample-aligned with the microphone
+    m_referenceStage.resize(m_referenceResampler.maxOutput(count));
+    const size_t referenceProduced = m_referenceResampler.process(reference, count, m_referenceStage.data());
+    m_echoCanceller.process(m_captureStage.data() + staged, m_referenceStage.data(), std::min(produced, referenceProduced));
+    std::lock_guard<std::mutex> lock(m_echoStatsMutex);
+    m_echoStats = m_echoCanceller.getStats();
+}
+
+void IXTranscriber::check_end_of_turn()
+{
+    if (!m_endpointingActive) {
+        return;
+    }
+    if (m_endpointer.shouldEndTurn(std::chrono::steady_clock::now())) {
+        m_endpointingActive = false;
+        Base::Logger::log(
+            "End of turn detected (required silence " + std::to_string(m_endpointer.requiredSilenceMs()) + " ms)",
+            Base::DEBUG, __FUNCTION__
+        );
+        // The message is only touched on the main thread: hand the end of the turn to the event flight loop
+        uint64_t generation = 0;
+        if (current_message(&generation))
+            m_endedTurn = generation;
+    }
+}
+
+void IXTranscriber::process_audio_chunk(const int16_t* samples, size_t count)
+{
+    m_vadEvents.clear();
+    const bool containsSpeech = m_vad.process(samples, count, m_vadEvents);
+    for (const auto& event : m_vadEvents) {
+        on_vad_event(event);
+    }
+
+    check_barge_in(m_capturePosition + count);
+
+    switch (m_silenceGate.next(containsSpeech)) {
+    case SilenceGate::Decision::SendWithPreroll:
+        if (!m_prerollChunk.empty()) {
+            queue_audio_chunk(m_prerollChunk.data(), m_prerollChunk.size(), m_capturePosition - m_prerollChunk.size(), true);
+        }
+        queue_audio_chunk(samples, count, m_capturePosition, containsSpeech);
+        break;
+    case SilenceGate::Decision::Send:
+        queue_audio_chunk(samples, count, m_capturePosition, containsSpeech);
+        break;
+    case SilenceGate::Decision::Hold:
+        m_prerollChunk.assign(samples, samples + count); // Capacity is kept, so no allocation after the first hold
+        m_chunksSuppressed.fetch_add(1, std::memory_order_relaxed);
+        break;
+    }
+}
+
+void IXTranscriber::on_vad_event(const VadEvent& event)
+{
+    m_userSpeaking = (event.type == VadEventType::SpeechStart);
+    m_bargeInPending = m_echoCancellation && m_bargeInListener && event.type == VadEventType::SpeechStart;
+    if (event.type == VadEventType::SpeechStart) {
+        m_speechStartPosition = event.samplePosition;
+        m_endpointer.onSpeechStart(event.timestamp);
+    }
+    else {
+        m_endpointer.onSpeechEnd(event.timestamp);
+    }
+    Base::Logger::log(
+        vadEventTypeToString(event.type) + " at " + std::to_string(event.samplePosition * 1000 / m_sampleRate) + " ms",
+        Base::DEBUG, __FUNCTION__
+    );
+    if (m_vadListener) {
+        m_vadListener(event);
+    }
+}
+
+void IXTranscriber::check_barge_in(uint64_t position)
+{
+    if (!m_bargeInPending || position - m_speechStartPosition < static_cast<uint64_t>(m_bargeIn.minSpeechMs) * m_sampleRate / 1000) {
+        return;
+    }
+    m_bargeInPending = false; // One decision per speech run
+    const uint64_t playing = m_echoCanceller.farEndRunSamples();
+    if (playing > 0) {
+        // Until the canceller has converged, the residual of the assistant's own voice looks like the user talking
+        const double erleDb = m_echoCanceller.getStats().erleDb;
+        if (playing < static_cast<uint64_t>(m_bargeIn.playbackMuteMs) * m_sampleRate / 1000 || erleDb < m_bargeIn.minErleDb) {
+            Base::Logger::log(
+                "Speech over playback not treated as barge-in (playing for " + std::to_string(playing * 1000 / m_sampleRate)
+                + " ms, ERLE " + std::to_string(static_cast<int>(erleDb)) + " dB)",
+                Base::DEBUG, __FUNCTION__
+            );
+            return;
+        }
+    }
+    m_bargeInListener();
+}
+
+void IXTranscriber::queue_audio_chunk(const int16_t* samples, size_t count, uint64_t position, bool speech)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_replayMutex);
+        // Anything that cannot go out right now (socket down or a backlog ahead of it) is sent late
+        const bool deferred = m_replay.pendingChunks() > 0 || m_webSocket.getReadyState() != ix::ReadyState::Open;
+        m_replay.append(samples, count, position, deferred, speech);
+    }
+    pump_replay_buffer();
+}
+
+void IXTranscriber::pump_replay_buffer()
+{
+    std::lock_guard<std::mutex> lock(m_replayMutex);
+    const bool open = m_webSocket.getReadyState() == ix::ReadyState::Open;
+    if (!open) {
+        if (m_socketWasOpen) {
+            m_socketWasOpen = false;
+            Base::Logger::log("Transcription socket lost, buffering audio until it reconnects", Base::WARN, __FUNCTION__);
+        }
+        return;
+    }
+    if (!m_socketWasOpen) {
+        m_socketWasOpen = true;
+        if (m_socketEverOpen) {
+            m_replay.noteReconnect();
+            Base::Logger::log(
+                "Transcription socket reconnected, replaying " + std::to_string(m_replay.getStats().pendingMs) + " ms of audio",
+                Base::INFO, __FUNCTION__
+            );
+        }
+        m_socketEverOpen = true;
+    }
+
+    if (m_forceEndPending && !m_flushRequested && (m_forceEndFirst || m_replay.pendingChunks() == 0)) {
+        if (!send_force_end()) {
+            return; // Retried on the next pump; the next turn's audio must not overtake it
+        }
+    }
+
+    if (update_backpressure()) {
+        return; // Over the high watermark: let IXWebSocket drain before queueing more
+    }
+
+    if (m_backpressure.policy != BackpressurePolicy::Wait && m_replay.pendingChunks() > 1) {
+        send_coalesced();
+        return;
+    }
+
+    // A live chunk goes straight out; a backlog is drained in bursts so it catches up faster than real time
+    const int burst = std::max(1, m_replay.getConfig().maxBurstChunks);
+    for (int sent = 0; sent < burst; ++sent) {
+        const AudioReplayBuffer::Chunk* chunk = m_replay.front();
+        if (chunk == nullptr || !send_audio_chunk(chunk->samples.data(), chunk->samples.size())) {
+            break; // A refused chunk stays queued and is retried on the next pump
+        }
+        m_replay.popFront();
+    }
+}
+
+bool IXTranscriber::update_backpressure()
+{
+    const auto now = std::chrono::steady_clock::now();
+    const size_t buffered = m_webSocket.bufferedAmount();
+    const size_t chunkSamples = static_cast<size_t>(m_framesPerBuffer) * m_channels;
+    const uint64_t chunkMs = 1000ULL * m_framesPerBuffer / m_sampleRate;
+    const uint64_t bufferedMs = buffered * chunkMs / std::max<size_t>(1, m_frameWriter.frameSize(chunkSamples));
+
+    m_streamStats.policy = m_backpressure.policy;
+    m_streamStats.bufferedBytes = buffered;
+    m_streamStats.peakBufferedBytes = std::max(m_streamStats.peakBufferedBytes, buffered);
+    m_streamStats.queueDepthMs = m_replay.getStats().pendingMs + bufferedMs;
+    m_streamStats.lagMs = static_cast<uint64_t>(m_replay.oldestAge(now).count()) + bufferedMs;
+    m_streamStats.peakLagMs = std::max(m_streamStats.peakLagMs, m_streamStats.lagMs);
+
+    // Hysteresis between the two watermarks so the sender does not flap around a single threshold
+    if (!m_streamStats.fallingBehind && buffered > m_backpressure.highWatermarkBytes) {
+        m_streamStats.fallingBehind = true;
+        ++m_streamStats.throttleEpisodes;
+        Base::Logger::log(
+            "Transcription stream falling behind real time: " + std::to_string(buffered) + " bytes queued, lag "
+            + std::to_string(m_streamStats.lagMs) + " ms, policy " + backpressurePolicyToString(m_backpressure.policy),
+            Base::WARN, __FUNCTION__
+        );
+    }
+    else if (m_streamStats.fallingBehind && buffered <= m_backpressure.lowWatermarkBytes) {
+        m_streamStats.fallingBehind = false;
+        Base::Logger::log("Transcription stream send queue drained, lag " + std::to_string(m_streamStats.lagMs) + " ms", Base::INFO, __FUNCTION__);
+    }
+
+    if (m_streamStats.fallingBehind && m_backpressure.policy == BackpressurePolicy::DropSilenceFirst) {
+        m_replay.shedSilence();
+    }
+    m_streamStats.silenceShedMs = m_replay.getStats().silenceShedMs;
+    return m_streamStats.fallingBehind;
+}
+
+bool IXTranscriber::send_force_end()
+{
+    ix::WebSocketSendInfo sendInfo = m_webSocket.sendText(AudioFrameWriter::forceEndUtteranceMessage());
+    if (!sendInfo.success) {
+        Base::Logger::log("Force end utterance message sending failed", Base::ERR, __FUNCTION__);
+        return false;
+    }
+    Base::Logger::log("Force end utterance message sent", Base::DEBUG, __FUNCTION__);
+    m_lastSendTime = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> generationLock(m_generationMutex);
+        m_forceEndSent = true;
+        m_forcedFinalDeadline = m_lastSendTime + kForcedFinalTimeout;
+    }
+    m_forceEndPending = false;
+    m_forceEndFirst = false;
+    return true;
+}
+
+bool IXTranscriber::send_coalesced()
+{
+    const size_t chunkSamples = static_cast<size_t>(m_framesPerBuffer) * m_channels;
+    const size_t maxSamples = std::max(chunkSamples,
+        static_cast<size_t>(static_cast<int64_t>(m_sampleRate) * m_channels * m_backpressure.maxCoalesceMs / 1000));
+
+    // Merge the oldest pending chunks into one frame; they are only released once it is accepted
+    m_coalesceBuffer.clear();
+    size_t merged = 0;
+    while (const AudioReplayBuffer::Chunk* chunk = m_replay.pending(merged)) {
+        if (merged > 0 && m_coalesceBuffer.size() + chunk->samples.size() > maxSamples) {
+            break;
+        }
+        m_coalesceBuffer.insert(m_coalesceBuffer.end(), chunk->samples.begin(), chunk->samples.end());
+        ++merged;
+    }
+    if (merged == 0 || !send_audio_chunk(m_coalesceBuffer.data(), m_coalesceBuffer.size())) {
+        return false;
+    }
+    for (size_t i = 0; i < merged; ++i) {
+        m_replay.popFront();
+    }
+    if (merged > 1) {
+        ++m_streamStats.coalescedFrames;
+    }
+    return true;
+}
+
+bool IXTranscriber::send_audio_chunk(const int16_t* samples, size_t count)
+{
+    m_lastSendTime = std::chrono::steady_clock::now();
+    FramePool::Frame frame = m_frameWriter.write(samples, count);
+    ix::WebSocketSendInfo sendInfo = m_frameWriter.isBinary()
+        ? m_webSocket.sendBinary(*frame)
+        : m_webSocket.sendText(*frame);
+    if (sendInfo.success) {
+        m_chunksSent.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    m_sendFailures.fetch_add(1, std::memory_order_relaxed);
+    Base::Logger::log("Audio data sending failed", Base::ERR, __FUNCTION__);
+    return false;
+}
+
+void IXTranscriber::set_frame_mode(AudioFrameMode mode) {
+    std::lock_guard<std::mutex> lock(m_startStopMutex);
+    if (m_running || m_sessionOpen) { // The sender thread frames keep-alive audio between turns
+        Base::Logger::log("Frame mode can only be changed while transcription is stopped and no session is open", Base::ERR, __FUNCTION__);
+        return;
+    }
+    m_frameWriter.setMode(mode);
+    Base::Logger::log("Audio frame mode set to " + audioFrameModeToString(mode), Base::INFO, __FUNCTION__);
+}
+
+void IXTranscriber::set_endpoint(const std::string& url) {
+    std::lock_guard<std::mutex> lock(m_startStopMutex);
+    if (m_running) {
+        Base::Logger::log("Endpoint can only be changed while transcription is stopped", Base::ERR, __FUNCTION__);
+        return;
+    }
+    m_endpoint = url;
+}
+
+void IXTranscriber::set_resampler_quality(Base::ResamplerQuality quality) {
+    std::lock_guard<std::mutex> lock(m_startStopMutex);
+    if (m_running || m_sessionOpen) {
+        Base::Logger::log("Resampler quality can only be changed while transcription is stopped", Base::ERR, __FUNCTION__);
+        return;
+    }
+    m_resamplerQuality = quality;
+    m_captureResampler = Base::PolyphaseResampler(m_captureRate, m_sampleRate, quality);
+    m_referenceResampler = Base::PolyphaseResampler(m_captureRate, m_sampleRate, quality);
+    Base::Logger::log("Capture resampler quality set to " + Base::resamplerQualityToString(quality), Base::INFO, __FUNCTION__);
+}
+
+void IXTranscriber::set_vad_config(const VadConfig& config) {
+    std::lock_guard<std::mutex> lock(m_startStopMutex);
+    if (m_running || m_sessionOpen) { // The sender thread runs the detector while a session is open
+        Base::Logger::log("VAD configuration can only be changed while transcription is stopped and no session is open", Base::ERR, __FUNCTION__);
+        return;
+    }
+    m_vad.setConfig(config);
+    m_silenceGate.setConfig(config);
+}
+
+void IXTranscriber::set_vad_listener(std::function<void(const VadEvent&)> listener) {
+    std::lock_guard<std::mutex> lock(m_startStopMutex);
+    if (m_running || m_sessionOpen) {
+        Base::Logger::log("VAD listener can only be changed while transcription is stopped and no session is open", Base::ERR, __FUNCTION__);
+        return;
+    }
+    m_vadListener = std::move(listener);
+}
+
+void IXTranscriber::set_barge_in_listener(std::function<void()> listener) {
+    std::lock_guard<std::mutex> lock(m_startStopMutex);
+    if (m_running || m_sessionOpen) {
+        Base::Logger::log("Barge-in listener can only be changed while transcription is stopped and no session is open", Base::ERR, __FUNCTION__);
+        return;
+    }
+    m_bargeInListener = std::move(listener);
+}
+
+void IXTranscriber::set_barge_in_config(const BargeInConfig& config) {
+    std::lock_guard<std::mutex> lock(m_startStopMutex);
+    if (m_running || m_sessionOpen) {
+        Base::Logger::log("Barge-in configuration can only be changed while transcription is stopped and no session is open", Base::ERR, __FUNCTION__);
+        return;
+    }
+    m_bargeIn = config;
+}
+
+void IXTranscriber::set_replay_config(const ReplayConfig& config) {
+    std::lock_guard<std::mutex> lock(m_replayMutex);
+    m_replay.setConfig(config);
+}
+
+ReplayStats IXTranscriber::get_replay_stats() const {
+    std::lock_guard<std::mutex> lock(m_replayMutex);
+    return m_replay.getStats();
+}
+
+void IXTranscriber::set_backpressure_config(const BackpressureConfig& config) {
+    std::lock_guard<std::mutex> lock(m_replayMutex);
+    m_backpressure = config;
+    m_streamStats.policy = config.policy;
+    Base::Logger::log("Stream backpressure policy set to " + backpressurePolicyToString(config.policy), Base::INFO, __FUNCTION__);
+}
+
+StreamStats IXTranscriber::get_stream_stats() const {
+    std::lock_guard<std::mutex> lock(m_replayMutex);
+    return m_streamStats;
+}
+
+void IXTranscriber::record_first_partial(std::chrono::steady_clock::time_point received) {
+    std::lock_guard<std::mutex> lock(m_sessionStatsMutex);
+    const auto now = received;
+    if (m_waitingFirstSessionPartial) {
+        m_waitingFirstSessionPartial = false;
+        m_sessionStats.lastHandshakeToFirstPartialMs = static_cast<int>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(now - m_handshakeStart).count());
+    }
+    if (m_waitingFirstPartial) {
+        m_waitingFirstPartial = false;
+        m_sessionStats.lastTurnToFirstPartialMs = static_cast<int>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(now - m_turnStart).count());
+        Base::Logger::log(
+            "First partial " + std::to_string(m_sessionStats.lastTurnToFirstPartialMs) + " ms after turn start (handshake took "
+            + std::to_string(m_sessionStats.lastHandshakeMs) + " ms)",
+            Base::DEBUG, __FUNCTION__
+        );
+    }
+}
+
+Base::EchoCancellerStats IXTranscriber::get_echo_stats() const {
+    std::lock_guard<std::mutex> lock(m_echoStatsMutex);
+    return m_echoStats;
+}
+
+CaptureStats IXTranscriber::get_capture_stats() const {
+    CaptureStats stats;
+    stats.overrunFrames = m_overrunFrames.load(std::memory_order_relaxed);
+    stats.inputOverflows = m_inputOverflows.load(std::memory_order_relaxed);
+    stats.queueDepthFrames = m_captureRing.size() / m_channels;
+    stats.peakQueueDepthFrames = m_peakQueueDepth.load(std::memory_order_relaxed) / m_channels;
+    stats.chunksSent = m_chunksSent.load(std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> lock(m_replayMutex);
+        stats.chunksDropped = m_replay.getStats().droppedChunks;
+    }
+    stats.sendFailures = m_sendFailures.load(std::memory_order_relaxed);
+    stats.chunksSuppressed = m_chunksSuppressed.load(std::memory_order_relaxed);
+    return stats;
+}
+
+
+float IXTranscriber::event_flight_loop(float inElapsedSinceLastCall, float inElapsedTimeSinceLastFlightLoop, int inCounter, void* inRefcon)
+{
+    UNUSED(inElapsedSinceLastCall);
+    UNUSED(inElapsedTimeSinceLastFlightLoop);
+    UNUSED(inCounter);
+    static_cast<IXTranscriber*>(inRefcon)->apply_transcript_events();
+    return -1.0f; // Every frame
+}
+
+size_t IXTranscriber::apply_transcript_events()
+{
+    m_eventBatch.clear();
+    TranscriptEvent event;
+    while (m_eventBatch.size() < kMaxEventBatch && m_transcriptEvents.pop(event)) {
+        m_eventBatch.push_back(std::move(event));
+    }
+    const size_t count = m_eventBatch.size();
+    const uint64_t endedTurn = m_endedTurn.exchange(0); // After the batch: every event queued before the end is in it
+    if (count == 0 && endedTurn == 0) {
+        return 0;
+    }
+
+    uint64_t generation = 0;
+    const std::shared_ptr<Message> message = current_message(&generation);
+    for (size_t i = 0; i < count; ++i) {
+        const TranscriptEvent& current = m_eventBatch[i];
+        if ((current.type == TranscriptEventType::Partial || current.type == TranscriptEventType::Final) && current.generation != generation) {
+            // Finalized after its turn ended; its message was already submitted and must not feed the new turn
+            m_staleEvents.fetch_add(1, std::memory_order_relaxed);
+            Base::Logger::log("Dropped a transcript of an earlier turn: " + current.text, Base::DEBUG, __FUNCTION__);
+            continue;
+        }
+        // Each partial replaces the previous one, so only the newest of a run needs applying
+        if (current.type == TranscriptEventType::Partial && i + 1 < count && m_eventBatch[i + 1].type == TranscriptEventType::Partial) {
+            m_partialsCoalesced.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        apply_event(current, message.get());
+    }
+    if (endedTurn != 0 && endedTurn == generation && message) {
+        message->stopUpdating();
+    }
+    if (count == 0) {
+        return 0;
+    }
+
+    m_eventsApplied.fetch_add(count, std::memory_order_relaxed);
+    m_eventBatches.fetch_add(1, std::memory_order_relaxed);
+    if (count > m_peakEventBatch.load(std::memory_order_relaxed)) {
+        m_peakEventBatch.store(count, std::memory_order_relaxed);
+    }
+    return count;
+}
+
+void IXTranscriber::apply_event(const TranscriptEvent& event, Message* message)
+{
+    switch (event.type) {
+    case TranscriptEventType::Partial:
+        if (!message) { return; } // Pre-warmed session, no turn yet
+        if (!event.text.empty()) {
+            Base::Logger::log("Partial message received: " + event.text, Base::DEBUG, __FUNCTION__);
+            message->setPartialTranscript(event.text);
+            record_first_partial(event.received);
+        }
+        if (message->getType() == MessageType::UserTranscription)
+            m_endpointer.onPartial(event.text, event.received);
+        return;
+    case TranscriptEventType::Final:
+        if (!message || event.text.empty()) { return; }
+        Base::Logger::log("Final message received: " + event.text, Base::DEBUG, __FUNCTION__);
+        message->setFinalTranscript(event.text);
+        if (message->getType() == MessageType::UserTranscription)
+            m_endpointer.onFinal(event.text, event.received);
+        return;
+    case TranscriptEventType::SessionBegins:
+        Base::Logger::log("Session started with ID: " + event.text, Base::INFO, __FUNCTION__);
+        return;
+    case TranscriptEventType::SessionTerminated:
+        Base::Logger::log("Session terminated.", Base::INFO, __FUNCTION__);
+        return;
+    case TranscriptEventType::Error:
+        Base::Logger::log("Error from websocket: " + event.text, Base::ERR, __FUNCTION__);
+        return;
+    default:
+        Base::Logger::log("Unknown message type: " + event.text, Base::ERR, __FUNCTION__);
+        return;
+    }
+}
+
+TranscriptEventStats IXTranscriber::get_event_stats() const {
+    TranscriptEventStats stats;
+    stats.eventsQueued = m_eventsQueued.load(std::memory_order_relaxed);
+    stats.eventsDropped = m_eventsDropped.load(std::memory_order_relaxed);
+    stats.eventsApplied = m_eventsApplied.load(std::memory_order_relaxed);
+    stats.partialsCoalesced = m_partialsCoalesced.load(std::memory_order_relaxed);
+    stats.staleEventsDropped = m_staleEvents.load(std::memory_order_relaxed);
+    stats.parseFallbacks = m_parseFallbacks.load(std::memory_order_relaxed);
+    stats.batches = m_eventBatches.load(std::memory_order_relaxed);
+    stats.peakBatchSize = m_peakEventBatch.load(std::memory_order_relaxed);
+    return stats;
+}
+
+
+void IXTranscriber::on_message(const ix::WebSocketMessagePtr& msg) {
+    try {
+        switch (msg->type) {
+        case ix::WebSocketMessageType::Message: {
+            // Network thread: reduce the message to a small event and hand it over, nothing else
+            TranscriptEvent event;
+            event.received = std::chrono::steady_clock::now();
+            if (!parseTranscriptMessage(msg->str, event)) {
+                m_parseFallbacks.fetch_add(1, std::memory_order_relaxed);
+                if (!parseTranscriptMessageWithJson(msg->str, event)) {
+                    Base::Logger::log("Unrecognized message: " + msg->str, Base::ERR, __FUNCTION__);
+                    return;
+                }
+            }
+            event.generation = stamp_generation(event);
+            if (m_transcriptEvents.push(std::move(event))) {
+                m_eventsQueued.fetch_add(1, std::memory_order_relaxed);
+            }
+            else {
+                m_eventsDropped.fetch_add(1, std::memory_order_relaxed);
+                Base::Logger::log("Transcript event queue full, message dropped", Base::ERR, __FUNCTION__);
+            }
+            return;
+        }
+        case ix::WebSocketMessageType::Open:
+            Base::Logger::log("WebSocket connection opened with message " + msg->str, Base::INFO, __FUNCTION__);
+            Base::Logger::log(
+                "Connection to " + msg->openInfo.uri
+                + " opened with protocol: " + msg->openInfo.protocol
+                + " and handshake headers:",
+                Base::INFO, __FUNCTION__
+            );
+            for (auto it : msg->openInfo.headers) {
+                Base::Logger::log(it.first + ": " + it.second, Base::INFO, __FUNCTION__);
+            }
+            {
+                std::lock_guard<std::mutex> statsLock(m_sessionStatsMutex);
+                m_sessionStats.lastHandshakeMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - m_handshakeStart).count());
+            }
+            return;
+        case ix::WebSocketMessageType::Close:
+            Base::Logger::log("WebSocket connection closed with message " + msg->str, Base::INFO, __FUNCTION__);
+            Base::Logger::log(
+                "Closing connection because error code " + std::to_string(msg->closeInfo.code)
+                + " : " + msg->closeInfo.reason + "(remote ? " + std::to_string(msg->closeInfo.remote) + ")",
+                Base::INFO, __FUNCTION__
+            );
+            return;
+        case ix::WebSocketMessageType::Error:
+            Base::Logger::log("WebSocket error with message " + msg->str, Base::INFO, __FUNCTION__);
+            std::stringstream ss;
+            ss << "Error: " << msg->errorInfo.reason;
+            ss << "\n#retries: " << msg->errorInfo.retries;
+            ss << "\nWait time(ms): " << msg->errorInfo.wait_time;
+            ss << "\nHTTP Status: " << msg->errorInfo.http_status;
+            Base::Logger::log(ss.str(), Base::ERR, __FUNCTION__);
+            return;
+        }
+    }
+    catch (const std::exception& e) {
+		Base::Logger::log(std::string("Exception in WebSocket: ") + e.what(), Base::ERR, __FUNCTION__);
+		throw;
+	}
+}
+
+} // namespace Chat
+} // namespace XPlaneChatBot
+
+
+
@@ -1,86 +1,369 @@
-#ifndef IXTRANSCRIBER_H
-#define IXTRANSCRIBER_H
-
-#include "base/logger.h"
-#include "ChatStructures.hpp"
-
-#include "portaudio.h"
-#include <nlohmann/json.hpp>
-#include <ixwebsocket/IXWebSocket.h>
-#include <ixwebsocket/IXNetSystem.h>
-#include "XPLMProcessing.h"
-
-#include <cstdint>
-#include <string>
-#include <iostream>
-#include <vector>
-#include <deque>
-#include <condition_variable>
-#include <thread>
-#include <atomic>
-#include <mutex>
-#include <memory>
-#include <sstream>
-
-
-namespace XPlaneChatBot {
-    namespace Chat {
-        using Json = nlohmann::json;
-
-        class IXTranscriber
-        {
-        public:
-            IXTranscriber(int sample_rate);
-            ~IXTranscriber();
-
-            void start_transcription(std::shared_ptr<Message>);
-            void stop_transcription();
-
-        private:
-            static int pa_callback(
-                const void* inputBuffer,
-                void* outputBuffer,
-                unsigned long framesPerBuffer,
-                const PaStreamCallbackTimeInfo* timeInfo,
-                PaStreamCallbackFlags statusFlags,
-                void* userData
-            );
-
-            int on_audio_data(const void* inputBuffer, unsigned long framesPerBuffer);
-            void on_message(const ix::WebSocketMessagePtr& msg);
-            const bool isPauseDurationExceeded() const;
-
-            std::shared_ptr<Message> m_message;
-            ix::WebSocket m_webSocket;
-            std::atomic<bool> m_running { false };
-
-            std::string m_terminateMsg{Json({{"terminate_session", true}}).dump()};
-
-            std::vector<char> m_audioDataBuffer;
-            Json m_audioJSON{ {"audio_data", ""} };
-
-            std::deque<std::vector<char>> m_audioQueue;
-            std::mutex m_audioQueueMutex;
-
-            std::mutex m_startStopMutex;
-
-            PaStream* m_audioStream{ nullptr };
-            PaError m_audioErr{ paNoError };
-
-            const std::string m_aaiAPItoken{ "7e4983bb8d1d47acb2dec97ee5e4c3ed" };
-            const int m_sampleRate;
-            const int m_framesPerBuffer;
-            const PaSampleFormat m_format{ paInt16 };
-            const int m_channels{ 1 };
-
-            // To track pause duration
-            std::chrono::steady_clock::time_point m_pauseStartTime{ std::chrono::steady_clock::now() }; ///< Start time of the pause
-            const std::chrono::seconds m_pauseThreshold{ 2 }; ///< Threshold for pause duration (2 seconds)
-        };
-
-    } // namespace Chat
-} // namespace XPlaneChatBot
-
-#endif // IXTRANSCRIBER_H
-
-
+#ifndef IXTRANSCRIBER_H
+#define IXTRANSCRIBER_H
+
+#include "base/logger.h"
+#include "base/ringbuffer.h"
+#include "base/resampler.h"
+#include "base/echocanceller.h"
+#include "AudioEngine.h"
+#include "ChatStructures.hpp"
+#include "AudioFrameWriter.h"
+#include "VoiceActivityDetector.h"
+#include "TurnEndpointer.h"
+#include "AudioReplayBuffer.h"
+#include "TranscriptEvents.h"
+
+#include <nlohmann/json.hpp>
+#include <ixwebsocket/IXWebSocket.h>
+#include <ixwebsocket/IXNetSystem.h>
+#include "XPLMProcessing.h"
+
+#include <cstdint>
+#include <string>
+#include <iostream>
+#include <vector>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <sstream>
+#include <functional>
+
+
+namespace XPlaneChatBot {
+    namespace Chat {
+        using Json = nlohmann::json;
+
+        /// @brief Snapshot of the capture path counters (see IXTranscriber::get_capture_stats)
+        struct CaptureStats {
+            uint64_t overrunFrames{ 0 }; ///< Frames dropped by the capture callback because the ring buffer was full
+            uint64_t inputOverflows{ 0 }; ///< Callbacks where PortAudio itself reported an input overflow
+            size_t queueDepthFrames{ 0 }; ///< Frames currently waiting in the ring buffer
+            size_t peakQueueDepthFrames{ 0 }; ///< Highest queue depth seen by the sender thread
+            uint64_t chunksSent{ 0 }; ///< Audio chunks handed to the websocket
+            uint64_t chunksDropped{ 0 }; ///< Audio chunks discarded before they could be sent (replay buffer full or session closed)
+            uint64_t chunksSuppressed{ 0 }; ///< Silent audio chunks held back by the silence gate
+            uint64_t sendFailures{ 0 }; ///< Audio chunks the websocket refused to send
+        };
+
+        /// @brief How the websocket session is managed across user turns
+        enum class SessionMode {
+            PerTurn, ///< Terminate the session when a turn stops (prewarm() can still open the next one early)
+            Persistent, ///< Keep one session open across turns and only force the end of the utterance
+        };
+
+        /// @brief What the sender does when the websocket send queue passes the high watermark
+        enum class BackpressurePolicy {
+            Wait, ///< Stop sending until the queue drains below the low watermark (the replay buffer absorbs the backlog)
+            Coalesce, ///< Wait, then send the backlog merged into fewer, larger frames
+            DropSilenceFirst, ///< Coalesce, and discard buffered silence while over the watermark so speech catches up first
+        };
+
+        static const std::string backpressurePolicyToString(const BackpressurePolicy& policy) {
+            switch (policy) {
+            case BackpressurePolicy::Wait: return "Wait";
+            case BackpressurePolicy::Coalesce: return "Coalesce";
+            case BackpressurePolicy::DropSilenceFirst: return "DropSilenceFirst";
+            default: return "Unknown";
+            }
+        }
+
+        /// @brief Watermarks on the bytes IXWebSocket has queued but not yet written to the socket
+        struct BackpressureConfig {
+            BackpressurePolicy policy{ BackpressurePolicy::DropSilenceFirst };
+            size_t highWatermarkBytes{ 64 * 1024 }; ///< Start shedding above this (about 1.5 s of base64 audio)
+            size_t lowWatermarkBytes{ 16 * 1024 }; ///< Resume normal streaming below this
+            int maxCoalesceMs{ 1000 }; ///< Largest frame built when coalescing (the realtime API accepts up to 2 s)
+        };
+
+        /// @brief How far the outgoing stream is behind real time (see IXTranscriber::get_stream_stats)
+        struct StreamStats {
+            BackpressurePolicy policy{ BackpressurePolicy::DropSilenceFirst };
+            size_t bufferedBytes{ 0 }; ///< Bytes queued in IXWebSocket at the last check
+            size_t peakBufferedBytes{ 0 }; ///< Highest value of bufferedBytes
+            uint64_t queueDepthMs{ 0 }; ///< Audio waiting in the replay buffer plus the websocket send queue
+            uint64_t lagMs{ 0 }; ///< Age of the oldest unsent audio plus the send queue, i.e. delay behind real time
+            uint64_t peakLagMs{ 0 }; ///< Highest value of lagMs
+            bool fallingBehind{ false }; ///< True while the send queue is over the high watermark
+            uint64_t throttleEpisodes{ 0 }; ///< Times the high watermark was crossed
+            uint64_t coalescedFrames{ 0 }; ///< Frames that carried more than one chunk
+            uint64_t silenceShedMs{ 0 }; ///< Buffered silence discarded to catch up
+        };
+
+        /// @brief When the user talking over the assistant interrupts it (duplex only, see IXTranscriber::set_barge_in_listener)
+        struct BargeInConfig {
+            int minSpeechMs{ 300 }; ///< Speech must last this long, so a cough or a click does not interrupt
+            double minErleDb{ 10.0 }; ///< While the speaker plays, the echo canceller must remove at least this much echo
+            int playbackMuteMs{ 400 }; ///< Ignore speech during the first part of playback, where the residual is largest
+        };
+
+        /// @brief Session reuse and handshake latency figures (see IXTranscriber::get_session_stats)
+        struct SessionStats {
+            uint64_t sessionsOpened{ 0 }; ///< Websocket sessions started
+            uint64_t warmTurns{ 0 }; ///< Turns that started on an already open session
+            uint64_t coldTurns{ 0 }; ///< Turns that had to open a session first
+            int lastHandshakeMs{ 0 }; ///< Connect start to websocket open, for the last session
+            int lastHandshakeToFirstPartialMs{ 0 }; ///< Connect start to the first non-empty partial of the last session
+            int lastTurnToFirstPartialMs{ 0 }; ///< Turn start to its first non-empty partial, for the last turn
+        };
+
+        class IXTranscriber
+        {
+        public:
+            /**
+             * @brief Attach to the engine's microphone
+             * @param engine Owner of the capture stream; with a duplex stream the echo of the speaker is cancelled, so
+             * transcription can run while the assistant speaks
+             * @param sample_rate Rate the STT service expects
+             */
+            IXTranscriber(AudioEngine& engine, int sample_rate);
+            ~IXTranscriber();
+
+            void start_transcription(std::shared_ptr<Message>);
+            void stop_transcription();
+
+            /**
+             * @brief Open the websocket session ahead of the next turn (e.g. while the AI is still speaking)
+             * so DNS, TLS and the handshake are done by the time start_transcription is called
+             */
+            void prewarm();
+
+            /// @brief Choose whether sessions end with each turn or stay open across turns (only while stopped)
+            void set_session_mode(SessionMode mode);
+
+            /// @brief Session reuse counters and handshake-to-first-partial timings
+            SessionStats get_session_stats() const;
+
+            /// @brief Get a snapshot of the capture counters (safe to call from any thread)
+            CaptureStats get_capture_stats() const;
+
+            /**
+             * @brief Select the wire format for audio frames (only while stopped, with no session open)
+             * @param mode Base64Json for the AssemblyAI realtime API, BinaryPcm for endpoints that accept raw PCM
+             */
+            void set_frame_mode(AudioFrameMode mode);
+
+            /**
+             * @brief Override the websocket endpoint (only while stopped), e.g. to point at a local stand-in server
+             * @param url Base URL; the sample_rate query parameter is appended
+             */
+            void set_endpoint(const std::string& url);
+
+            /// @brief Replace the voice activity detector and silence gating parameters (only while stopped, with no session open)
+            void set_vad_config(const VadConfig& config);
+
+            /**
+             * @brief Register a callback for speech start/end events
+             * @note Called on the sender thread; keep it short and thread-safe. Set it only while stopped, with no session open.
+             */
+            void set_vad_listener(std::function<void(const VadEvent&)> listener);
+
+            /**
+             * @brief Register a callback for the user talking over the assistant, once per speech run (only while stopped,
+             * with no session open)
+             * @note Only raised with echo cancellation, once the speech has lasted BargeInConfig::minSpeechMs and, if the
+             * speaker is playing, once its echo is cancelled well enough that the speech cannot be the assistant's own
+             * voice. Called on the sender thread.
+             */
+            void set_barge_in_listener(std::function<void()> listener);
+
+            /// @brief Replace the barge-in thresholds (only while stopped, with no session open)
+            void set_barge_in_config(const BargeInConfig& config);
+
+            /// @brief True while the voice activity detector hears the user speaking
+            bool is_user_speaking() const { return m_userSpeaking; }
+
+            /// @brief Replace the end-of-turn detection parameters (the speaker model is kept)
+            void set_endpointer_config(const EndpointerConfig& config) { m_endpointer.setConfig(config); }
+
+            /// @brief Turn counts, false cut-offs and end-of-turn latency figures
+            EndpointerStats get_endpointer_stats() const { return m_endpointer.getStats(); }
+
+            /// @brief Replace the replay buffer memory cap and catch-up burst size (safe to call at any time)
+            void set_replay_config(const ReplayConfig& config);
+
+            /// @brief Reconnects, replayed and dropped audio of the reconnect replay buffer
+            ReplayStats get_replay_stats() const;
+
+            /// @brief Replace the send queue watermarks and load shedding policy (safe to call at any time)
+            void set_backpressure_config(const BackpressureConfig& config);
+
+            /// @brief Send queue depth and lag behind real time of the outgoing audio stream
+            StreamStats get_stream_stats() const;
+
+            /**
+             * @brief Apply queued transcript events to the current message in one batch, then end its turn if the
+             * endpointer has ended it
+             * @note Single consumer: called every frame by the transcriber's flight loop on the X-Plane main thread,
+             * which is also the thread that draws the messages
+             * @return Number of events taken from the queue
+             */
+            size_t apply_transcript_events();
+
+            /// @brief Queue, coalescing and parser fallback counters of the transcript event path
+            TranscriptEventStats get_event_stats() const;
+
+            /// @brief Filter quality (and latency) used to convert the device rate to the STT rate (only while stopped)
+            void set_resampler_quality(Base::ResamplerQuality quality);
+
+            /// @brief Rate the microphone stream actually runs at (the device's native rate when it could be opened)
+            int get_capture_rate() const { return m_captureRate; }
+
+            /// @brief True if the speaker echo is removed from the microphone (the engine runs a duplex stream)
+            bool has_echo_cancellation() const { return m_echoCancellation; }
+
+            /// @brief Convergence and double-talk figures of the echo canceller (safe to call from any thread)
+            Base::EchoCancellerStats get_echo_stats() const;
+
+        private:
+            void on_audio_data(const float* mic, const float* reference, size_t count, PaStreamCallbackFlags statusFlags);
+            void sender_loop();
+            void begin_turn();
+            void stage_captured_audio(const int16_t* samples, const int16_t* reference, size_t count);
+            void process_audio_chunk(const int16_t* samples, size_t count);
+            void queue_audio_chunk(const int16_t* samples, size_t count, uint64_t position, bool speech);
+            void pump_replay_buffer();
+            bool update_backpressure();
+            bool send_force_end();
+            bool send_coalesced();
+            bool send_audio_chunk(const int16_t* samples, size_t count);
+            void on_vad_event(const VadEvent& event);
+            void check_barge_in(uint64_t position);
+            void on_message(const ix::WebSocketMessagePtr& msg);
+            void apply_event(const TranscriptEvent& event, Message* message);
+            static float event_flight_loop(float inElapsedSinceLastCall, float inElapsedTimeSinceLastFlightLoop, int inCounter, void* inRefcon);
+            void check_end_of_turn();
+            void open_session();
+            void close_session();
+            void record_first_partial(std::chrono::steady_clock::time_point received);
+            uint64_t stamp_generation(const TranscriptEvent& event);
+            std::shared_ptr<Message> current_message(uint64_t* generation = nullptr) const;
+            void set_current_message(std::shared_ptr<Message> message, uint64_t generation);
+
+            std::shared_ptr<Message> m_message; ///< Message of the current turn
+            uint64_t m_messageGeneration{ 0 }; ///< Turn m_message belongs to
+            mutable std::mutex m_messageMutex; ///< Protects m_message and m_messageGeneration
+
+            // Turn generations: the server finalizes a turn after the next one may have started, so every transcript
+            // is stamped with the turn it belongs to and only applied to that turn's message
+            std::mutex m_generationMutex; ///< Protects the fields below
+            uint64_t m_turnGeneration{ 0 }; ///< Bumped by start_transcription
+            uint64_t m_eventGeneration{ 0 }; ///< Turn the server's transcripts belong to right now
+            bool m_forcedFinalPending{ false }; ///< Persistent mode: the server still owes the Final of the previous turn
+            bool m_forceEndSent{ false }; ///< Its ForceEndUtterance went out, so the next Final is the one owed
+            std::chrono::steady_clock::time_point m_forcedFinalDeadline{ std::chrono::steady_clock::time_point::max() }; ///< Stop waiting for it then
+            ix::WebSocket m_webSocket;
+            std::atomic<bool> m_running { false };
+            std::atomic<bool> m_capturing{ false }; ///< The capture callback writes into the rings while set
+
+            // Session management
+            SessionMode m_sessionMode{ SessionMode::PerTurn };
+            bool m_sessionOpen{ false }; ///< True between open_session and close_session (guarded by m_startStopMutex)
+            std::atomic<bool> m_turnActive{ false }; ///< True while a turn is capturing
+            std::chrono::steady_clock::time_point m_lastSendTime{}; ///< Last frame sent, only touched by the sender thread
+            const std::chrono::milliseconds m_idleKeepAlive{ 5000 }; ///< Silence sent between turns to keep the session alive
+            mutable std::mutex m_sessionStatsMutex; ///< Protects the session timing fields below
+            SessionStats m_sessionStats;
+            std::chrono::steady_clock::time_point m_handshakeStart{};
+            std::chrono::steady_clock::time_point m_turnStart{};
+            bool m_waitingFirstSessionPartial{ false };
+            bool m_waitingFirstPartial{ false };
+
+            std::string m_endpoint{ "wss://api.assemblyai.com/v2/realtime/ws" }; ///< Streaming STT endpoint
+
+            // Capture path: the engine's callback only writes into the ring buffers, the sender thread drains them,
+            // converts them from the device rate to the STT rate, cancels the echo and frames the result
+            AudioEngine& m_engine;
+            int m_captureRate; ///< Rate the microphone runs at (native device rate, falls back to m_sampleRate)
+            Base::SpscRingBuffer<int16_t> m_captureRing; ///< Captured samples (at m_captureRate) waiting to be sent
+            Base::SpscRingBuffer<int16_t> m_referenceRing; ///< Speaker samples matching m_captureRing one to one (duplex only)
+            Base::ResamplerQuality m_resamplerQuality{ Base::ResamplerQuality::Balanced };
+            Base::PolyphaseResampler m_captureResampler; ///< m_captureRate to m_sampleRate, only used by the sender thread
+            Base::PolyphaseResampler m_referenceResampler; ///< Same conversion for the reference, so both stay aligned
+            std::vector<int16_t> m_captureStage; ///< Resampled audio not yet framed into a chunk, only used by the sender thread
+            size_t m_captureStageRead{ 0 }; ///< Start of the unframed audio in m_captureStage
+            std::vector<int16_t> m_referenceStage; ///< Resampled reference of the last staged block, only used by the sender thread
+            const bool m_echoCancellation; ///< Set when the engine provides a reference
+            Base::EchoCanceller m_echoCanceller; ///< At m_sampleRate, kept across turns so it stays converged
+            Base::EchoCancellerStats m_echoStats; ///< Copied from m_echoCanceller after every block
+            mutable std::mutex m_echoStatsMutex; ///< Protects m_echoStats
+            std::thread m_senderThread; ///< Thread that frames and sends captured audio
+            std::atomic<bool> m_senderRunning{ false }; ///< Keeps the sender thread alive
+            const std::chrono::milliseconds m_senderPollInterval{ 20 }; ///< How often the sender checks the ring buffer
+            std::atomic<bool> m_flushRequested{ false }; ///< Set by stop_transcription, cleared by the sender once the tail is sent
+            std::atomic<bool> m_beginTurnRequested{ false }; ///< Set by start_transcription, cleared by the sender once the capture state is reset
+            std::mutex m_flushMutex; ///< Protects m_flushRequested and m_beginTurnRequested
+            std::condition_variable m_flushCv; ///< Signals that the flush or the reset is done
+            std::atomic<bool> m_forceEndPending{ false }; ///< Persistent mode: ForceEndUtterance waiting for the tail and an open socket
+            bool m_forceEndFirst{ false }; ///< The pending force end goes before everything queued (guarded by m_replayMutex)
+
+            // Capture counters
+            std::atomic<uint64_t> m_overrunFrames{ 0 };
+            std::atomic<uint64_t> m_inputOverflows{ 0 };
+            std::atomic<size_t> m_peakQueueDepth{ 0 };
+            std::atomic<uint64_t> m_chunksSent{ 0 };
+            std::atomic<uint64_t> m_sendFailures{ 0 };
+            std::atomic<uint64_t> m_chunksSuppressed{ 0 };
+
+            std::mutex m_startStopMutex;
+
+            const std::string m_aaiAPItoken{ "7e4983bb8d1d47acb2dec97ee5e4c3ed" };
+            const int m_sampleRate;
+            const int m_framesPerBuffer;
+            const int m_channels{ 1 };
+
+            AudioFrameWriter m_frameWriter; ///< Serializes chunks into pooled frames, only used by the sender thread
+
+            // Voice activity detection, run by the sender thread on every chunk
+            VoiceActivityDetector m_vad; ///< Energy + zero-crossing detector
+            SilenceGate m_silenceGate; ///< Decides which silent chunks are sent
+            std::vector<VadEvent> m_vadEvents; ///< Events raised by the last chunk (reused)
+            std::vector<int16_t> m_prerollChunk; ///< Last held-back chunk, sent ahead of speech so onsets are not clipped
+            std::function<void(const VadEvent&)> m_vadListener; ///< Optional speech start/end callback
+            std::atomic<bool> m_userSpeaking{ false }; ///< Mirrors the detector state for other threads
+
+            // Barge-in, decided by the sender thread from the detector and the echo canceller
+            BargeInConfig m_bargeIn;
+            std::function<void()> m_bargeInListener;
+            uint64_t m_speechStartPosition{ 0 }; ///< Capture position of the last SpeechStart
+            bool m_bargeInPending{ false }; ///< Speech run not yet reported or rejected
+
+            // End-of-turn detection for user transcriptions
+            TurnEndpointer m_endpointer; ///< Adaptive endpointer fed by VAD events and transcripts
+            std::atomic<bool> m_endpointingActive{ false }; ///< True while the current user turn may still be ended
+            std::atomic<uint64_t> m_endedTurn{ 0 }; ///< Turn the endpointer ended, applied by apply_transcript_events (0 when none)
+
+            // Reconnect safety: every chunk to be streamed goes through the replay buffer, so audio captured while the
+            // socket is down (or still handshaking) is sent late instead of being lost
+            AudioReplayBuffer m_replay; ///< Chunks waiting to be sent, in capture order
+            mutable std::mutex m_replayMutex; ///< Protects m_replay (the sender thread is its main user)
+            uint64_t m_capturePosition{ 0 }; ///< Samples read from the capture ring this turn, only touched by the sender thread
+            bool m_socketWasOpen{ false }; ///< Socket state at the previous pump, only touched by the sender thread
+            bool m_socketEverOpen{ false }; ///< Distinguishes a reconnect from the first open of a session
+
+            // Incoming messages: the websocket thread parses and queues them, the flight loop applies them
+            Base::SpscRingBuffer<TranscriptEvent> m_transcriptEvents; ///< Produced by the websocket thread only
+            std::vector<TranscriptEvent> m_eventBatch; ///< Events taken in the current batch, only touched by the consumer
+            XPLMFlightLoopID m_eventFlightLoop{ nullptr }; ///< Drains m_transcriptEvents every frame
+            std::atomic<uint64_t> m_eventsQueued{ 0 };
+            std::atomic<uint64_t> m_eventsDropped{ 0 };
+            std::atomic<uint64_t> m_eventsApplied{ 0 };
+            std::atomic<uint64_t> m_partialsCoalesced{ 0 };
+            std::atomic<uint64_t> m_staleEvents{ 0 };
+            std::atomic<uint64_t> m_parseFallbacks{ 0 };
+            std::atomic<uint64_t> m_eventBatches{ 0 };
+            std::atomic<size_t> m_peakEventBatch{ 0 };
+
+            // Backpressure on the websocket send queue (guarded by m_replayMutex)
+            BackpressureConfig m_backpressure; ///< Watermarks and shedding policy
+            StreamStats m_streamStats; ///< Updated on every pump
+            std::vector<int16_t> m_coalesceBuffer; ///< Backlog merged into one frame, only touched by the sender thread
+        };
+
+    } // namespace Chat
+} // namespace XPlaneChatBot
+
+#endif // IXTRANSCRIBER_H
+
+
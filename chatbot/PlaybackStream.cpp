@@ -0,0 +1,229 @@
+/**
+ * @file PlaybackStream.cpp
+ * @author zah
+ * @brief Implementation of the persistent playback stream
+ * @see PlaybackStream.h
+ * @version 0.1
+ * @date 2024-06-24
+ *
+ */
+
+#include "PlaybackStream.h"
+
+#include "base/logger.h"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+
+namespace XPlaneChatBot {
+namespace Chat {
+
+PlaybackStream::PlaybackStream(AudioEngine& engine, const PlaybackConfig& config)
+    : m_engine(engine)
+    , m_sampleRate(engine.outputRate())
+    , m_config{ std::max(config.crossfadeMs, 0), std::max<size_t>(config.maxQueued, 2) }
+    , m_crossfadeSamples(static_cast<size_t>(m_config.crossfadeMs) * static_cast<size_t>(m_sampleRate) / 1000 * openai::CHANNELS)
+    , m_incoming(m_config.maxQueued)
+    , m_fadeTail(m_crossfadeSamples)
+    , m_fadeHead(m_crossfadeSamples)
+{
+    if (!m_engine.hasOutput()) {
+        Base::Logger::log("No output stream, replies will not be played", Base::ERR, __FUNCTION__);
+        return;
+    }
+    // Wake the waiters if the device goes away, nothing would ever finish otherwise
+    m_engine.setRenderCallback([this](float* out, size_t count) { fill(out, count); }, [this] { stopped(); });
+    Base::Logger::log("Playback attached at " + std::to_string(m_sampleRate) + " Hz", Base::DEBUG, __FUNCTION__);
+}
+
+PlaybackStream::~PlaybackStream() {
+    m_engine.setRenderCallback({}); // Returns once the callback is out of fill()
+    stopped();
+    m_entries.clear();
+}
+
+void PlaybackStream::stopped() {
+    m_finished.store(std::numeric_limits<Sequence>::max(), std::memory_order_release);
+    m_finished.notify_all();
+}
+
+PlaybackStream::Sequence PlaybackStream::enqueue(std::shared_ptr<openai::SharedAudioData> audio, bool continuesPrevious) {
+    if (!isOpen() || !audio) {
+        return 0;
+    }
+    releaseFinished();
+    if (m_entries.size() >= m_config.maxQueued) {
+        Base::Logger::log("Playback queue is full", Base::ERR, __FUNCTION__);
+        return 0;
+    }
+    const Sequence sequence = m_lastSequence + 1;
+    Source source{ audio.get(), sequence, continuesPrevious };
+    m_entries.push_back(Entry{ std::move(audio), sequence }); // Owned before the callback can see it
+    if (!m_incoming.push(std::move(source))) {
+        m_entries.pop_back();
+        Base::Logger::log("Playback queue is full", Base::ERR, __FUNCTION__);
+        return 0;
+    }
+    m_lastSequence = sequence;
+    return sequence;
+}
+
+void PlaybackStream::waitFinished(Sequence sequence) {
+    Sequence finished = m_finished.load(std::memory_order_acquire);
+    while (finished < sequence) {
+        m_finished.wait(finished, std::memory_order_acquire);
+        finished = m_finished.load(std::memory_order_acquire);
+    }
+    releaseFinished();
+}
+
+void PlaybackStream::releaseFinished() {
+    const Sequence finished = m_finished.load(std::memory_order_acquire);
+    while (!m_entries.empty() && m_entries.front().sequence <= finished) {
+        m_entries.pop_front();
+    }
+}
+
+PlaybackStats PlaybackStream::getStats() const {
+    const double samplesPerMs = static_cast<double>(m_sampleRate) * openai::CHANNELS / 1000.0;
+    PlaybackStats stats;
+    stats.sources = m_sources.load();
+    stats.gapsMeasured = m_gapsMeasured.load();
+    stats.lastGapMs = static_cast<double>(m_lastGapSamples.load()) / samplesPerMs;
+    stats.maxGapMs = static_cast<double>(m_maxGapSamples.load()) / samplesPerMs;
+    if (stats.gapsMeasured > 0) {
+        stats.averageGapMs = static_cast<double>(m_gapSamples.load()) / samplesPerMs / static_cast<double>(stats.gapsMeasured);
+    }
+    stats.crossfades = m_crossfades.load();
+    stats.underruns = m_underruns.load();
+    return stats;
+}
+
+
+void PlaybackStream::fill(float* out, size_t count) {
+    // The engine zeroes the buffer: silence wherever no source has audio
+    size_t written = 0;
+    while (written < count) {
+        if (!m_current.audio) {
+            if (!nextSource(m_current)) {
+                break; // Idle
+            }
+            m_currentStarted = false;
+        }
+        if (m_crossfadeSamples > 0 && m_currentStarted) {
+            const size_t blended = crossfade(out + written, count - written, m_position + written);
+            if (blended > 0) {
+                written += blended;
+                continue;
+            }
+        }
+
+        openai::SharedAudioData* audio = m_current.audio;
+        const bool ended = audio->isEndOfData(); // Before reading: the last samples are written before the end is signalled
+        size_t wanted = count - written;
+        bool holdTail = false;
+        if (ended && m_crossfadeSamples > 0 && m_currentStarted) {
+            // Stop short of the tail when it can be blended into the next sentence
+            const size_t tail = audio->bufferedSamples();
+            if (tail > m_crossfadeSamples && nextReady(m_crossfadeSamples) && tail - m_crossfadeSamples <= wanted) {
+                wanted = tail - m_crossfadeSamples;
+                holdTail = true;
+            }
+        }
+        const size_t read = audio->getData(out + written, wanted);
+        if (read > 0 && !m_currentStarted) {
+            sourceStarted(m_position + written);
+        }
+        written += read;
+        if (written == count) {
+            break;
+        }
+        if (holdTail) {
+            continue; // The tail is crossfaded next
+        }
+        if (ended) {
+            sourceFinished(m_position + written);
+            continue; // Carry on with the next source in the same buffer
+        }
+        if (m_currentStarted) {
+            m_underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+        break; // Waiting for audio
+    }
+    m_position += count;
+}
+
+bool PlaybackStream::nextSource(Source& source) {
+    if (m_next.audio) {
+        source = m_next;
+        m_next = Source{};
+        return true;
+    }
+    return m_incoming.pop(source);
+}
+
+size_t PlaybackStream::crossfade(float* out, size_t count, uint64_t position) {
+    openai::SharedAudioData* audio = m_current.audio;
+    if (!audio->isEndOfData() || audio->isCancelled()) {
+        return 0;
+    }
+    const size_t tail = audio->bufferedSamples();
+    if (tail == 0 || tail > m_crossfadeSamples || tail > count) {
+        return 0;
+    }
+    if (!nextReady(tail)) {
+        return 0; // Not the same turn, or its audio is not there yet: play the tail as is
+    }
+
+    const size_t n = audio->getData(m_fadeTail.data(), tail);
+    const size_t head = m_next.audio->getData(m_fadeHead.data(), n);
+    std::fill(m_fadeHead.begin() + static_cast<std::ptrdiff_t>(head), m_fadeHead.begin() + static_cast<std::ptrdiff_t>(n), 0.0f);
+    for (size_t i = 0; i < n; ++i) {
+        const float t = static_cast<float>(i + 1) / static_cast<float>(n + 1);
+        out[i] = m_fadeTail[i] * (1.0f - t) + m_fadeHead[i] * t;
+    }
+    m_crossfades.fetch_add(1, std::memory_order_relaxed);
+
+    sourceFinished(position + n);
+    m_current = m_next;
+    m_next = Source{};
+    sourceStarted(position); // Overlaps the previous source, measured as no gap
+    return n;
+}
+
+bool PlaybackStream::nextReady(size_t samples) {
+    if (!m_next.audio && !m_incoming.pop(m_next)) {
+        return false;
+    }
+    return m_next.continuesPrevious && !m_next.audio->isCancelled() && m_next.audio->bufferedSamples() >= samples;
+}
+
+void PlaybackStream::sourceStarted(uint64_t position) {
+    m_currentStarted = true;
+    if (!m_current.continuesPrevious || !m_lastEndValid) {
+        return;
+    }
+    const uint64_t gap = position > m_lastEnd ? position - m_lastEnd : 0;
+    m_gapsMeasured.fetch_add(1, std::memory_order_relaxed);
+    m_gapSamples.fetch_add(gap, std::memory_order_relaxed);
+    m_lastGapSamples.store(gap, std::memory_order_relaxed);
+    if (gap > m_maxGapSamples.load(std::memory_order_relaxed)) {
+        m_maxGapSamples.store(gap, std::memory_order_relaxed);
+    }
+}
+
+void PlaybackStream::sourceFinished(uint64_t position) {
+    m_lastEndValid = m_currentStarted && !m_current.audio->isCancelled();
+    m_lastEnd = position;
+    m_sources.fetch_add(1, std::memory_order_relaxed);
+    const Sequence sequence = m_current.sequence;
+    m_current = Source{};
+    m_currentStarted = false;
+    // The producer may free the source from here on
+    m_finished.store(sequence, std::memory_order_release);
+    m_finished.notify_all();
+}
+
+} // namespace Chat
+} // namespace XPlaneChatBot
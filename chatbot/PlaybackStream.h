@@ -0,0 +1,152 @@
+/**
+ * @file PlaybackStream.h
+ * @author zah
+ * @brief Gapless queue of TTS sentences rendered into the session's output stream
+ *
+ * The output stream belongs to the AudioEngine and keeps running for the whole session, playing silence while
+ * nothing is queued. Sentences are queued as SharedAudioData sources; the render callback moves from one source to
+ * the next within the same buffer, so there is no stream open/close and no sleep between sentences. When the next sentence of the same turn is
+ * already buffered, the last few milliseconds of one sentence are crossfaded into the first ones of the next.
+ *
+ * The callback never locks or allocates: sources reach it through an SPSC ring and it reports a finished source by
+ * bumping an atomic sequence number that waitFinished() blocks on (C++20 atomic wait, no polling). The gap between
+ * two sentences of a turn is measured at the callback, in output samples.
+ *
+ * @version 0.1
+ * @date 2024-06-24
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_CHAT_PLAYBACKSTREAM_H
+#define XPROTECTION_CHAT_PLAYBACKSTREAM_H
+
+#include "base/ringbuffer.h"
+#include "chatbot/AudioEngine.h"
+#include "chatbot/openai.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace XPlaneChatBot {
+	namespace Chat {
+
+		/// @brief Configuration of the playback stream
+		struct PlaybackConfig {
+			int crossfadeMs{ 10 }; ///< Longest tail blended into the next sentence (0 disables the crossfade)
+			size_t maxQueued{ 8 }; ///< Sources queued and not finished
+		};
+
+		/// @brief Sentence boundary statistics of the playback stream
+		struct PlaybackStats {
+			uint64_t sources{ 0 }; ///< Sources played to the end (or cancelled)
+			uint64_t gapsMeasured{ 0 }; ///< Boundaries between two sentences of a turn
+			double lastGapMs{ 0.0 }; ///< Silence between the last two sentences of a turn
+			double averageGapMs{ 0.0 };
+			double maxGapMs{ 0.0 };
+			uint64_t crossfades{ 0 }; ///< Boundaries with no gap at all (the tail was blended into the next sentence)
+			uint64_t underruns{ 0 }; ///< Buffers cut short because a sentence's audio had not arrived yet
+		};
+
+		/// @brief Persistent output stream with a gapless playback queue
+		class PlaybackStream {
+		public:
+			/// @brief Sequence number of a queued source (0 is never used)
+			using Sequence = uint64_t;
+
+			/**
+			 * @brief Start rendering into the engine's output
+			 * @param engine Owner of the output stream (queued audio must be at its output rate)
+			 * @param config Crossfade length and queue size
+			 */
+			explicit PlaybackStream(AudioEngine& engine, const PlaybackConfig& config = PlaybackConfig{});
+
+			/// @brief Detaches from the engine; sources still queued are reported as finished
+			~PlaybackStream();
+
+			PlaybackStream(const PlaybackStream&) = delete;
+			PlaybackStream& operator=(const PlaybackStream&) = delete;
+
+			int sampleRate() const { return m_sampleRate; }
+
+			/// @brief True if the engine has an output stream
+			bool isOpen() const { return m_engine.hasOutput(); }
+
+			/**
+			 * @brief Queue a source behind the ones already queued (a single producer thread)
+			 * @param audio Decoded audio; kept alive until it has finished playing
+			 * @param continuesPrevious The source follows the previous one within a turn (crossfade and gap measurement)
+			 * @return Sequence to wait for, or 0 if the stream is not open or the queue is full
+			 */
+			Sequence enqueue(std::shared_ptr<openai::SharedAudioData> audio, bool continuesPrevious);
+
+			/// @brief Block until the source has been played to its end or cancelled (returns at once for 0)
+			void waitFinished(Sequence sequence);
+
+			PlaybackStats getStats() const;
+
+		private:
+			/// @brief A queued source as seen by the callback
+			struct Source {
+				openai::SharedAudioData* audio{ nullptr };
+				Sequence sequence{ 0 };
+				bool continuesPrevious{ false };
+			};
+
+			/// @brief A queued source as seen by the producer, which owns it
+			struct Entry {
+				std::shared_ptr<openai::SharedAudioData> audio;
+				Sequence sequence{ 0 };
+			};
+
+			/// @brief Wake the waiters for good (the output stream stopped)
+			void stopped();
+
+			// Render callback only
+			void fill(float* out, size_t count);
+			bool nextSource(Source& source);
+			size_t crossfade(float* out, size_t count, uint64_t position);
+			bool nextReady(size_t samples);
+			void sourceStarted(uint64_t position);
+			void sourceFinished(uint64_t position);
+
+			/// @brief Release the entries the callback is done with (producer)
+			void releaseFinished();
+
+			AudioEngine& m_engine;
+			const int m_sampleRate;
+			const PlaybackConfig m_config;
+			const size_t m_crossfadeSamples;
+
+			Base::SpscRingBuffer<Source> m_incoming; ///< enqueue() -> callback
+			std::deque<Entry> m_entries; ///< Queued and not released, producer only
+			Sequence m_lastSequence{ 0 }; ///< Producer only
+			std::atomic<Sequence> m_finished{ 0 }; ///< Last source finished by the callback (sources finish in order)
+
+			// Render callback state
+			Source m_current; ///< Playing (audio is null when idle)
+			Source m_next; ///< Popped ahead to check whether a crossfade is possible
+			bool m_currentStarted{ false }; ///< The current source has produced a sample
+			uint64_t m_position{ 0 }; ///< Samples written to the device
+			uint64_t m_lastEnd{ 0 }; ///< Position right after the last finished source
+			bool m_lastEndValid{ false }; ///< The last finished source was heard (not cancelled or empty)
+			std::vector<float> m_fadeTail; ///< Crossfade scratch, preallocated
+			std::vector<float> m_fadeHead;
+
+			// Written by the callback, read by getStats()
+			std::atomic<uint64_t> m_sources{ 0 };
+			std::atomic<uint64_t> m_gapsMeasured{ 0 };
+			std::atomic<uint64_t> m_gapSamples{ 0 };
+			std::atomic<uint64_t> m_lastGapSamples{ 0 };
+			std::atomic<uint64_t> m_maxGapSamples{ 0 };
+			std::atomic<uint64_t> m_crossfades{ 0 };
+			std::atomic<uint64_t> m_underruns{ 0 };
+		};
+
+	} // namespace Chat
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_CHAT_PLAYBACKSTREAM_H
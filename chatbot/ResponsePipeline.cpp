@@ -0,0 +1,270 @@
+/**
+ * @file ResponsePipeline.cpp
+ * @author zah
+ * @brief Implementation of the persistent response pipeline
+ * @see ResponsePipeline.h
+ * @version 0.1
+ * @date 2024-04-29
+ *
+ */
+
+#include "ResponsePipeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <vector>
+
+namespace XPlaneChatBot {
+namespace Chat {
+
+namespace {
+    constexpr size_t kSentenceQueueSize = 32;
+    constexpr size_t kDisplayQueueSize = 32;
+    constexpr int kWordsPerMinute = 170;
+}
+
+
+ResponsePipeline::ResponsePipeline(AudioEngine& engine, const TtsConfig& ttsConfig, const SegmenterConfig& segmenterConfig, const PlaybackConfig& playbackConfig)
+    : m_playbackRate(engine.outputRate() > 0 ? engine.outputRate() : openai::SAMPLE_RATE)
+    , m_segmenterConfig(segmenterConfig)
+    , m_tts(ttsConfig)
+    , m_player(engine, playbackConfig)
+    , m_sentenceQueue(kSentenceQueueSize)
+    , m_audioQueue(m_tts.getConfig().maxInFlight) // Sentences whose audio may be fetched ahead of playback
+    , m_displayQueue(kDisplayQueueSize)
+{
+    Base::spawn(m_executor, turnLoop(), [this](std::exception_ptr error) {
+        if (error) {
+            Base::Logger::log("Turn coroutine ended with an exception", Base::ERR, __FUNCTION__);
+        }
+        m_turnLoopDone.set_value();
+    });
+    m_speechThread = std::thread(&ResponsePipeline::speechStage, this);
+    m_playbackThread = std::thread(&ResponsePipeline::playbackStage, this);
+    m_displayThread = std::thread(&ResponsePipeline::displayStage, this);
+    Base::Logger::log("Response pipeline started", Base::DEBUG, __FUNCTION__);
+}
+
+ResponsePipeline::~ResponsePipeline() {
+    stop();
+}
+
+bool ResponsePipeline::submit(std::string payload, std::shared_ptr<Message> message) {
+    if (m_stopped) {
+        Base::Logger::log("Response pipeline is stopped", Base::ERR, __FUNCTION__);
+        return false;
+    }
+    auto cancelToken = std::make_shared<Base::CancellationToken>();
+    {
+        std::lock_guard<std::mutex> lock(m_cancelMutex);
+        // Tokens expire once every job of their turn is gone
+        m_turnTokens.erase(std::remove_if(m_turnTokens.begin(), m_turnTokens.end(),
+            [](const std::weak_ptr<Base::CancellationToken>& token) { return token.expired(); }), m_turnTokens.end());
+        m_turnTokens.push_back(cancelToken);
+    }
+    const uint64_t turn = ++m_turnsSubmitted;
+    if (!m_turns.push(TurnJob{ turn, std::move(payload), std::move(message), std::move(cancelToken) })) {
+        ++m_turnsCompleted; // Never started, do not leave the pipeline looking busy
+        return false;
+    }
+    return true;
+}
+
+void ResponsePipeline::cancel() {
+    std::vector<std::shared_ptr<Base::CancellationToken>> tokens;
+    {
+        std::lock_guard<std::mutex> lock(m_cancelMutex);
+        for (const std::weak_ptr<Base::CancellationToken>& weak : m_turnTokens) {
+            if (std::shared_ptr<Base::CancellationToken> token = weak.lock()) {
+                tokens.push_back(std::move(token));
+            }
+        }
+        m_turnTokens.clear();
+    }
+    for (const std::shared_ptr<Base::CancellationToken>& token : tokens) {
+        token->cancel();
+    }
+    Base::Logger::log("Cancelled " + std::to_string(tokens.size()) + " turn(s)", Base::DEBUG, __FUNCTION__);
+}
+
+void ResponsePipeline::stop() {
+    if (m_stopped.exchange(true)) {
+        return;
+    }
+    cancel(); // Do not wait for replies nobody will hear
+    // Closing the turn channel lets every stage drain and forward the close down the line
+    m_turns.close();
+    m_turnLoopDone.get_future().wait();
+    m_sentenceQueue.close();
+    for (std::thread* thread : { &m_speechThread, &m_playbackThread, &m_displayThread }) {
+        if (thread->joinable()) {
+            thread->join();
+        }
+    }
+    m_tts.stop();
+    Base::Logger::log("Response pipeline stopped", Base::DEBUG, __FUNCTION__);
+}
+
+PipelineStats ResponsePipeline::getStats() const {
+    PipelineStats stats;
+    stats.turnsSubmitted = m_turnsSubmitted.load();
+    stats.turnsCompleted = m_turnsCompleted.load();
+    stats.sentencesSpoken = m_sentencesSpoken.load();
+    stats.turnsCancelled = m_turnsCancelled.load();
+    stats.chatQueueDepth = m_turns.size();
+    stats.sentenceQueueDepth = m_sentenceQueue.size();
+    stats.audioQueueDepth = m_audioQueue.size();
+    stats.displayQueueDepth = m_displayQueue.size();
+    return stats;
+}
+
+
+Base::Task<void> ResponsePipeline::turnLoop() {
+    while (std::optional<TurnJob> job = co_await m_turns.next()) {
+        co_await streamTurn(std::move(*job));
+    }
+}
+
+Base::Task<void> ResponsePipeline::streamTurn(TurnJob job) {
+    const std::shared_ptr<Message>& message = job.message;
+    SentenceSegmenter segmenter{ m_segmenterConfig };
+    std::vector<std::string> chunks;
+
+    const std::shared_ptr<Base::CancellationToken>& cancelToken = job.cancelToken;
+    auto stream = m_openAI.chatStream(job.payload, m_executor, nullptr, cancelToken);
+    while (std::optional<std::string> delta = co_await stream->next()) {
+        if (cancelToken->isCancelled()) {
+            continue; // Drain what was queued before the request was aborted
+        }
+        chunks.clear();
+        segmenter.feed(*delta, chunks);
+        for (std::string& chunk : chunks) {
+            // Blocks the executor thread when TTS falls behind, which is the back-pressure we want
+            m_sentenceQueue.push(SentenceJob{ job.turn, std::move(chunk), message, nullptr, cancelToken });
+        }
+    }
+    message->stopUpdating(); // Ends the message even if no finish_reason arrived
+    Base::Logger::log("Chat request of turn " + std::to_string(job.turn) + " completed", Base::DEBUG, __FUNCTION__);
+
+    std::string tail;
+    if (segmenter.flush(tail) && !cancelToken->isCancelled()) {
+        m_sentenceQueue.push(SentenceJob{ job.turn, std::move(tail), message, nullptr, cancelToken });
+    }
+    SentenceJob marker;
+    marker.turn = job.turn;
+    marker.message = message;
+    marker.cancelToken = cancelToken;
+    marker.endOfTurn = true;
+    m_sentenceQueue.push(std::move(marker));
+}
+
+void ResponsePipeline::speechStage() {
+    while (std::optional<SentenceJob> job = m_sentenceQueue.pop()) {
+        if (job->endOfTurn) {
+            m_audioQueue.push(std::move(*job));
+            continue;
+        }
+        if (job->cancelToken->isCancelled()) {
+            continue;
+        }
+        // The player receives the sentences in order; the downloads behind them may overlap
+        auto audio = std::make_shared<openai::SharedAudioData>(m_playbackRate, Base::ResamplerQuality::Balanced, m_tts.getConfig().decodeWindow);
+        job->audio = audio;
+        // Also stops a sentence whose download has already finished while it is played
+        job->cancelToken->onCancel([weak = std::weak_ptr<openai::SharedAudioData>(audio)] {
+            if (std::shared_ptr<openai::SharedAudioData> playing = weak.lock()) {
+                playing->cancel();
+            }
+        });
+        std::string text = job->text;
+        std::shared_ptr<Base::CancellationToken> cancelToken = job->cancelToken;
+        m_audioQueue.push(std::move(*job));
+        m_tts.submit(std::move(text), std::move(audio), std::move(cancelToken));
+    }
+    m_audioQueue.close();
+}
+
+void ResponsePipeline::playbackStage() {
+    // The next sentence is queued while the current one plays, so the stream moves on to it without a gap
+    std::shared_ptr<openai::SharedAudioData> current; ///< Queued on the stream, not finished
+    PlaybackStream::Sequence currentSequence = 0;
+    std::shared_ptr<openai::SharedAudioData> previous; ///< Last sentence finished in the current turn
+    std::chrono::steady_clock::time_point previousEnded;
+    const auto finishCurrent = [&] {
+        if (!current) {
+            return;
+        }
+        m_player.waitFinished(currentSequence);
+        const auto ended = std::chrono::steady_clock::now();
+        if (current->isCancelled()) {
+            previous.reset();
+        }
+        else {
+            if (previous) {
+                m_tts.recordPlaybackGap(*previous, *current, previousEnded);
+            }
+            previous = std::move(current);
+            previousEnded = ended;
+        }
+        current.reset();
+        currentSequence = 0;
+    };
+
+    while (std::optional<SentenceJob> job = m_audioQueue.pop()) {
+        if (job->endOfTurn) {
+            finishCurrent();
+            previous.reset(); // The wait for the next turn's first sentence is not a gap
+            m_displayQueue.push(std::move(*job));
+            continue;
+        }
+        if (job->cancelToken->isCancelled()) {
+            continue;
+        }
+        std::shared_ptr<openai::SharedAudioData> audio = job->audio;
+        const PlaybackStream::Sequence sequence = m_player.enqueue(audio, current != nullptr || previous != nullptr);
+        finishCurrent(); // Returns when this sentence starts playing
+        m_displayQueue.push(std::move(*job)); // Text is shown while the sentence is spoken
+        ++m_sentencesSpoken;
+        current = std::move(audio);
+        currentSequence = sequence;
+    }
+    finishCurrent();
+    m_displayQueue.close();
+}
+
+void ResponsePipeline::displayStage() {
+    const std::chrono::milliseconds wordDuration((60 * 1000) / kWordsPerMinute);
+    while (std::optional<SentenceJob> job = m_displayQueue.pop()) {
+        if (job->endOfTurn) {
+            if (job->cancelToken->isCancelled()) {
+                ++m_turnsCancelled;
+            }
+            ++m_turnsCompleted;
+            Base::Logger::log("Turn " + std::to_string(job->turn) + (job->cancelToken->isCancelled() ? " cancelled" : " completed"), Base::DEBUG, __FUNCTION__);
+            const openai::DecodeStats decode = getDecodeStats();
+            Base::Logger::log(
+                "Decode stats: " + std::to_string(static_cast<int>(decode.decodeMs)) + " ms decoding for " + std::to_string(static_cast<int>(decode.audioDecodedMs))
+                + " ms of audio, longest pass " + std::to_string(decode.maxPassMs) + " ms, peak decode-ahead " + std::to_string(static_cast<int>(decode.peakDecodeAheadMs)) + " ms",
+                Base::DEBUG, __FUNCTION__
+            );
+            const openai::AudioMemoryTotals memory = getAudioMemoryTotals();
+            Base::Logger::log(
+                "Audio memory: " + std::to_string(memory.allocatedBytes / 1024) + " KiB in " + std::to_string(memory.liveStreams)
+                + " sentences, peak " + std::to_string(memory.peakAllocatedBytes / 1024) + " KiB",
+                Base::DEBUG, __FUNCTION__
+            );
+            continue;
+        }
+        // Display text word by word
+        std::istringstream iss(job->text);
+        std::string word;
+        while (!job->cancelToken->isCancelled() && iss >> word) {
+            job->message->addWordToText(word + " ");
+            std::this_thread::sleep_for(wordDuration);
+        }
+    }
+}
+
+} // namespace Chat
+} // namespace XPlaneChatBot
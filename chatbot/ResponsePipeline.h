@@ -0,0 +1,171 @@
+/**
+ * @file ResponsePipeline.h
+ * @author zah
+ * @brief Long-lived staged pipeline that turns an LLM request into spoken and displayed text
+ *
+ * The stages are created once per ChatBot and are connected by bounded queues:
+ * + turn: one coroutine per turn co_awaits the streamed completion (OpenAI::chatStream), appends each delta to the
+ *   AI message and cuts the text into TTS chunks (see SentenceSegmenter.h). Turns run one after the other on a
+ *   single executor thread, which sits idle while the network is waited on.
+ * + speech: hands each sentence to the TtsScheduler, which keeps several downloads in flight (decoded as they arrive)
+ * + playback: queues the sentences, in order, on one output stream that plays them back to back (see PlaybackStream.h)
+ * + display: types each sentence into the message while it is being spoken
+ *
+ * The speech, playback and display stages stay on their own threads: playback waits for each sentence to finish
+ * and the display is paced with sleeps.
+ *
+ * Every job carries its turn number and an end-of-turn marker travels behind the last sentence, so turns
+ * submitted back to back are processed in order without ever spawning or joining a thread.
+ *
+ * Each turn also carries a cancellation token. cancel() aborts the chat stream and the TTS downloads in flight,
+ * silences the sentence being played within one audio buffer and makes every stage drop the rest of the turn;
+ * only the end-of-turn marker still travels down the line, so the next turn starts from empty queues.
+ *
+ * @version 0.1
+ * @date 2024-04-29
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_CHAT_RESPONSEPIPELINE_H
+#define XPROTECTION_CHAT_RESPONSEPIPELINE_H
+
+#include "base/boundedqueue.h"
+#include "base/cancellation.h"
+#include "base/coroutine.h"
+#include "chatbot/ChatStructures.hpp"
+#include "chatbot/openai.hpp"
+#include "chatbot/PlaybackStream.h"
+#include "chatbot/SentenceSegmenter.h"
+#include "chatbot/TtsScheduler.h"
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace XPlaneChatBot {
+	namespace Chat {
+
+		/// @brief Turn counters and queue depths of the response pipeline
+		struct PipelineStats {
+			uint64_t turnsSubmitted{ 0 }; ///< Requests accepted by submit()
+			uint64_t turnsCompleted{ 0 }; ///< Turns whose last sentence has been displayed (or that were cancelled)
+			uint64_t turnsCancelled{ 0 }; ///< Turns aborted by cancel()
+			uint64_t sentencesSpoken{ 0 }; ///< Sentences handed to the player
+			size_t chatQueueDepth{ 0 }; ///< Requests waiting for the turn coroutine
+			size_t sentenceQueueDepth{ 0 }; ///< Sentences waiting for TTS
+			size_t audioQueueDepth{ 0 }; ///< Sentences with audio waiting to be played
+			size_t displayQueueDepth{ 0 }; ///< Sentences waiting to be displayed
+		};
+
+		/// @brief Persistent chat -> segment -> speech -> playback -> display pipeline
+		class ResponsePipeline {
+		public:
+			/**
+			 * @brief Start the stage threads
+			 * @param engine Owner of the output stream (TTS audio is resampled to its rate)
+			 * @param ttsConfig Number of sentences synthesized concurrently
+			 * @param segmenterConfig Sizing of the chunks sent to TTS
+			 * @param playbackConfig Crossfade between sentences
+			 */
+			explicit ResponsePipeline(AudioEngine& engine, const TtsConfig& ttsConfig = TtsConfig{}, const SegmenterConfig& segmenterConfig = SegmenterConfig{},
+				const PlaybackConfig& playbackConfig = PlaybackConfig{});
+
+			/// @brief Stops the pipeline (cancels the turns in flight)
+			~ResponsePipeline();
+
+			ResponsePipeline(const ResponsePipeline&) = delete;
+			ResponsePipeline& operator=(const ResponsePipeline&) = delete;
+
+			/**
+			 * @brief Queue a chat completion request whose answer is streamed into message, spoken and displayed
+			 * @param payload JSON body of the chat/completions request
+			 * @param message AI message that receives the streamed text
+			 * @return False if the pipeline is stopped
+			 */
+			bool submit(std::string payload, std::shared_ptr<Message> message);
+
+			/// @brief True once every submitted turn has been spoken and displayed
+			bool isIdle() const { return m_turnsCompleted.load() == m_turnsSubmitted.load(); }
+
+			/// @brief Abort every turn submitted so far (network, TTS, playback and display); later turns are not affected
+			void cancel();
+
+			/// @brief Cancel the turns in flight, close the queues and join the stage threads
+			void stop();
+
+			PipelineStats getStats() const;
+
+			/// @brief Per-sentence time to first audio and the playback gaps between sentences
+			TtsStats getTtsStats() const { return m_tts.getStats(); }
+
+			/// @brief Sample-accurate gaps between the sentences of a turn, as heard at the output
+			PlaybackStats getPlaybackStats() const { return m_player.getStats(); }
+
+			/// @brief Decode time and decoded-ahead audio of the TTS streams (one decode worker serves every stream)
+			openai::DecodeStats getDecodeStats() const { return openai::DecodeWorker::instance().getStats(); }
+
+			/// @brief Buffers held by the sentences' audio (compressed queue and decoded window), over the whole process
+			openai::AudioMemoryTotals getAudioMemoryTotals() const { return openai::SharedAudioData::getMemoryTotals(); }
+
+		private:
+			/// @brief A turn waiting for the turn coroutine
+			struct TurnJob {
+				uint64_t turn{ 0 };
+				std::string payload;
+				std::shared_ptr<Message> message;
+				std::shared_ptr<Base::CancellationToken> cancelToken;
+			};
+
+			/// @brief A sentence (or the end-of-turn marker) travelling through the later stages
+			struct SentenceJob {
+				uint64_t turn{ 0 };
+				std::string text;
+				std::shared_ptr<Message> message;
+				std::shared_ptr<openai::SharedAudioData> audio; ///< Set by the speech stage
+				std::shared_ptr<Base::CancellationToken> cancelToken; ///< Shared by every job of the turn
+				bool endOfTurn{ false }; ///< Marker behind the last sentence of a turn
+			};
+
+			Base::Task<void> turnLoop();
+			Base::Task<void> streamTurn(TurnJob job);
+			void speechStage();
+			void playbackStage();
+			void displayStage();
+
+			const int m_playbackRate;
+			const SegmenterConfig m_segmenterConfig;
+			TtsScheduler m_tts; ///< Downloads the sentences handed over by the speech stage
+			PlaybackStream m_player; ///< Output stream of the whole session, fed by the playback stage
+			openai::OpenAI m_openAI{}; ///< API key is set as environment variable OPENAI_API_KEY
+
+			Base::BoundedQueue<SentenceJob> m_sentenceQueue; ///< turn -> speech
+			Base::BoundedQueue<SentenceJob> m_audioQueue; ///< speech -> playback, in sentence order (bounds the audio fetched ahead)
+			Base::BoundedQueue<SentenceJob> m_displayQueue; ///< playback -> display
+
+			std::atomic<uint64_t> m_turnsSubmitted{ 0 };
+			std::atomic<uint64_t> m_turnsCompleted{ 0 };
+			std::atomic<uint64_t> m_sentencesSpoken{ 0 };
+			std::atomic<uint64_t> m_turnsCancelled{ 0 };
+			std::atomic<bool> m_stopped{ false };
+
+			std::mutex m_cancelMutex; ///< Guards m_turnTokens
+			std::vector<std::weak_ptr<Base::CancellationToken>> m_turnTokens; ///< Tokens of the turns that may still be running
+
+			Base::ThreadPoolExecutor m_executor{ 1 }; ///< Runs the turn coroutines
+			Base::AsyncChannel<TurnJob> m_turns{ m_executor }; ///< submit() -> turn
+			std::promise<void> m_turnLoopDone; ///< Set when turnLoop() returns
+			std::thread m_speechThread;
+			std::thread m_playbackThread;
+			std::thread m_displayThread;
+		};
+
+	} // namespace Chat
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_CHAT_RESPONSEPIPELINE_H
@@ -0,0 +1,220 @@
+/**
+ * @file SentenceSegmenter.cpp
+ * @author zah
+ * @brief Implementation of the streaming sentence segmenter
+ * @see SentenceSegmenter.h
+ * @version 0.1
+ * @date 2024-05-20
+ *
+ */
+
+#include "SentenceSegmenter.h"
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+
+namespace XPlaneChatBot {
+namespace Chat {
+
+namespace {
+    /// Abbreviations that are followed by more of the same sentence (lower case, without the period); words that
+    /// also end sentences on their own ("no", "est", "alt", ...) are left out
+    constexpr std::array<std::string_view, 21> kAbbreviations = {
+        "mr", "mrs", "ms", "dr", "prof", "capt", "cpt", "lt", "sgt", "vs", "approx", "appx",
+        "fig", "ref", "freq", "hdg", "rwy", "twy", "dept", "nr", "cf"
+    };
+
+    /// Abbreviations only when a number follows ("No. 2 engine"); otherwise plain words ("No. Keep the nose up.")
+    constexpr std::array<std::string_view, 2> kNumberAbbreviations = { "no", "nos" };
+
+    bool isSpace(char c) { return std::isspace(static_cast<unsigned char>(c)) != 0; }
+    bool isTerminator(char c) { return c == '.' || c == '?' || c == '!'; }
+    bool isClosing(char c) { return c == '"' || c == '\'' || c == ')' || c == ']'; }
+    bool isOpening(char c) { return c == '"' || c == '\'' || c == '(' || c == '['; }
+
+    std::string trim(std::string_view text) {
+        const size_t first = text.find_first_not_of(" \t\r\n");
+        if (first == std::string_view::npos) {
+            return {};
+        }
+        const size_t last = text.find_last_not_of(" \t\r\n");
+        return std::string(text.substr(first, last + 1 - first));
+    }
+}
+
+
+SentenceSegmenter::SentenceSegmenter(const SegmenterConfig& config)
+    : m_config(config)
+{}
+
+void SentenceSegmenter::reset() {
+    m_pending.clear();
+    m_scan = 0;
+    m_words = 0;
+    m_inWord = false;
+    m_lastSentence = 0;
+    m_lastClause = 0;
+    m_lastSpace = 0;
+    m_chunks = 0;
+}
+
+size_t SentenceSegmenter::minWords() const {
+    if (m_chunks == 0) {
+        return 1; // Any complete sentence starts the audio
+    }
+    size_t words = m_config.chunkMinWords;
+    for (size_t i = 1; i < m_chunks && words < m_config.chunkMaxWords; ++i) {
+        words *= std::max<size_t>(m_config.chunkGrowth, 1);
+    }
+    return std::min(words, m_config.chunkMaxWords);
+}
+
+SentenceSegmenter::Boundary SentenceSegmenter::sentenceEnd(size_t index, size_t& end) const {
+    // A run of terminators and closing quotes/brackets belongs to the same sentence end
+    size_t next = index + 1;
+    while (next < m_pending.size() && (isTerminator(m_pending[next]) || isClosing(m_pending[next]))) {
+        ++next;
+    }
+    if (next >= m_pending.size()) {
+        return Boundary::NeedMore;
+    }
+    if (!isSpace(m_pending[next])) {
+        return Boundary::No; // 3.5, e.g, U.S, urls
+    }
+    end = next;
+    if (m_pending[index] != '.') {
+        return Boundary::Yes;
+    }
+
+    // Word before the period
+    size_t start = index;
+    while (start > 0 && !isSpace(m_pending[start - 1]) && !isOpening(m_pending[start - 1])) {
+        --start;
+    }
+    std::string token(m_pending, start, index - start);
+    std::transform(token.begin(), token.end(), token.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (token.find('.') != std::string::npos
+        && std::all_of(token.begin(), token.end(), [](unsigned char c) { return std::isalpha(c) || c == '.'; })) {
+        return Boundary::No; // Dotted abbreviation: e.g. i.e. a.m. U.S.
+    }
+    if (!token.empty() && std::all_of(token.begin(), token.end(), [](unsigned char c) { return std::isdigit(c); })
+        && (start == 0 || m_pending[start - 1] == '\n')) {
+        return Boundary::No; // Numbered list marker
+    }
+    if (std::find(kAbbreviations.begin(), kAbbreviations.end(), token) != kAbbreviations.end()) {
+        return Boundary::No;
+    }
+
+    // A sentence does not continue in lower case ("3000 ft. above the field")
+    size_t following = next;
+    while (following < m_pending.size() && isSpace(m_pending[following])) {
+        ++following;
+    }
+    if (following >= m_pending.size()) {
+        return Boundary::NeedMore;
+    }
+    const unsigned char first = static_cast<unsigned char>(m_pending[following]);
+    if (std::isdigit(first) && std::find(kNumberAbbreviations.begin(), kNumberAbbreviations.end(), token) != kNumberAbbreviations.end()) {
+        return Boundary::No;
+    }
+    return std::islower(first) ? Boundary::No : Boundary::Yes;
+}
+
+SentenceSegmenter::Boundary SentenceSegmenter::clauseEnd(size_t index, size_t length, size_t& end) const {
+    const size_t next = index + length;
+    if (next >= m_pending.size()) {
+        return Boundary::NeedMore;
+    }
+    if (!isSpace(m_pending[next])) {
+        return Boundary::No; // 1,500 ft or 10:30
+    }
+    end = next;
+    return Boundary::Yes;
+}
+
+void SentenceSegmenter::feed(std::string_view text, std::vector<std::string>& chunks) {
+    m_pending.append(text);
+    while (m_scan < m_pending.size()) {
+        const char c = m_pending[m_scan];
+        size_t length = 1;
+        size_t end = 0;
+        Boundary sentence = Boundary::No;
+        Boundary clause = Boundary::No;
+        if (isTerminator(c)) {
+            sentence = sentenceEnd(m_scan, end);
+        }
+        else if (c == ',' || c == ';' || c == ':' || (c == '-' && m_scan > 0 && isSpace(m_pending[m_scan - 1]))) {
+            clause = clauseEnd(m_scan, length, end);
+        }
+        else if (c == '\xE2') { // Em dash (UTF-8 E2 80 94)
+            if (m_scan + 2 >= m_pending.size()) {
+                return;
+            }
+            if (m_pending[m_scan + 1] == '\x80' && m_pending[m_scan + 2] == '\x94') {
+                length = 3;
+                clause = clauseEnd(m_scan, length, end);
+            }
+        }
+        if (sentence == Boundary::NeedMore || clause == Boundary::NeedMore) {
+            return; // Wait for the next characters
+        }
+
+        if (isSpace(c)) {
+            m_inWord = false;
+            m_lastSpace = m_scan;
+        }
+        else if (!m_inWord) {
+            m_inWord = true;
+            ++m_words;
+            const size_t maxWords = m_chunks == 0 ? m_config.firstChunkMaxWords : m_config.chunkMaxWords;
+            if (m_words > maxWords) {
+                // Too long without a usable boundary: cut before this word at the best earlier one
+                const size_t cut = m_lastSentence ? m_lastSentence : (m_lastClause ? m_lastClause : m_lastSpace);
+                if (cut > 0) {
+                    emit(cut, chunks);
+                    continue;
+                }
+            }
+        }
+        m_scan += length;
+
+        if (sentence == Boundary::Yes) {
+            m_lastSentence = end;
+            if (m_words >= minWords()) {
+                emit(end, chunks);
+            }
+        }
+        else if (clause == Boundary::Yes) {
+            m_lastClause = end;
+            if (m_chunks == 0 && m_words >= m_config.firstChunkMinWords) {
+                emit(end, chunks); // Early first chunk
+            }
+        }
+    }
+}
+
+bool SentenceSegmenter::flush(std::string& chunk) {
+    chunk = trim(m_pending);
+    reset();
+    return !chunk.empty();
+}
+
+void SentenceSegmenter::emit(size_t end, std::vector<std::string>& chunks) {
+    std::string chunk = trim(std::string_view(m_pending).substr(0, end));
+    if (!chunk.empty()) {
+        chunks.push_back(std::move(chunk));
+        ++m_chunks;
+    }
+    // Rescan what is left; it is at most a few words
+    m_pending.erase(0, end);
+    m_scan = 0;
+    m_words = 0;
+    m_inWord = false;
+    m_lastSentence = 0;
+    m_lastClause = 0;
+    m_lastSpace = 0;
+}
+
+} // namespace Chat
+} // namespace XPlaneChatBot
@@ -0,0 +1,92 @@
+/**
+ * @file SentenceSegmenter.h
+ * @author zah
+ * @brief Streaming segmenter that cuts LLM text into TTS chunks, tuned for time to first audio
+ *
+ * + The first chunk is emitted at the first sentence end, or earlier at a clause boundary (, ; : or a dash)
+ *   once a few words are in, so the first audible word does not wait for a long first sentence.
+ * + Later chunks merge sentences until a growing minimum word count is reached: fewer requests and better prosody,
+ *   while the audio of the previous chunk is still playing.
+ * + A period only ends a sentence when followed by whitespace and not part of a decimal ("3.5 knots"), a dotted
+ *   abbreviation ("e.g.", "a.m."), a known title/aviation abbreviation ("approx.", "hdg.", "rwy.") or a numbered
+ *   list marker, and when the next word does not start in lower case.
+ *
+ * @version 0.1
+ * @date 2024-05-20
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_CHAT_SENTENCESEGMENTER_H
+#define XPROTECTION_CHAT_SENTENCESEGMENTER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace XPlaneChatBot {
+	namespace Chat {
+
+		/// @brief Chunk sizing of the sentence segmenter
+		struct SegmenterConfig {
+			size_t firstChunkMinWords{ 4 }; ///< Words needed before the first chunk may be cut at a clause boundary
+			size_t firstChunkMaxWords{ 16 }; ///< First chunk is cut at a word boundary past this many words
+			size_t chunkMinWords{ 10 }; ///< Second chunk merges sentences until it has this many words
+			size_t chunkGrowth{ 2 }; ///< Minimum grows by this factor for every further chunk
+			size_t chunkMaxWords{ 60 }; ///< Later chunks are cut at the best earlier boundary past this many words
+		};
+
+		/// @brief Incremental sentence/clause segmenter for one streamed response
+		class SentenceSegmenter {
+		public:
+			explicit SentenceSegmenter(const SegmenterConfig& config = SegmenterConfig{});
+
+			/**
+			 * @brief Append streamed text and collect the chunks that are complete
+			 * @param text Newly streamed text
+			 * @param chunks Receives complete chunks (appended)
+			 */
+			void feed(std::string_view text, std::vector<std::string>& chunks);
+
+			/**
+			 * @brief End of the stream: emit whatever is left
+			 * @param chunk Receives the remaining text (trimmed)
+			 * @return False if nothing but whitespace was left
+			 */
+			bool flush(std::string& chunk);
+
+			/// @brief Forget the pending text and start a new response
+			void reset();
+
+			size_t chunksEmitted() const { return m_chunks; }
+
+		private:
+			/// @brief Outcome of looking at a possible sentence end
+			enum class Boundary { No, Yes, NeedMore };
+
+			/// @brief Decide whether the terminator at index ends a sentence; end receives the cut position
+			Boundary sentenceEnd(size_t index, size_t& end) const;
+			/// @brief Decide whether the clause punctuation at index (length bytes) is a clause boundary
+			Boundary clauseEnd(size_t index, size_t length, size_t& end) const;
+
+			/// @brief Minimum word count before the current chunk may end at a sentence boundary
+			size_t minWords() const;
+
+			void emit(size_t end, std::vector<std::string>& chunks);
+
+			const SegmenterConfig m_config;
+			std::string m_pending; ///< Text not emitted yet
+			size_t m_scan{ 0 }; ///< Next index of m_pending to examine
+			size_t m_words{ 0 }; ///< Words in m_pending before m_scan
+			bool m_inWord{ false }; ///< m_pending[m_scan - 1] is part of a word
+			size_t m_lastSentence{ 0 }; ///< Cut position after the last sentence end (0 if none)
+			size_t m_lastClause{ 0 }; ///< Cut position after the last clause boundary (0 if none)
+			size_t m_lastSpace{ 0 }; ///< Cut position at the last word boundary (0 if none)
+			size_t m_chunks{ 0 }; ///< Chunks emitted so far
+		};
+
+	} // namespace Chat
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_CHAT_SENTENCESEGMENTER_H
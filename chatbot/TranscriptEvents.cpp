@@ -0,0 +1,284 @@
+/**
+ * @file TranscriptEvents.cpp
+ * @author zah
+ * @brief Implementation of the targeted STT message parser
+ * @see TranscriptEvents.h
+ * @version 0.1
+ * @date 2024-04-15
+ *
+ */
+
+#include "TranscriptEvents.h"
+
+namespace XPlaneChatBot {
+namespace Chat {
+
+namespace {
+    void skipWhitespace(const char*& p, const char* end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+            ++p;
+        }
+    }
+
+    int hexValue(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    bool parseHex4(const char*& p, const char* end, uint32_t& value) {
+        if (end - p < 4) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < 4; ++i) {
+            const int digit = hexValue(*p++);
+            if (digit < 0) {
+                return false;
+            }
+            value = (value << 4) | static_cast<uint32_t>(digit);
+        }
+        return true;
+    }
+
+    void appendUtf8(std::string& out, uint32_t codepoint) {
+        if (codepoint < 0x80) {
+            out += static_cast<char>(codepoint);
+        }
+        else if (codepoint < 0x800) {
+            out += static_cast<char>(0xC0 | (codepoint >> 6));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+        else if (codepoint < 0x10000) {
+            out += static_cast<char>(0xE0 | (codepoint >> 12));
+            out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+        else {
+            out += static_cast<char>(0xF0 | (codepoint >> 18));
+            out += static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codepoint & 0x3F));
+        }
+    }
+
+    /// @brief Parse a JSON string starting at the opening quote; out may be null to only skip it
+    bool parseString(const char*& p, const char* end, std::string* out) {
+        if (p >= end || *p != '"') {
+            return false;
+        }
+        ++p;
+        if (out) {
+            out->clear();
+        }
+        while (p < end) {
+            // Copy the run up to the next quote or escape in one go
+            const char* run = p;
+            while (p < end && *p != '"' && *p != '\\') {
+                ++p;
+            }
+            if (out) {
+                out->append(run, p);
+            }
+            if (p >= end) {
+                return false;
+            }
+            if (*p == '"') {
+                ++p;
+                return true;
+            }
+
+            // Escape sequence
+            if (++p >= end) {
+                return false;
+            }
+            const char escaped = *p++;
+            char decoded = 0;
+            switch (escaped) {
+            case '"': decoded = '"'; break;
+            case '\\': decoded = '\\'; break;
+            case '/': decoded = '/'; break;
+            case 'b': decoded = '\b'; break;
+            case 'f': decoded = '\f'; break;
+            case 'n': decoded = '\n'; break;
+            case 'r': decoded = '\r'; break;
+            case 't': decoded = '\t'; break;
+            case 'u': {
+                uint32_t codepoint = 0;
+                if (!parseHex4(p, end, codepoint)) {
+                    return false;
+                }
+                if (codepoint >= 0xD800 && codepoint <= 0xDBFF) {
+                    // Surrogate pair
+                    uint32_t low = 0;
+                    if (end - p < 6 || p[0] != '\\' || p[1] != 'u') {
+                        return false;
+                    }
+                    p += 2;
+                    if (!parseHex4(p, end, low) || low < 0xDC00 || low > 0xDFFF) {
+                        return false;
+                    }
+                    codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+                }
+                if (out) {
+                    appendUtf8(*out, codepoint);
+                }
+                continue;
+            }
+            default:
+                return false;
+            }
+            if (out) {
+                *out += decoded;
+            }
+        }
+        return false;
+    }
+
+    /// @brief Skip any JSON value (nested objects and arrays included)
+    bool skipValue(const char*& p, const char* end) {
+        if (p >= end) {
+            return false;
+        }
+        if (*p == '"') {
+            return parseString(p, end, nullptr);
+        }
+        if (*p == '{' || *p == '[') {
+            int depth = 0;
+            while (p < end) {
+                const char c = *p;
+                if (c == '"') {
+                    if (!parseString(p, end, nullptr)) {
+                        return false;
+                    }
+                    continue;
+                }
+                if (c == '{' || c == '[') {
+                    ++depth;
+                }
+                else if (c == '}' || c == ']') {
+                    if (--depth == 0) {
+                        ++p;
+                        return true;
+                    }
+                }
+                ++p;
+            }
+            return false;
+        }
+        // Number, true, false or null
+        const char* start = p;
+        while (p < end && *p != ',' && *p != '}' && *p != ']' && *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r') {
+            ++p;
+        }
+        return p > start;
+    }
+}
+
+
+bool parseTranscriptMessage(std::string_view message, TranscriptEvent& event) {
+    const char* p = message.data();
+    const char* end = p + message.size();
+
+    skipWhitespace(p, end);
+    if (p >= end || *p != '{') {
+        return false;
+    }
+    ++p;
+
+    std::string key;
+    std::string messageType;
+    std::string sessionId;
+    std::string error;
+    bool hasText = false;
+    bool hasError = false;
+    event.text.clear();
+
+    skipWhitespace(p, end);
+    if (p < end && *p == '}') {
+        return false; // Empty object, nothing to dispatch on
+    }
+    while (true) {
+        skipWhitespace(p, end);
+        if (!parseString(p, end, &key)) {
+            return false;
+        }
+        skipWhitespace(p, end);
+        if (p >= end || *p != ':') {
+            return false;
+        }
+        ++p;
+        skipWhitespace(p, end);
+
+        bool ok = true;
+        const bool isString = p < end && *p == '"';
+        if (key == "message_type" && isString) {
+            ok = parseString(p, end, &messageType);
+        }
+        else if (key == "text" && isString) {
+            ok = parseString(p, end, &event.text);
+            hasText = true;
+        }
+        else if (key == "session_id" && isString) {
+            ok = parseString(p, end, &sessionId);
+        }
+        else if (key == "error") {
+            hasError = true;
+            ok = isString ? parseString(p, end, &error) : skipValue(p, end);
+        }
+        else {
+            ok = skipValue(p, end);
+        }
+        if (!ok) {
+            return false;
+        }
+
+        skipWhitespace(p, end);
+        if (p >= end) {
+            return false;
+        }
+        if (*p == ',') {
+            ++p;
+            continue;
+        }
+        if (*p == '}') {
+            break;
+        }
+        return false;
+    }
+
+    if (hasError) {
+        event.type = TranscriptEventType::Error;
+        event.text = error.empty() ? std::string("unknown error") : error;
+    }
+    else if (messageType == "PartialTranscript") {
+        event.type = TranscriptEventType::Partial;
+    }
+    else if (messageType == "FinalTranscript") {
+        event.type = TranscriptEventType::Final;
+    }
+    else if (messageType == "SessionBegins") {
+        event.type = TranscriptEventType::SessionBegins;
+        event.text = sessionId;
+    }
+    else if (messageType == "SessionTerminated") {
+        event.type = TranscriptEventType::SessionTerminated;
+    }
+    else if (!messageType.empty()) {
+        event.type = TranscriptEventType::Unknown;
+        event.text = messageType;
+    }
+    else {
+        return false;
+    }
+
+    // Transcripts without text are malformed for this API
+    if ((event.type == TranscriptEventType::Partial || event.type == TranscriptEventType::Final) && !hasText) {
+        return false;
+    }
+    return true;
+}
+
+} // namespace Chat
+} // namespace XPlaneChatBot
@@ -0,0 +1,80 @@
+/**
+ * @file TranscriptEvents.h
+ * @author zah
+ * @brief Typed records for messages received from the streaming STT websocket, and a targeted parser for them
+ *
+ * The websocket thread only turns each message into a small TranscriptEvent and queues it; the transcript is
+ * applied to the Message later, in batches, on the thread that also draws it. The parser scans the top level of
+ * the message for the few keys that matter (message_type, text, session_id, error) and skips everything else
+ * (e.g. the per-word array of final transcripts) without building a JSON DOM.
+ *
+ * @version 0.1
+ * @date 2024-04-15
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_CHAT_TRANSCRIPTEVENTS_H
+#define XPROTECTION_CHAT_TRANSCRIPTEVENTS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace XPlaneChatBot {
+	namespace Chat {
+
+		/// @brief Kind of message received from the STT server
+		enum class TranscriptEventType {
+			Partial, ///< PartialTranscript: unfinalized words, replaces the previous partial
+			Final, ///< FinalTranscript: finalized words, appended to the transcript
+			SessionBegins, ///< SessionBegins: text holds the session id
+			SessionTerminated, ///< SessionTerminated
+			Error, ///< Message with an "error" key: text holds the error
+			Unknown, ///< Any other message_type: text holds the message_type
+		};
+
+		static const std::string transcriptEventTypeToString(const TranscriptEventType& type) {
+			switch (type) {
+			case TranscriptEventType::Partial: return "PartialTranscript";
+			case TranscriptEventType::Final: return "FinalTranscript";
+			case TranscriptEventType::SessionBegins: return "SessionBegins";
+			case TranscriptEventType::SessionTerminated: return "SessionTerminated";
+			case TranscriptEventType::Error: return "Error";
+			default: return "Unknown";
+			}
+		}
+
+		/// @brief One message from the STT server, reduced to what the chatbot uses
+		struct TranscriptEvent {
+			TranscriptEventType type{ TranscriptEventType::Unknown };
+			std::string text; ///< Transcript text (or session id / error / message type, see TranscriptEventType)
+			std::chrono::steady_clock::time_point received{}; ///< When the websocket thread received it
+			uint64_t generation{ 0 }; ///< Transcriber turn whose audio it transcribes (stamped by the websocket thread)
+		};
+
+		/// @brief Counters for the transcript event queue (see IXTranscriber::get_event_stats)
+		struct TranscriptEventStats {
+			uint64_t eventsQueued{ 0 }; ///< Events pushed by the websocket thread
+			uint64_t eventsDropped{ 0 }; ///< Events lost because the queue was full
+			uint64_t eventsApplied{ 0 }; ///< Events applied by the consumer
+			uint64_t partialsCoalesced{ 0 }; ///< Partials skipped because a newer partial was in the same batch
+			uint64_t staleEventsDropped{ 0 }; ///< Transcripts of an earlier turn that arrived once the next turn had started
+			uint64_t parseFallbacks{ 0 }; ///< Messages the targeted parser gave up on (parsed with nlohmann::json instead)
+			uint64_t batches{ 0 }; ///< Non-empty batches applied
+			size_t peakBatchSize{ 0 }; ///< Largest batch applied at once
+		};
+
+		/**
+		 * @brief Extract message_type, text, session_id and error from a realtime STT message
+		 * @param message Raw JSON text of the websocket message
+		 * @param event Filled in on success (received is not touched)
+		 * @return False if the message is not a JSON object this scanner understands
+		 */
+		bool parseTranscriptMessage(std::string_view message, TranscriptEvent& event);
+
+	} // namespace Chat
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_CHAT_TRANSCRIPTEVENTS_H
@@ -0,0 +1,146 @@
+/**
+ * @file TtsScheduler.cpp
+ * @author zah
+ * @brief Implementation of the TTS scheduler
+ * @see TtsScheduler.h
+ * @version 0.1
+ * @date 2024-05-13
+ *
+ */
+
+#include "TtsScheduler.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace XPlaneChatBot {
+namespace Chat {
+
+namespace {
+    double toMs(std::chrono::steady_clock::duration duration) {
+        return std::chrono::duration<double, std::milli>(duration).count();
+    }
+}
+
+
+TtsScheduler::TtsScheduler(const TtsConfig& config)
+    : m_config{ std::max<size_t>(config.maxInFlight, 1), config.decodeWindow }
+{
+    Base::Logger::log("TTS scheduler started with " + std::to_string(m_config.maxInFlight) + " requests in flight", Base::DEBUG, __FUNCTION__);
+}
+
+TtsScheduler::~TtsScheduler() {
+    stop();
+}
+
+bool TtsScheduler::submit(std::string text, std::shared_ptr<openai::SharedAudioData> audio, std::shared_ptr<Base::CancellationToken> cancelToken) {
+    if (Base::isCancelled(cancelToken)) {
+        audio->cancel();
+        return false;
+    }
+    if (cancelToken) {
+        cancelToken->onCancel([this] { wakeWaiters(); });
+    }
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_slotFree.wait(lock, [&] { return m_stopped || Base::isCancelled(cancelToken) || m_inFlight < m_config.maxInFlight; });
+        if (m_stopped || Base::isCancelled(cancelToken)) {
+            lock.unlock();
+            audio->cancel(); // Nothing will be downloaded, do not leave the player waiting
+            return false;
+        }
+        ++m_inFlight;
+        m_stats.peakInFlight = std::max(m_stats.peakInFlight, m_inFlight);
+    }
+
+    auto ticket = std::make_shared<Ticket>();
+    const openai::HttpEngine::RequestId id = m_openAI.textToSpeechAsync(text, audio,
+        [this, ticket, destination = audio.get()](bool success) { onFinished(*ticket, *destination, success); }, cancelToken);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ticket->id = id;
+    if (!ticket->finished) {
+        m_active.insert(id);
+    }
+    return true;
+}
+
+void TtsScheduler::stop() {
+    std::vector<openai::HttpEngine::RequestId> active;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = true;
+        active.assign(m_active.begin(), m_active.end());
+    }
+    m_slotFree.notify_all();
+    for (openai::HttpEngine::RequestId id : active) {
+        openai::HttpEngine::instance().cancel(id);
+    }
+    // The completion callbacks reference this object
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_slotFree.wait(lock, [this] { return m_inFlight == 0; });
+}
+
+void TtsScheduler::onFinished(Ticket& ticket, const openai::SharedAudioData& audio, bool success) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ticket.finished = true;
+        if (ticket.id != 0) {
+            m_active.erase(ticket.id);
+        }
+        --m_inFlight;
+        if (audio.isCancelled()) {
+            ++m_stats.cancelled;
+        }
+        else if (!success) {
+            ++m_stats.failures;
+        }
+        else {
+            ++m_stats.sentences;
+            if (audio.hasFirstAudio()) {
+                const double ttfb = toMs(audio.firstAudioAt() - audio.requestedAt());
+                m_ttfbTotalMs += ttfb;
+                m_stats.lastTtfbMs = ttfb;
+                m_stats.averageTtfbMs = m_ttfbTotalMs / static_cast<double>(m_stats.sentences);
+                m_stats.maxTtfbMs = std::max(m_stats.maxTtfbMs, ttfb);
+            }
+        }
+    }
+    m_slotFree.notify_all();
+}
+
+void TtsScheduler::wakeWaiters() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex); // Orders the wake-up after a waiter's predicate check
+    }
+    m_slotFree.notify_all();
+}
+
+void TtsScheduler::recordPlaybackGap(const openai::SharedAudioData& previous, const openai::SharedAudioData& next,
+    std::chrono::steady_clock::time_point previousEnded)
+{
+    if (!next.hasFirstAudio()) {
+        return; // Failed request, there was no audio to wait for
+    }
+    const double gap = std::max(0.0, toMs(next.firstAudioAt() - previousEnded));
+
+    // Fetched one at a time, next would only have been requested once previous finished downloading
+    const auto serialFirstAudio = previous.completedAt() + (next.firstAudioAt() - next.requestedAt());
+    const double serialGap = std::max(0.0, toMs(serialFirstAudio - previousEnded));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ++m_stats.gapsMeasured;
+    m_stats.gapMs += gap;
+    m_stats.maxGapMs = std::max(m_stats.maxGapMs, gap);
+    m_stats.gapRemovedMs += std::max(0.0, serialGap - gap);
+}
+
+TtsStats TtsScheduler::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    TtsStats stats = m_stats;
+    stats.inFlight = m_inFlight;
+    return stats;
+}
+
+} // namespace Chat
+} // namespace XPlaneChatBot
@@ -0,0 +1,119 @@
+/**
+ * @file TtsScheduler.h
+ * @author zah
+ * @brief Keeps several text-to-speech requests in flight while their audio is played in order
+ *
+ * Requests run on the HttpEngine thread, each streaming into its own SharedAudioData; the scheduler only limits
+ * how many are in flight, so no thread is spent per download. The caller hands the SharedAudioData objects to the
+ * player in sentence order before submitting them, so ordering comes from the playback queue and the downloads are
+ * free to overlap: sentence N+1 is already downloading while sentence N plays.
+ *
+ * @version 0.1
+ * @date 2024-05-13
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_CHAT_TTSSCHEDULER_H
+#define XPROTECTION_CHAT_TTSSCHEDULER_H
+
+#include "base/logger.h"
+#include "chatbot/openai.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+namespace XPlaneChatBot {
+	namespace Chat {
+
+		/// @brief Configuration of the TTS scheduler
+		struct TtsConfig {
+			size_t maxInFlight{ 3 }; ///< Sentences downloading at the same time
+			openai::DecodeWindowConfig decodeWindow{ 200, false }; ///< Sentences stay Opus-compressed except for this much audio ahead of playback
+		};
+
+		/// @brief TTS request and playback gap statistics
+		struct TtsStats {
+			uint64_t sentences{ 0 }; ///< Requests completed
+			uint64_t failures{ 0 }; ///< Requests that failed
+			uint64_t cancelled{ 0 }; ///< Requests aborted by their cancellation token or stop()
+			size_t inFlight{ 0 }; ///< Requests downloading now
+			size_t peakInFlight{ 0 };
+			double lastTtfbMs{ 0.0 }; ///< Request to first decoded audio, last sentence
+			double averageTtfbMs{ 0.0 };
+			double maxTtfbMs{ 0.0 };
+			uint64_t gapsMeasured{ 0 }; ///< Sentence boundaries within a turn that were measured
+			double gapMs{ 0.0 }; ///< Total silence waiting for the next sentence's audio
+			double maxGapMs{ 0.0 };
+			double gapRemovedMs{ 0.0 }; ///< Estimated silence a one-request-at-a-time fetch would have added on top
+		};
+
+		/// @brief Starts TTS requests on the HttpEngine with a bounded number in flight
+		class TtsScheduler {
+		public:
+			explicit TtsScheduler(const TtsConfig& config = TtsConfig{});
+
+			/// @brief Cancels the requests in flight
+			~TtsScheduler();
+
+			TtsScheduler(const TtsScheduler&) = delete;
+			TtsScheduler& operator=(const TtsScheduler&) = delete;
+
+			/**
+			 * @brief Start a sentence; blocks while maxInFlight requests are already in flight
+			 * @param text Sentence to synthesize
+			 * @param audio Destination of the decoded audio (end of data is signalled when the request finishes)
+			 * @param cancelToken Aborts the request, or the wait for a free slot, and cancels audio (optional)
+			 * @return False if the scheduler is stopped or the token cancelled
+			 */
+			bool submit(std::string text, std::shared_ptr<openai::SharedAudioData> audio, std::shared_ptr<Base::CancellationToken> cancelToken = nullptr);
+
+			/**
+			 * @brief Account the silence between two consecutive sentences of a turn
+			 * @param previous Audio of the sentence that was playing
+			 * @param next Audio of the sentence played after it (played to completion)
+			 * @param previousEnded When the player finished previous
+			 */
+			void recordPlaybackGap(const openai::SharedAudioData& previous, const openai::SharedAudioData& next,
+				std::chrono::steady_clock::time_point previousEnded);
+
+			/// @brief Stop accepting sentences, cancel the requests in flight and wait for their completion
+			void stop();
+
+			TtsStats getStats() const;
+			const TtsConfig& getConfig() const { return m_config; }
+
+		private:
+			/// @brief Request id as seen by its completion callback (the request may complete before submit() returns the id)
+			struct Ticket {
+				openai::HttpEngine::RequestId id{ 0 };
+				bool finished{ false };
+			};
+
+			/// @brief Completion of a request (engine thread)
+			void onFinished(Ticket& ticket, const openai::SharedAudioData& audio, bool success);
+
+			/// @brief Wake submit() so it notices a cancelled token
+			void wakeWaiters();
+
+			const TtsConfig m_config;
+			openai::OpenAI m_openAI; ///< Only builds the requests; they run on the engine thread
+
+			mutable std::mutex m_mutex; ///< Guards everything below
+			std::condition_variable m_slotFree; ///< Signalled when a request completes
+			std::unordered_set<openai::HttpEngine::RequestId> m_active; ///< Requests in flight
+			size_t m_inFlight{ 0 }; ///< Started and not completed (an id may not be known yet)
+			bool m_stopped{ false };
+			TtsStats m_stats;
+			double m_ttfbTotalMs{ 0.0 };
+		};
+
+	} // namespace Chat
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_CHAT_TTSSCHEDULER_H
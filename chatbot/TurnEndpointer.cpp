@@ -0,0 +1,300 @@
+/**
+ * @file TurnEndpointer.cpp
+ * @author zah
+ * @brief Implementation of the adaptive end-of-turn detector
+ * @see TurnEndpointer.h
+ * @version 0.1
+ * @date 2024-03-25
+ *
+ */
+
+#include "TurnEndpointer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <vector>
+
+namespace XPlaneChatBot {
+namespace Chat {
+
+namespace {
+    constexpr size_t kLatencyHistory = 64;
+
+    /// Phrases that close a turn in cockpit conversation
+    const char* const kTerminalPhrases[] = {
+        "over", "roger", "wilco", "thanks", "thank you", "got it", "makes sense", "that's all",
+        "i have control", "i have the controls", "you have control", "you have the controls",
+    };
+
+    /// Words after which the speaker is almost certainly not done
+    const char* const kContinuationWords[] = {
+        "and", "but", "or", "so", "because", "then", "if", "when", "while", "with", "to", "of",
+        "the", "a", "an", "my", "is", "like", "um", "uh", "er", "hmm",
+    };
+
+    std::string toLowerTrimmed(const std::string& text) {
+        size_t end = text.find_last_not_of(" \t\r\n");
+        if (end == std::string::npos) {
+            return "";
+        }
+        std::string result = text.substr(0, end + 1);
+        std::transform(result.begin(), result.end(), result.begin(),
+            [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return result;
+    }
+
+    /// @brief True if text ends with phrase on a word boundary (ignoring trailing punctuation)
+    bool endsWithPhrase(const std::string& text, const std::string& phrase) {
+        size_t end = text.find_last_not_of(".,?!;: ");
+        if (end == std::string::npos || end + 1 < phrase.size()) {
+            return false;
+        }
+        const size_t start = end + 1 - phrase.size();
+        if (text.compare(start, phrase.size(), phrase) != 0) {
+            return false;
+        }
+        return start == 0 || !std::isalnum(static_cast<unsigned char>(text[start - 1]));
+    }
+
+    size_t countWords(const std::string& text) {
+        std::istringstream iss(text);
+        std::string word;
+        size_t count = 0;
+        while (iss >> word) {
+            ++count;
+        }
+        return count;
+    }
+
+    double percentile(std::vector<double> values, double fraction) {
+        if (values.empty()) {
+            return 0.0;
+        }
+        const size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+
+    int elapsedMs(TurnEndpointer::Clock::time_point from, TurnEndpointer::Clock::time_point to) {
+        return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(to - from).count());
+    }
+}
+
+
+TurnEndpointer::TurnEndpointer(const EndpointerConfig& config)
+    : m_config(config)
+{
+}
+
+void TurnEndpointer::setConfig(const EndpointerConfig& config) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_config = config;
+}
+
+void TurnEndpointer::beginTurn(Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // Let the penalty decay slowly after turns that were not cut off
+    if (m_turnEnded && !m_falseCutoffCounted) {
+        m_penaltyMs = std::max(0, m_penaltyMs - m_config.falseCutoffPenaltyMs / 3);
+    }
+    m_turnActive = true;
+    m_turnEnded = false;
+    m_speaking = false;
+    m_falseCutoffCounted = false;
+    m_hasSpeechEnd = false;
+    m_lastSpeechEnd = now;
+    m_lastTextChange = now;
+    m_turnStart = now;
+    m_finalText.clear();
+    m_partialText.clear();
+    m_pendingWordsAtEnd = 0;
+}
+
+void TurnEndpointer::onSpeechStart(Clock::time_point t) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_turnActive) {
+        return;
+    }
+    if (m_turnEnded) {
+        recordFalseCutoffLocked(); // The user kept talking after we ended the turn
+        return;
+    }
+    if (m_hasSpeechEnd) {
+        const int pause = elapsedMs(m_lastSpeechEnd, t);
+        if (pause > 0 && pause < m_config.maxSilenceMs) {
+            m_pausesMs.push_back(pause);
+            while (m_pausesMs.size() > m_config.pauseHistory) {
+                m_pausesMs.pop_front();
+            }
+        }
+    }
+    m_speaking = true;
+}
+
+void TurnEndpointer::onSpeechEnd(Clock::time_point t) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_turnActive || m_turnEnded) {
+        return;
+    }
+    m_speaking = false;
+    m_hasSpeechEnd = true;
+    m_lastSpeechEnd = t;
+}
+
+void TurnEndpointer::onPartial(const std::string& text, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_turnActive) {
+        return;
+    }
+    if (m_turnEnded) {
+        if (countWords(text) > m_pendingWordsAtEnd) {
+            recordFalseCutoffLocked();
+        }
+        return;
+    }
+    if (text != m_partialText) {
+        m_partialText = text;
+        if (!text.empty()) {
+            m_lastTextChange = now;
+        }
+    }
+}
+
+void TurnEndpointer::onFinal(const std::string& text, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_turnActive || text.empty()) {
+        return;
+    }
+    if (m_turnEnded) {
+        // The final for words that were pending when we ended is expected; anything beyond them is new speech
+        if (countWords(text) > m_pendingWordsAtEnd) {
+            recordFalseCutoffLocked();
+        }
+        m_pendingWordsAtEnd = 0;
+        return;
+    }
+    if (!m_finalText.empty() && !std::isspace(static_cast<unsigned char>(m_finalText.back()))
+        && !std::isspace(static_cast<unsigned char>(text.front()))) {
+        m_finalText += ' '; // Consecutive finals are separate utterances
+    }
+    m_finalText += text;
+    m_partialText.clear();
+    m_lastTextChange = now;
+}
+
+bool TurnEndpointer::shouldEndTurn(Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_turnActive) {
+        return false;
+    }
+    if (m_turnEnded) {
+        return true;
+    }
+    if (m_finalText.empty() && m_partialText.empty()) {
+        return false;
+    }
+    if (m_speaking) {
+        // Fallbacks for a detector stuck in speech: the words stopped coming, or the turn has gone on for too long
+        if (elapsedMs(m_lastTextChange, now) < m_config.maxStaleTextMs && elapsedMs(m_turnStart, now) < m_config.maxTurnMs) {
+            return false;
+        }
+        m_turnEnded = true;
+        m_pendingWordsAtEnd = countWords(m_partialText);
+        ++m_turnsEnded;
+        ++m_forcedEnds;
+        return true;
+    }
+
+    // Unfinalized words must settle before we trust the silence
+    if (!m_partialText.empty() && elapsedMs(m_lastTextChange, now) < m_config.partialStableMs) {
+        return false;
+    }
+
+    const Clock::time_point reference = m_hasSpeechEnd ? m_lastSpeechEnd : m_lastTextChange;
+    float scale = phrasingScaleLocked();
+    if (!m_partialText.empty()) {
+        scale = std::max(scale, 1.0f);
+    }
+    const int required = std::clamp(
+        static_cast<int>((adaptiveSilenceMsLocked() + m_penaltyMs) * scale),
+        m_config.minSilenceMs, m_config.maxSilenceMs);
+
+    const int silence = elapsedMs(reference, now);
+    if (silence < required) {
+        return false;
+    }
+
+    m_turnEnded = true;
+    m_pendingWordsAtEnd = countWords(m_partialText);
+    ++m_turnsEnded;
+    m_latenciesMs.push_back(static_cast<double>(silence));
+    while (m_latenciesMs.size() > kLatencyHistory) {
+        m_latenciesMs.pop_front();
+    }
+    return true;
+}
+
+int TurnEndpointer::requiredSilenceMs() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::clamp(
+        static_cast<int>((adaptiveSilenceMsLocked() + m_penaltyMs) * phrasingScaleLocked()),
+        m_config.minSilenceMs, m_config.maxSilenceMs);
+}
+
+EndpointerStats TurnEndpointer::getStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    EndpointerStats stats;
+    stats.turnsEnded = m_turnsEnded;
+    stats.falseCutoffs = m_falseCutoffs;
+    stats.forcedEnds = m_forcedEnds;
+    stats.requiredSilenceMs = std::clamp(adaptiveSilenceMsLocked() + m_penaltyMs, m_config.minSilenceMs, m_config.maxSilenceMs);
+    const std::vector<double> latencies(m_latenciesMs.begin(), m_latenciesMs.end());
+    stats.medianLatencyMs = percentile(latencies, 0.5);
+    stats.p90LatencyMs = percentile(latencies, 0.9);
+    return stats;
+}
+
+int TurnEndpointer::adaptiveSilenceMsLocked() const {
+    if (m_pausesMs.size() < m_config.minPausesToAdapt) {
+        return m_config.initialSilenceMs;
+    }
+    // A turn has ended once the silence is longer than nearly all of the speaker's own mid-sentence pauses
+    const std::vector<double> pauses(m_pausesMs.begin(), m_pausesMs.end());
+    return static_cast<int>(percentile(pauses, 0.9)) + m_config.marginMs;
+}
+
+float TurnEndpointer::phrasingScaleLocked() const {
+    const std::string text = toLowerTrimmed(m_partialText.empty() ? m_finalText : m_finalText + " " + m_partialText);
+    if (text.empty()) {
+        return 1.0f;
+    }
+
+    for (const char* word : kContinuationWords) {
+        if (endsWithPhrase(text, word)) {
+            return m_config.continuationScale;
+        }
+    }
+    for (const char* phrase : kTerminalPhrases) {
+        if (endsWithPhrase(text, phrase)) {
+            return m_config.terminalPhraseScale;
+        }
+    }
+    const char last = text.back();
+    if (last == '.' || last == '?' || last == '!') {
+        return m_config.terminalPunctuationScale;
+    }
+    return 1.0f;
+}
+
+void TurnEndpointer::recordFalseCutoffLocked() {
+    if (m_falseCutoffCounted) {
+        return;
+    }
+    m_falseCutoffCounted = true;
+    ++m_falseCutoffs;
+    m_penaltyMs = std::min(m_config.maxPenaltyMs, m_penaltyMs + m_config.falseCutoffPenaltyMs);
+}
+
+} // namespace Chat
+} // namespace XPlaneChatBot
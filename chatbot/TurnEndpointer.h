@@ -0,0 +1,135 @@
+/**
+ * @file TurnEndpointer.h
+ * @author zah
+ * @brief Adaptive end-of-turn detection for user transcriptions
+ *
+ * Replaces the fixed 2 second pause check. A turn ends once the user has been silent for a required duration
+ * which is derived from:
+ * + the speaker's own intra-turn pauses (the threshold adapts to how the speaker talks),
+ * + how stable the current partial transcript is (unfinalized words make it wait),
+ * + the phrasing of the transcript (terminal punctuation or phrases end sooner, trailing conjunctions and fillers later),
+ * + a penalty that grows every time a turn was cut off and the user kept talking (false cut-off).
+ *
+ * Steady noise can hold the voice activity detector in speech, so a turn with a transcript also ends once the
+ * transcript has not changed for a while, or once the turn has run for a maximum time, whatever the detector says.
+ *
+ * All methods take the current time explicitly so a recorded session can be replayed offline.
+ *
+ * @version 0.1
+ * @date 2024-03-25
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_CHAT_TURNENDPOINTER_H
+#define XPROTECTION_CHAT_TURNENDPOINTER_H
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+
+namespace XPlaneChatBot {
+	namespace Chat {
+
+		/// @brief Tuning parameters for the endpointer
+		struct EndpointerConfig {
+			int initialSilenceMs{ 800 }; ///< Required silence before enough pauses have been observed
+			int minSilenceMs{ 300 }; ///< Lower clamp of the required silence
+			int maxSilenceMs{ 2000 }; ///< Upper clamp of the required silence (the old fixed threshold)
+			int marginMs{ 150 }; ///< Added to the speaker's 90th percentile intra-turn pause
+			size_t pauseHistory{ 32 }; ///< Number of intra-turn pauses remembered per speaker
+			size_t minPausesToAdapt{ 4 }; ///< Pauses needed before the threshold adapts
+			int partialStableMs{ 300 }; ///< How long an unfinalized partial must stay unchanged
+			float terminalPunctuationScale{ 0.6f }; ///< Scale applied when the transcript ends with . ? or !
+			float terminalPhraseScale{ 0.5f }; ///< Scale applied when it ends with a closing phrase ("over", "roger", ...)
+			float continuationScale{ 1.8f }; ///< Scale applied when it ends with a conjunction or filler ("and", "um", ...)
+			int falseCutoffPenaltyMs{ 150 }; ///< Added to the threshold after each false cut-off
+			int maxPenaltyMs{ 900 }; ///< Cap on the accumulated false cut-off penalty
+			int maxStaleTextMs{ 3000 }; ///< End a turn whose transcript has not changed for this long, even during speech
+			int maxTurnMs{ 30000 }; ///< End a turn with a transcript after this long, even during speech
+		};
+
+		/// @brief Counters and latency figures for the endpointer
+		struct EndpointerStats {
+			uint64_t turnsEnded{ 0 }; ///< Turns ended by the endpointer
+			uint64_t falseCutoffs{ 0 }; ///< Turns where speech or new text arrived after the turn was ended
+			uint64_t forcedEnds{ 0 }; ///< Turns ended by maxStaleTextMs or maxTurnMs while the detector still heard speech
+			int requiredSilenceMs{ 0 }; ///< Current adaptive threshold (before phrasing scale)
+			double medianLatencyMs{ 0.0 }; ///< Median time from the end of speech to the end of turn
+			double p90LatencyMs{ 0.0 }; ///< 90th percentile of the same
+		};
+
+		/// @brief Decides when a user has finished speaking (thread-safe)
+		class TurnEndpointer {
+		public:
+			using Clock = std::chrono::steady_clock;
+
+			explicit TurnEndpointer(const EndpointerConfig& config = EndpointerConfig{});
+
+			/// @brief Replace the tuning parameters
+			void setConfig(const EndpointerConfig& config);
+
+			/// @brief Start a new user turn (keeps the speaker model)
+			void beginTurn(Clock::time_point now);
+
+			/// @brief Voice activity detector reported the start of speech at t
+			void onSpeechStart(Clock::time_point t);
+
+			/// @brief Voice activity detector reported the end of speech at t
+			void onSpeechEnd(Clock::time_point t);
+
+			/// @brief A partial transcript arrived (an empty one means nothing is pending)
+			void onPartial(const std::string& text, Clock::time_point now);
+
+			/// @brief A final transcript arrived
+			void onFinal(const std::string& text, Clock::time_point now);
+
+			/**
+			 * @brief Check whether the turn should end now
+			 * @return True once the required silence has elapsed; stays true until the next beginTurn
+			 */
+			bool shouldEndTurn(Clock::time_point now);
+
+			/// @brief Required silence for the current transcript, including phrasing scale and penalty
+			int requiredSilenceMs() const;
+
+			EndpointerStats getStats() const;
+
+		private:
+			int adaptiveSilenceMsLocked() const;
+			float phrasingScaleLocked() const;
+			void recordFalseCutoffLocked();
+
+			EndpointerConfig m_config;
+			mutable std::mutex m_mutex;
+
+			// Current turn
+			bool m_turnActive{ false };
+			bool m_turnEnded{ false };
+			bool m_speaking{ false };
+			bool m_falseCutoffCounted{ false }; ///< Only count one false cut-off per ended turn
+			Clock::time_point m_lastSpeechEnd{}; ///< Last VAD speech end (or turn start)
+			Clock::time_point m_lastTextChange{}; ///< Last time the transcript text changed
+			Clock::time_point m_turnStart{};
+			bool m_hasSpeechEnd{ false }; ///< True once the VAD reported the end of speech in this turn
+			std::string m_finalText; ///< Finalized transcript of the turn
+			std::string m_partialText; ///< Pending unfinalized words
+			size_t m_pendingWordsAtEnd{ 0 }; ///< Unfinalized words when the turn was ended (their final is expected)
+
+			// Speaker model
+			std::deque<int> m_pausesMs; ///< Recent intra-turn pauses
+			int m_penaltyMs{ 0 }; ///< Accumulated false cut-off penalty
+
+			// Statistics
+			uint64_t m_turnsEnded{ 0 };
+			uint64_t m_falseCutoffs{ 0 };
+			uint64_t m_forcedEnds{ 0 };
+			std::deque<double> m_latenciesMs; ///< Recent end-of-speech to end-of-turn latencies
+		};
+
+	} // namespace Chat
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_CHAT_TURNENDPOINTER_H
@@ -0,0 +1,231 @@
+/**
+ * @file VoiceActivityDetector.cpp
+ * @author zah
+ * @brief Implementation of the voice activity detector and silence gate
+ * @see VoiceActivityDetector.h
+ * @version 0.1
+ * @date 2024-03-18
+ *
+ */
+
+#include "VoiceActivityDetector.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define XP_VAD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace XPlaneChatBot {
+namespace Chat {
+
+namespace {
+    constexpr double kFullScaleSquared = 32768.0 * 32768.0;
+    constexpr float kMinDb = -100.0f;
+}
+
+
+VoiceActivityDetector::VoiceActivityDetector(int sampleRate, const VadConfig& config)
+    : m_sampleRate(sampleRate)
+{
+    setConfig(config);
+}
+
+void VoiceActivityDetector::setConfig(const VadConfig& config) {
+    m_config = config;
+    m_frameSamples = std::max<size_t>(1, static_cast<size_t>(m_sampleRate) * m_config.frameMs / 1000);
+    m_onsetFrames = std::max(1, m_config.onsetMs / m_config.frameMs);
+    m_hangoverFrames = std::max(1, m_config.hangoverMs / m_config.frameMs);
+    m_longSpeechFrames = std::max(1, m_config.longSpeechMs / m_config.frameMs);
+    m_pending.reserve(m_frameSamples);
+}
+
+void VoiceActivityDetector::reset(std::chrono::steady_clock::time_point sessionStart) {
+    m_sessionStart = sessionStart;
+    m_pending.clear();
+    m_position = 0;
+    m_speaking = false;
+    m_speechRun = 0;
+    m_silenceRun = 0;
+    m_speakingFrames = 0;
+    m_speechRunStart = 0;
+    m_lastSpeechEnd = 0;
+    // Keep the noise floor: the room does not change between turns
+}
+
+std::chrono::steady_clock::time_point VoiceActivityDetector::timeOf(uint64_t samplePosition) const {
+    const auto micros = static_cast<long long>(samplePosition * 1'000'000 / static_cast<uint64_t>(m_sampleRate));
+    return m_sessionStart + std::chrono::microseconds(micros);
+}
+
+bool VoiceActivityDetector::process(const int16_t* samples, size_t count, std::vector<VadEvent>& events) {
+    bool speechSeen = m_speaking;
+
+    // Complete a frame left over from the previous call first
+    if (!m_pending.empty()) {
+        const size_t take = std::min(count, m_frameSamples - m_pending.size());
+        m_pending.insert(m_pending.end(), samples, samples + take);
+        samples += take;
+        count -= take;
+        if (m_pending.size() == m_frameSamples) {
+            processFrame(m_pending.data(), m_frameSamples, events);
+            speechSeen = speechSeen || m_speaking || m_speechRun > 0;
+            m_pending.clear();
+        }
+    }
+
+    while (count >= m_frameSamples) {
+        processFrame(samples, m_frameSamples, events);
+        speechSeen = speechSeen || m_speaking || m_speechRun > 0;
+        samples += m_frameSamples;
+        count -= m_frameSamples;
+    }
+
+    m_pending.insert(m_pending.end(), samples, samples + count);
+    return speechSeen;
+}
+
+void VoiceActivityDetector::processFrame(const int16_t* frame, size_t count, std::vector<VadEvent>& events) {
+    const double energy = meanSquare(frame, count);
+    const float energyDb = std::max(kMinDb, static_cast<float>(10.0 * std::log10(energy / kFullScaleSquared + 1e-12)));
+    const float zcr = zeroCrossingRate(frame, count);
+
+    const float threshold = std::max(m_noiseFloorDb + m_config.snrThresholdDb, m_config.minSpeechDb);
+    const bool loud = energyDb > m_noiseFloorDb + 2.0f * m_config.snrThresholdDb;
+    const bool isSpeech = energyDb > threshold && (zcr < m_config.maxSpeechZcr || loud);
+
+    // Track the noise floor outside speech, falling quickly and rising slowly
+    if (!isSpeech && !m_speaking) {
+        const float rate = energyDb < m_noiseFloorDb ? m_config.noiseAdaptDown : m_config.noiseAdaptUp;
+        m_noiseFloorDb += (energyDb - m_noiseFloorDb) * rate;
+    }
+    else if (m_speaking && ++m_speakingFrames > m_longSpeechFrames) {
+        // Nobody talks this long without a pause: keep adapting, very slowly, so steady engine noise or echo
+        // residual loud enough to pass for speech cannot hold the speech state forever
+        const float rate = energyDb < m_noiseFloorDb ? m_config.noiseAdaptDown : m_config.noiseAdaptSpeech;
+        m_noiseFloorDb += (energyDb - m_noiseFloorDb) * rate;
+    }
+
+    const uint64_t frameStart = m_position;
+    m_position += count;
+
+    if (isSpeech) {
+        if (m_speechRun == 0) {
+            m_speechRunStart = frameStart;
+        }
+        ++m_speechRun;
+        m_silenceRun = 0;
+        m_lastSpeechEnd = m_position;
+        if (!m_speaking && m_speechRun >= m_onsetFrames) {
+            m_speaking = true;
+            m_speakingFrames = 0;
+            events.push_back({ VadEventType::SpeechStart, m_speechRunStart, timeOf(m_speechRunStart) });
+        }
+        return;
+    }
+
+    m_speechRun = 0;
+    if (m_speaking && ++m_silenceRun >= m_hangoverFrames) {
+        m_speaking = false;
+        m_silenceRun = 0;
+        events.push_back({ VadEventType::SpeechEnd, m_lastSpeechEnd, timeOf(m_lastSpeechEnd) });
+    }
+}
+
+double VoiceActivityDetector::meanSquare(const int16_t* samples, size_t count) {
+    if (count == 0) {
+        return 0.0;
+    }
+    uint64_t sum = 0;
+    size_t i = 0;
+#ifdef XP_VAD_SSE2
+    __m128i acc = _mm_setzero_si128();
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= count; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+        // Pairwise sums of squares fit in an unsigned 32-bit lane (at most 2 * 32768^2)
+        const __m128i sq = _mm_madd_epi16(v, v);
+        acc = _mm_add_epi64(acc, _mm_unpacklo_epi32(sq, zero));
+        acc = _mm_add_epi64(acc, _mm_unpackhi_epi32(sq, zero));
+    }
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    sum = lanes[0] + lanes[1];
+#endif
+    for (; i < count; ++i) {
+        sum += static_cast<uint64_t>(static_cast<int32_t>(samples[i]) * samples[i]);
+    }
+    return static_cast<double>(sum) / static_cast<double>(count);
+}
+
+float VoiceActivityDetector::zeroCrossingRate(const int16_t* samples, size_t count) {
+    if (count < 2) {
+        return 0.0f;
+    }
+    size_t crossings = 0;
+    size_t i = 0;
+#ifdef XP_VAD_SSE2
+    const __m128i ones = _mm_set1_epi16(1);
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 9 <= count; i += 8) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i + 1));
+        // Sign bit of a ^ b is set where the pair changes sign; shift it down to 0/1 per lane
+        const __m128i changed = _mm_srli_epi16(_mm_xor_si128(a, b), 15);
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(changed, ones));
+    }
+    alignas(16) int32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), acc);
+    crossings = static_cast<size_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+#endif
+    for (; i + 1 < count; ++i) {
+        crossings += ((samples[i] ^ samples[i + 1]) < 0) ? 1 : 0;
+    }
+    return static_cast<float>(crossings) / static_cast<float>(count - 1);
+}
+
+
+SilenceGate::SilenceGate(int chunkMs, const VadConfig& config)
+    : m_config(config)
+    , m_chunkMs(chunkMs)
+{
+}
+
+void SilenceGate::reset() {
+    m_silentMs = 0;
+    m_sinceKeepAliveMs = 0;
+    m_holding = false;
+}
+
+SilenceGate::Decision SilenceGate::next(bool containsSpeech) {
+    if (containsSpeech) {
+        const Decision decision = m_holding ? Decision::SendWithPreroll : Decision::Send;
+        m_silentMs = 0;
+        m_sinceKeepAliveMs = 0;
+        m_holding = false;
+        return decision;
+    }
+
+    m_silentMs += m_chunkMs;
+    if (m_config.silencePolicy == SilencePolicy::Stream || m_silentMs <= m_config.silenceTailMs) {
+        m_holding = false;
+        return Decision::Send;
+    }
+
+    if (m_config.silencePolicy == SilencePolicy::Thin) {
+        m_sinceKeepAliveMs += m_chunkMs;
+        if (m_sinceKeepAliveMs >= m_config.keepAliveMs) {
+            m_sinceKeepAliveMs = 0;
+            m_holding = false;
+            return Decision::Send;
+        }
+    }
+
+    m_holding = true;
+    return Decision::Hold;
+}
+
+} // namespace Chat
+} // namespace XPlaneChatBot
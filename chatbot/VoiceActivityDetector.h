@@ -0,0 +1,173 @@
+/**
+ * @file VoiceActivityDetector.h
+ * @author zah
+ * @brief Cheap energy + zero-crossing voice activity detector for the capture path
+ *
+ * The detector splits captured int16 audio into short analysis frames, tracks an adaptive noise floor and
+ * raises SpeechStart/SpeechEnd events. The SilenceGate uses its decisions to suppress or thin out silent chunks
+ * before they reach the websocket, so long pauses cost neither bandwidth nor STT time.
+ *
+ * @version 0.1
+ * @date 2024-03-18
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_CHAT_VOICEACTIVITYDETECTOR_H
+#define XPROTECTION_CHAT_VOICEACTIVITYDETECTOR_H
+
+#include <cstdint>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace XPlaneChatBot {
+	namespace Chat {
+
+		/// @brief What to do with chunks the detector classifies as silence
+		enum class SilencePolicy {
+			Stream, ///< Send everything (VAD only reports events)
+			Thin, ///< After the tail, send one silent chunk per keep-alive interval
+			Suppress, ///< After the tail, send nothing until speech resumes
+		};
+
+		/// @brief Tuning parameters for the detector and the silence gate
+		struct VadConfig {
+			int frameMs{ 20 }; ///< Analysis frame length
+			float snrThresholdDb{ 9.0f }; ///< Energy above the noise floor needed to count as speech
+			float minSpeechDb{ -55.0f }; ///< Absolute energy floor (dBFS) below which nothing is speech
+			float maxSpeechZcr{ 0.35f }; ///< Zero-crossing rate above which quiet frames are treated as noise
+			int onsetMs{ 60 }; ///< Speech needed before SpeechStart is raised
+			int hangoverMs{ 400 }; ///< Silence needed before SpeechEnd is raised
+			float noiseAdaptUp{ 0.01f }; ///< Noise floor tracking rate when the level rises (per frame)
+			float noiseAdaptDown{ 0.2f }; ///< Noise floor tracking rate when the level falls (per frame)
+			int longSpeechMs{ 5000 }; ///< Speech state held this long without a break is suspected to be steady noise
+			float noiseAdaptSpeech{ 0.002f }; ///< Noise floor rise rate (per frame) during such a run, about 10 s to settle
+
+			SilencePolicy silencePolicy{ SilencePolicy::Thin }; ///< Gating applied to silent chunks
+			int silenceTailMs{ 1000 }; ///< Silence still streamed after SpeechEnd so the STT can finalize
+			int keepAliveMs{ 1000 }; ///< Interval between silent chunks under SilencePolicy::Thin
+		};
+
+		/// @brief Kind of voice activity event
+		enum class VadEventType {
+			SpeechStart,
+			SpeechEnd,
+		};
+
+		/// @brief Voice activity event with the capture time it refers to
+		struct VadEvent {
+			VadEventType type; ///< Start or end of speech
+			uint64_t samplePosition; ///< Position in the capture stream (samples since the session started)
+			std::chrono::steady_clock::time_point timestamp; ///< Wall-clock time of that position
+		};
+
+		static const std::string vadEventTypeToString(const VadEventType& type) {
+			switch (type) {
+			case VadEventType::SpeechStart: return "SpeechStart";
+			case VadEventType::SpeechEnd: return "SpeechEnd";
+			default: return "Unknown";
+			}
+		}
+
+		/// @brief Energy and zero-crossing voice activity detector (single-threaded; owned by the sender thread)
+		class VoiceActivityDetector {
+		public:
+			/**
+			 * @brief Construct the detector
+			 * @param sampleRate Capture sample rate (mono)
+			 * @param config Tuning parameters
+			 */
+			VoiceActivityDetector(int sampleRate, const VadConfig& config = VadConfig{});
+
+			/// @brief Start a new capture session at the given wall-clock time
+			void reset(std::chrono::steady_clock::time_point sessionStart);
+
+			/// @brief Replace the tuning parameters (call between sessions)
+			void setConfig(const VadConfig& config);
+			const VadConfig& getConfig() const { return m_config; }
+
+			/**
+			 * @brief Analyse a chunk of mono samples
+			 * @param samples Captured samples
+			 * @param count Number of samples
+			 * @param events Receives the events raised inside this chunk (appended)
+			 * @return True if any frame in the chunk was speech or the detector is still in speech state
+			 */
+			bool process(const int16_t* samples, size_t count, std::vector<VadEvent>& events);
+
+			/// @brief True while the detector is in the speech state
+			bool isSpeaking() const { return m_speaking; }
+
+			/// @brief Current noise floor estimate in dBFS
+			float noiseFloorDb() const { return m_noiseFloorDb; }
+
+			/// @brief Wall-clock time of a capture stream position
+			std::chrono::steady_clock::time_point timeOf(uint64_t samplePosition) const;
+
+			/// @brief Mean square energy of a block of samples (SIMD)
+			static double meanSquare(const int16_t* samples, size_t count);
+
+			/// @brief Fraction of adjacent sample pairs that change sign (SIMD)
+			static float zeroCrossingRate(const int16_t* samples, size_t count);
+
+		private:
+			void processFrame(const int16_t* frame, size_t count, std::vector<VadEvent>& events);
+
+			VadConfig m_config;
+			const int m_sampleRate;
+			size_t m_frameSamples; ///< Samples per analysis frame
+			int m_onsetFrames; ///< Consecutive speech frames needed for SpeechStart
+			int m_hangoverFrames; ///< Consecutive silent frames needed for SpeechEnd
+			int m_longSpeechFrames; ///< Frames in the speech state after which the noise floor adapts again
+
+			std::vector<int16_t> m_pending; ///< Samples carried over to the next call (less than one frame)
+			uint64_t m_position{ 0 }; ///< Samples analysed since reset
+			std::chrono::steady_clock::time_point m_sessionStart{};
+
+			float m_noiseFloorDb{ -60.0f }; ///< Adaptive noise floor
+			bool m_speaking{ false };
+			int m_speechRun{ 0 }; ///< Consecutive speech frames
+			int m_silenceRun{ 0 }; ///< Consecutive silent frames
+			int m_speakingFrames{ 0 }; ///< Frames since SpeechStart
+			uint64_t m_speechRunStart{ 0 }; ///< Position of the first frame of the current speech run
+			uint64_t m_lastSpeechEnd{ 0 }; ///< Position just after the last speech frame
+		};
+
+		/**
+		 * @brief Decides, chunk by chunk, whether captured audio should be sent upstream
+		 *
+		 * Speech chunks are always sent, together with the chunk right before them so onsets are not clipped.
+		 * Silence keeps streaming for silenceTailMs after speech so the STT can finalize, then the policy applies.
+		 */
+		class SilenceGate {
+		public:
+			/// @brief Result of the gate for one chunk
+			enum class Decision {
+				Send, ///< Send the chunk
+				SendWithPreroll, ///< Send the held pre-roll chunk, then this one
+				Hold, ///< Do not send; keep as pre-roll in case speech follows
+			};
+
+			SilenceGate(int chunkMs, const VadConfig& config = VadConfig{});
+
+			/// @brief Forget all state (new session)
+			void reset();
+			void setConfig(const VadConfig& config) { m_config = config; }
+
+			/// @brief Classify the next chunk
+			/// @param containsSpeech Result of VoiceActivityDetector::process for the chunk
+			Decision next(bool containsSpeech);
+
+		private:
+			VadConfig m_config;
+			const int m_chunkMs;
+			int m_silentMs{ 0 }; ///< Silence since the last speech chunk
+			int m_sinceKeepAliveMs{ 0 }; ///< Silence since the last silent chunk that was sent
+			bool m_holding{ false }; ///< True if the previous chunk was held back
+		};
+
+	} // namespace Chat
+} // namespace XPlaneChatBot
+
+#endif // XPROTECTION_CHAT_VOICEACTIVITYDETECTOR_H
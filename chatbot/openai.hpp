@@ -1,473 +1,784 @@
-#ifndef XP_OPENAI_HPP_
-#define XP_OPENAI_HPP_
-
-// Required standard libraries
-#include <string>
-#include <queue>
-#include <iostream>
-#include <stdexcept>
-
-// Thread synchronization libraries
-#include <mutex>
-#include <condition_variable>
-
-// Curl communication libraries
-#include <curl/curl.h>
-#include <nlohmann/json.hpp>
-
-// Audio processing libraries
-#include <ogg/ogg.h>
-#include <opus/opus.h>
-#include <portaudio.h>
-
-// Project headers
-#include "ChatStructures.hpp"
-
-namespace XPlaneChatBot {
-namespace openai {
-    // Define constants for audio settings
-    constexpr int SAMPLE_RATE = 24000;
-    constexpr int CHANNELS = 1;
-    constexpr int FRAMES_PER_BUFFER = 960;
-
-    class SharedAudioData; // Forward declaration of SharedAudioData class
-
-    /// @brief Struct that contains the text and audio data for a message
-    struct TextAudioPair {
-        std::string text; ///< Text of the message
-        std::shared_ptr<SharedAudioData> audioData; ///< Audio data of the message
-        bool played = false;  ///< Flag to indicate if the audio has begun playing
-    };
-
-    class SharedAudioData {
-
-    public:
-        // Constructor
-        SharedAudioData() : dataReady(false), opusDecoder(nullptr), opusError(OPUS_OK), oggInitialized(false), serial_number(-1) {
-            // Initialize the Ogg sync state
-            ogg_sync_init(&oy);
-        }
-
-        // Destructor
-        ~SharedAudioData() {
-            if (opusDecoder) {
-                opus_decoder_destroy(opusDecoder);
-                opusDecoder = nullptr;
-            }
-            if (oggInitialized) {
-                ogg_stream_clear(&os);
-                ogg_sync_clear(&oy);
-                oggInitialized = false;
-            }
-        }
-
-        // Initialize the Ogg stream state; should be called when a new stream is detected
-        void initOggStream(int serial) {
-            if (ogg_stream_init(&os, serial) != 0) {
-                throw std::runtime_error("Failed to initialize Ogg stream state.");
-            }
-            serial_number = serial;
-            oggInitialized = true;
-        }
-
-        // Reset the Ogg stream state; should be called for a new logical stream
-        void resetStreamAndDecoder() {
-            if (oggInitialized) {
-                ogg_stream_clear(&os);
-                ogg_sync_clear(&oy);
-                oggInitialized = false;
-            }
-            if (opusDecoder) {
-                opus_decoder_destroy(opusDecoder);
-                opusDecoder = nullptr;
-                initOpusDecoder();  // Re-initialize the Opus decoder for the next playback
-            }
-            else {
-                initOpusDecoder();
-            }
-            serial_number = -1;  // Reset serial number for the new stream
-        }
-
-
-        void initOpusDecoder() {
-            if (!opusDecoder) {
-                opusDecoder = opus_decoder_create(SAMPLE_RATE, CHANNELS, &opusError);
-                if (opusError != OPUS_OK) {
-                    throw std::runtime_error("Failed to create Opus decoder: " + std::string(opus_strerror(opusError)));
-                }
-            }
-        }
-
-        void processData(void* ptr, size_t size) {
-            // Buffer to store the incoming Ogg data
-            char* buffer = ogg_sync_buffer(&oy, static_cast<long>(size));
-            memcpy(buffer, ptr, size);
-            ogg_sync_wrote(&oy, static_cast<long>(size));
-
-            // Process the Ogg pages and extract Opus packets
-            while (ogg_sync_pageout(&oy, &og) == 1) {
-                if (!oggInitialized || serial_number == -1) {
-                    serial_number = ogg_page_serialno(&og);
-                    initOggStream(serial_number);
-                }
-
-                if (ogg_stream_pagein(&os, &og) != 0) {
-                    Base::Logger::log("Failed to read Ogg page into stream.", Base::ERR, __FUNCTION__);
-                }
-
-                while (ogg_stream_packetout(&os, &op) == 1) {
-                    // Check for header packets
-                    if (op.bytes >= 19 && strncmp(reinterpret_cast<char*>(op.packet), "OpusHead", 8) == 0) {
-                        Base::Logger::log("OpusHead header found.", Base::DEBUG, __FUNCTION__);
-                        // The OpusHead header format:
-                        // - "OpusHead" (8 bytes)
-                        // - Version number (1 byte)
-                        // - Channel count (1 byte)
-                        // - Pre-skip (2 bytes)
-                        // - Sample rate (4 bytes)
-                        // - Output gain (2 bytes)
-                        // - Channel mapping (1 byte)
-                        unsigned char version = op.packet[8];
-                        unsigned char channel_count = op.packet[9];
-                        unsigned short pre_skip = *reinterpret_cast<unsigned short*>(op.packet + 10);
-                        unsigned int sample_rate = *reinterpret_cast<unsigned int*>(op.packet + 12);
-                        short output_gain = *reinterpret_cast<short*>(op.packet + 16);
-                        unsigned char channel_mapping = op.packet[18];
-
-                        Base::Logger::log("Version number: " + std::to_string(static_cast<unsigned int>(version)), Base::DEBUG, __FUNCTION__);
-                        Base::Logger::log("Channel count: " + std::to_string(static_cast<unsigned int>(channel_count)), Base::DEBUG, __FUNCTION__);
-                        Base::Logger::log("Pre-skip: " + std::to_string(pre_skip), Base::DEBUG, __FUNCTION__);
-                        Base::Logger::log("Sample rate: " + std::to_string(sample_rate), Base::DEBUG, __FUNCTION__);
-                        Base::Logger::log("Output gain: " + std::to_string(output_gain), Base::DEBUG, __FUNCTION__);
-                        Base::Logger::log("Channel mapping: " + std::to_string(static_cast<unsigned int>(channel_mapping)), Base::DEBUG, __FUNCTION__);
-
-                        continue; // Skip decoding the header packet
-                    }
-
-                    if (op.bytes >= 16 && strncmp(reinterpret_cast<char*>(op.packet), "OpusTags", 8) == 0) {
-                        Base::Logger::log("OpusTags header found.", Base::DEBUG, __FUNCTION__);
-                        // The OpusTags header format:
-                        // - "OpusTags" (8 bytes)
-                        // - Vendor string length (4 bytes)
-                        // - Vendor string (variable length)
-                        unsigned int vendor_length = *reinterpret_cast<unsigned int*>(op.packet + 8);
-                        std::string vendor_string(reinterpret_cast<char*>(op.packet + 12), vendor_length);
-
-                        Base::Logger::log("Vendor string: " + vendor_string, Base::DEBUG, __FUNCTION__);
-                        // You might want to include more processing here to read comments
-                        continue; // Skip decoding the tag packet
-                    }
-
-
-                    // Decode the Opus packet
-                    float decodedPCM[FRAMES_PER_BUFFER * CHANNELS];
-                    int frameSize = opus_decode_float(opusDecoder, op.packet, op.bytes, decodedPCM, FRAMES_PER_BUFFER, 0);
-                    if (frameSize < 0) {
-                        Base::Logger::log("Opus decoding error: " + std::string(opus_strerror(frameSize)), Base::ERR, __FUNCTION__);
-                        continue;
-                    }
-
-                    addData(decodedPCM, frameSize * CHANNELS);
-                    dataReady = true;
-                }
-            }
-        }
-
-        void addData(const float* data, size_t size) {
-            std::lock_guard<std::mutex> lock(audioMutex);
-            for (size_t i = 0; i < size; ++i) {
-                audioBuffer.push(data[i]);
-            }
-        }
-
-        size_t getData(float* output, size_t framesPerBuffer) {
-            std::lock_guard<std::mutex> lock(audioMutex);
-            size_t i = 0;
-            for (; i < framesPerBuffer && !audioBuffer.empty(); ++i) {
-                output[i] = audioBuffer.front();
-                audioBuffer.pop();
-            }
-            return i; // Number of frames read
-        }
-
-        // Getters
-        bool isDataReady() const { return dataReady; }
-        bool isEndOfData() const { return endOfData; }
-
-        // Setters
-        void setDataReady(bool ready) { dataReady = ready; }
-        void signalEndOfData() { endOfData = true; }
-    private:
-        std::atomic<bool> dataReady{ false };
-        std::atomic<bool> endOfData{ false };
-        std::queue<float> audioBuffer;
-        std::mutex audioMutex;
-
-        ogg_sync_state oy;          // Ogg sync state, for syncing with the Ogg stream
-        ogg_stream_state os;        // Ogg stream state, for handling logical streams
-        ogg_page og;                // Ogg page, a single unit of data in an Ogg stream
-        ogg_packet op;              // Ogg packet, contains encoded Opus data
-        OpusDecoder* opusDecoder;   // Opus decoder state
-        int opusError;              // Error code returned by Opus functions
-        bool oggInitialized;        // Flag to track if Ogg and Opus have been initialized
-        int serial_number;          // Serial number for the Ogg stream
-    };
-
-
-    class OpusPlayer {
-    public:
-        OpusPlayer() {
-            m_err = Pa_Initialize();
-            if (m_err != paNoError) {
-                Base::Logger::log("PortAudio stream initialization error: " + std::string(Pa_GetErrorText(m_err)), Base::ERR, __FUNCTION__);
-            }
-        }
-
-        ~OpusPlayer() {
-            m_err = Pa_Terminate();
-            if (m_err != paNoError) {
-                Base::Logger::log("PortAudio stream termination error: " + std::string(Pa_GetErrorText(m_err)), Base::ERR, __FUNCTION__);
-            }
-        }
-
-        void playAudio(SharedAudioData* shared_data) {
-            // Open PortAudio stream
-            m_err = Pa_OpenDefaultStream(&m_stream, 0, CHANNELS, paFloat32, SAMPLE_RATE, FRAMES_PER_BUFFER, audioCallback, shared_data);
-            if (m_err != paNoError) {
-                Base::Logger::log("PortAudio stream open error: " + std::string(Pa_GetErrorText(m_err)), Base::ERR, __FUNCTION__);
-                return;
-            }
-
-            // Start PortAudio stream for playback
-            m_err = Pa_StartStream(m_stream);
-            if (m_err != paNoError) {
-                Base::Logger::log("PortAudio stream start error: " + std::string(Pa_GetErrorText(m_err)), Base::ERR, __FUNCTION__);
-                Pa_CloseStream(m_stream);
-                return;
-            }
-
-            while (Pa_IsStreamActive(m_stream) == 1) {
-				Pa_Sleep(1000);
-			}
-
-            // Stop and close PortAudio stream
-            m_err = Pa_StopStream(m_stream);
-            if (m_err != paNoError) {
-                Base::Logger::log("PortAudio stream stop error: " + std::string(Pa_GetErrorText(m_err)), Base::ERR, __FUNCTION__);
-                return;
-            }
-        }
-
-    private:
-        PaStream* m_stream{ nullptr };
-        PaError m_err{ paNoError };
-
-        // Define PortAudio callback function to play audio
-        static int audioCallback(const void* inputBuffer, void* outputBuffer,
-            unsigned long framesPerBuffer,
-            const PaStreamCallbackTimeInfo* timeInfo,
-            PaStreamCallbackFlags statusFlags,
-            void* userData) {
-            SharedAudioData* sharedData = static_cast<SharedAudioData*>(userData);
-
-            float* out = static_cast<float*>(outputBuffer);
-            std::fill(out, out + framesPerBuffer * CHANNELS, 0.0f); // Fill buffer with silence
-
-            if (!sharedData->isDataReady()) {
-                // No data available yet, just play silence
-                return paContinue;
-            }
-
-            size_t bytesRead = sharedData->getData(out, framesPerBuffer * CHANNELS);
-            if (bytesRead < framesPerBuffer * CHANNELS) {
-                // Buffer underflow, not enough data available
-                sharedData->setDataReady(false); // Wait for more data
-                if (sharedData->isEndOfData()) {
-                    return paComplete; // End of data
-                }
-            }
-
-            return paContinue;
-        }
-
-    };
-
-
-    /**
-    * @brief Class to handle the curl session
-    */
-    class Session {
-    public:
-        /// @brief Construct a new Session object by initializing curl and setting the options
-        Session() {
-            // Initialize curl
-            curl_global_init(CURL_GLOBAL_ALL);// || CURL_VERSION_THREADSAFE);
-
-            curl_ = curl_easy_init();
-            if (curl_ == nullptr) {
-                Base::Logger::log("OpenAI curl_easy_init() failed", Base::ERR, __FUNCTION__);
-            }
-
-            // Ignore SSL
-            curl_easy_setopt(curl_, CURLOPT_SSL_VERIFYPEER, 0L);
-        }
-
-        /// @brief Destroy the Session object by cleaning up curl
-        ~Session() {
-            curl_easy_cleanup(curl_);
-            curl_global_cleanup();
-        }
-
-        /// @brief Set the url to make the request to
-        void setUrl(const std::string& url) { url_ = url; }
-
-        /// @brief Set the token to use for authentication
-        void setToken(const std::string& token) {
-            token_ = token;
-        }
-
-        /// @brief Set the body of the request to send
-        void setBody(const std::string& data) {
-            if (curl_) {
-                curl_easy_setopt(curl_, CURLOPT_POSTFIELDSIZE, data.length());
-                curl_easy_setopt(curl_, CURLOPT_POSTFIELDS, data.data());
-            }
-        }
-
-        template <typename Data>
-        bool makeRequest(Data* data, size_t(*writeFunc)(void*, size_t, size_t, void*)) {
-            std::lock_guard<std::mutex> lock(mutex_request_);
-
-            auto headers = createHeaders();
-            curl_easy_setopt(curl_, CURLOPT_HTTPHEADER, headers.get());
-            curl_easy_setopt(curl_, CURLOPT_URL, url_.c_str());
-            curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, writeFunc);
-            curl_easy_setopt(curl_, CURLOPT_WRITEDATA, data);
-
-            return curl_easy_perform(curl_) == CURLE_OK;
-        }
-
-        /// @brief Callback function to write the audio response to the SharedAudioData object
-        static size_t writeBinaryData(void* ptr, size_t size, size_t nmemb, void* stream) {
-            // Get real size
-            size_t realSize = size * nmemb;
-            SharedAudioData* sharedData = static_cast<SharedAudioData*>(stream);
-            sharedData->processData(ptr, realSize);
-            return realSize;
-        }
-
-        /// @brief Callback function to write the response to our Message object
-        static size_t writeStreamData(void* ptr, size_t size, size_t nmemb, void* message) {
-            size_t realsize = size * nmemb;
-            std::string text((char*)ptr, realsize);
-            Chat::Message* msg = static_cast<Chat::Message*>(message);
-            msg->setAIResponse(text);
-            return size * nmemb;
-        }
-
-    private:
-        struct CurlHeadersDeleter {
-            void operator()(curl_slist* headers) {
-                curl_slist_free_all(headers);
-            }
-        };
-
-        std::unique_ptr<curl_slist, CurlHeadersDeleter> createHeaders() {
-            std::unique_ptr<curl_slist, CurlHeadersDeleter> headers(nullptr, CurlHeadersDeleter{});
-            headers.reset(curl_slist_append(headers.release(), std::string{ "Authorization: Bearer " + token_ }.c_str()));
-            headers.reset(curl_slist_append(headers.release(), "Content-Type: application/json"));
-            return headers;
-        }
-
-        CURL* curl_; ///< The curl session
-        CURLcode    res_; ///< The curl result
-        std::string url_; ///< The url to make the request to
-        std::string token_; ///< The token to use for authentication
-        std::mutex  mutex_request_; ///< Mutex to avoid concurrent requests
-    };
-
-    /// @brief Class to handle the OpenAI API
-    class OpenAI {
-    public:
-        /// @brief Construct a new OpenAI object
-        /// @param token The token to use for authentication (optional if set as environment variable (OPENAI_API_KEY)
-        OpenAI(const std::string& token = "")
-            : token_{ token } {
-            if (token.empty()) { // If no token is provided, try to get it from the environment variable
-                char* value = NULL;
-                size_t size = 0;
-                errno_t err = _dupenv_s(&value, &size, "OPENAI_API_KEY");
-                if (!err && value) {
-                    token_ = std::string{ value }; // Set the token from the environment variable
-                    free(value); // Don't forget to free the allocated memory
-                }
-                else { // If the environment variable is not set, log an error
-                    Base::Logger::log("OPENAI_API_KEY environment variable not set", Base::ERR, __FUNCTION__);
-                }
-            }
-            session_.setToken(token_);
-        }
-
-        OpenAI(const OpenAI&) = delete;
-        OpenAI& operator=(const OpenAI&) = delete;
-        OpenAI(OpenAI&&) = delete;
-        OpenAI& operator=(OpenAI&&) = delete;
-
-        bool post(const std::string& suffix, const std::string& data, SharedAudioData* shared_data = nullptr, Chat::Message* msg = nullptr) {
-            auto complete_url = base_url + suffix;
-            session_.setUrl(complete_url);
-            session_.setBody(data);
-            Base::Logger::log("<< request: " + complete_url + "  " + data, Base::DEBUG, __FUNCTION__);
-            if (shared_data) {
-                return session_.makeRequest(shared_data, &Session::writeBinaryData);
-            }
-            else if (msg) {
-                return session_.makeRequest(msg, &Session::writeStreamData);
-            }
-            else {
-                Base::Logger::log("No file path or message provided", Base::ERR, __FUNCTION__);
-                return false;
-            }
-        }
-
-        bool chat(const std::string& input, Chat::Message* message) {
-            bool success = post("chat/completions", input, nullptr, message);
-            if (!success) {
-				Base::Logger::log("Chat request failed", Base::ERR, __FUNCTION__);
-                return false;
-			}
-            return true;
-        }
-
-        bool textToSpeech(const std::string& text, SharedAudioData* shared_data) {
-            shared_data->initOpusDecoder();
-
-            // Prepare the data for the TTS request
-            nlohmann::json data;
-            data["input"] = text; // Set the input text for the TTS request
-            data["model"] = "tts-1-hd"; // Set the model to use for the TTS request
-            data["voice"] = "alloy"; // Set the voice to use for the TTS request
-            data["response_format"] = "opus"; // Set the response format to use for the TTS request
-            data["speed"] = 1.0f; // Set the speed to use for the TTS request (could be setting)
-
-            std::string dataStr = data.dump();
-            bool success = post("audio/speech", dataStr, shared_data);
-            shared_data->signalEndOfData();
-            if (!success) {
-				Base::Logger::log("TTS request failed", Base::ERR, __FUNCTION__);
-				return false;
-			}
-            return true;
-        }
-
-    private:
-        Session session_;
-        std::string token_;
-        std::string organization_;
-        std::string base_url = "https://api.openai.com/v1/";
-    };
-
-
-} // namespace openai
-} // namespace XPlaneChatBot
-#endif // XP_OPENAI_HPP_
+#ifndef XP_OPENAI_HPP_
+#define XP_OPENAI_HPP_
+
+// Required standard libraries
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iterator>
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <chrono>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string_view>
+
+// Thread synchronization libraries
+#include <mutex>
+#include <condition_variable>
+
+// Curl communication libraries
+#include <curl/curl.h>
+#include <nlohmann/json.hpp>
+
+// Audio processing libraries
+#include <ogg/ogg.h>
+#include <opus/opus.h>
+
+// Project headers
+#include "ChatStructures.hpp"
+#include "base/resampler.h"
+#include "base/ringbuffer.h"
+#include "base/cancellation.h"
+#include "base/coroutine.h"
+#include "chatbot/ChatStreamParser.h"
+#include "chatbot/DecodeWorker.h"
+#include "chatbot/HttpEngine.h"
+
+namespace XPlaneChatBot {
+namespace openai {
+    // Define constants for audio settings
+    constexpr int SAMPLE_RATE = 24000; ///< Rate the Opus stream is decoded at (playback runs at the device's native rate)
+    constexpr int CHANNELS = 1;
+    constexpr int FRAMES_PER_BUFFER = 960;
+    constexpr int MAX_BUFFERED_SECONDS = 40; ///< Decoded audio a SharedAudioData can hold (the longest TTS chunk is well under this)
+    constexpr size_t MAX_ENCODED_BYTES = 256 * 1024; ///< Received Ogg Opus not yet decoded (MAX_BUFFERED_SECONDS at up to 48 kbit/s)
+    constexpr size_t LAZY_READ_BYTES = 4 * 1024; ///< Bytes moved from the byte queue to the Ogg state at a time in windowed mode
+
+    /// @brief How much of a stream is decoded ahead of playback
+    struct DecodeWindowConfig {
+        int windowMs{ 0 }; ///< Decoded audio kept ahead of the playback cursor; 0 decodes everything as it arrives
+        bool int16{ false }; ///< Store the decoded window as 16-bit PCM (half the memory, converted back to float on playback)
+    };
+
+    /// @brief Memory held by the audio of one sentence (see SharedAudioData::getMemoryStats)
+    struct AudioMemoryStats {
+        size_t encodedCapacityBytes{ 0 }; ///< Byte queue allocation
+        size_t encodedBufferedBytes{ 0 }; ///< Received and not yet decoded, now
+        size_t encodedPeakBytes{ 0 }; ///< Most bytes queued at once
+        size_t pcmCapacityBytes{ 0 }; ///< Decoded audio ring allocation
+        size_t pcmBufferedBytes{ 0 }; ///< Decoded and not yet played, now
+        size_t pcmPeakBytes{ 0 }; ///< Most decoded bytes buffered at once
+        size_t totalBytes{ 0 }; ///< Allocated for this sentence: both buffers and the decoding scratch
+    };
+
+    /// @brief Audio memory of every SharedAudioData alive in the process (see SharedAudioData::getMemoryTotals)
+    struct AudioMemoryTotals {
+        size_t liveStreams{ 0 };
+        size_t allocatedBytes{ 0 }; ///< Sum of AudioMemoryStats::totalBytes
+        size_t peakAllocatedBytes{ 0 };
+    };
+
+    class SharedAudioData {
+
+    public:
+        /**
+         * @brief Constructor
+         * @param outputRate Rate of the samples handed to the player (decoded audio is resampled from SAMPLE_RATE)
+         * @param quality Resampler quality/latency trade-off
+         * @param window Decode everything as it arrives, or only a window ahead of playback (see DecodeWindowConfig)
+         */
+        explicit SharedAudioData(int outputRate = SAMPLE_RATE, Base::ResamplerQuality quality = Base::ResamplerQuality::Balanced,
+            const DecodeWindowConfig& window = DecodeWindowConfig{})
+            : dataReady(false), outputRate(outputRate), windowSamples(windowSamplesFor(outputRate, window)), int16Window(window.int16),
+              encodedBuffer(MAX_ENCODED_BYTES), resampler(SAMPLE_RATE, outputRate, quality),
+              audioBuffer(int16Window ? 1 : pcmCapacity()), audioBuffer16(int16Window ? pcmCapacity() : 1),
+              opusDecoder(nullptr), opusError(OPUS_OK), oggInitialized(false), serial_number(-1) {
+            resampled.resize(resampler.maxOutput(FRAMES_PER_BUFFER * CHANNELS)); // Largest decoded packet
+            if (int16Window) {
+                resampled16.resize(resampled.size());
+            }
+            // Initialize the Ogg sync state
+            ogg_sync_init(&oy);
+            accountAllocation(static_cast<long long>(getMemoryStats().totalBytes));
+        }
+
+        // Destructor
+        ~SharedAudioData() {
+            accountAllocation(-static_cast<long long>(getMemoryStats().totalBytes));
+            if (opusDecoder) {
+                opus_decoder_destroy(opusDecoder);
+                opusDecoder = nullptr;
+            }
+            if (oggInitialized) {
+                ogg_stream_clear(&os);
+                ogg_sync_clear(&oy);
+                oggInitialized = false;
+            }
+        }
+
+        // Initialize the Ogg stream state; should be called when a new stream is detected
+        void initOggStream(int serial) {
+            if (ogg_stream_init(&os, serial) != 0) {
+                throw std::runtime_error("Failed to initialize Ogg stream state.");
+            }
+            serial_number = serial;
+            oggInitialized = true;
+        }
+
+        // Reset the Ogg stream state; should be called for a new logical stream
+        void resetStreamAndDecoder() {
+            if (oggInitialized) {
+                ogg_stream_clear(&os);
+                ogg_sync_clear(&oy);
+                oggInitialized = false;
+            }
+            if (opusDecoder) {
+                opus_decoder_destroy(opusDecoder);
+                opusDecoder = nullptr;
+                initOpusDecoder();  // Re-initialize the Opus decoder for the next playback
+            }
+            else {
+                initOpusDecoder();
+            }
+            serial_number = -1;  // Reset serial number for the new stream
+            preSkipRemaining = 0;
+        }
+
+
+        void initOpusDecoder() {
+            if (!opusDecoder) {
+                opusDecoder = opus_decoder_create(SAMPLE_RATE, CHANNELS, &opusError);
+                if (opusError != OPUS_OK) {
+                    throw std::runtime_error("Failed to create Opus decoder: " + std::string(opus_strerror(opusError)));
+                }
+            }
+        }
+
+        /**
+         * @brief (Network thread) Queue received Ogg Opus bytes for the decode worker; one copy, no lock
+         * @return False if the byte queue is full (the decoder is not keeping up), the request should be aborted
+         */
+        bool pushEncoded(const char* ptr, size_t size) {
+            if (cancelled) {
+                return true; // Dropped, the stream is over anyway
+            }
+            if (encodedBuffer.write(ptr, size) < size) {
+                Base::Logger::log("TTS byte queue full, the decoder is not keeping up", Base::ERR, __FUNCTION__);
+                return false;
+            }
+            updatePeak(encodedPeak, encodedBuffer.size());
+            return true;
+        }
+
+        /// @brief (Network thread) The download is complete; end of data is signalled once the queued bytes are decoded
+        void finishInput() {
+            completedNs = nowNs();
+            inputComplete = true;
+        }
+
+        /**
+         * @brief (Decode worker) Decode what has been queued by pushEncoded, up to the window in windowed mode
+         * @param bytes Receives the number of bytes consumed (optional)
+         * @return Samples decoded, at SAMPLE_RATE
+         */
+        size_t decodePending(size_t* bytes = nullptr) {
+            const bool complete = inputComplete; // Before draining: the last bytes are queued before the input is finished
+            if (cancelled) {
+                encodedBuffer.discard();
+                return 0;
+            }
+            size_t consumed = 0;
+            size_t decoded = decodeBuffered(); // Packets held back when the window was last full
+            while (!windowFull()) {
+                // Straight from the byte queue into the Ogg sync buffer; in windowed mode the rest stays compressed
+                const size_t queued = encodedBuffer.size();
+                const size_t wanted = windowSamples > 0 ? std::min(queued, LAZY_READ_BYTES) : queued;
+                if (wanted == 0) {
+                    break;
+                }
+                char* buffer = ogg_sync_buffer(&oy, static_cast<long>(wanted));
+                const size_t read = encodedBuffer.read(buffer, wanted);
+                consumed += read;
+                decoded += decodeSynced(read);
+            }
+            if (bytes) {
+                *bytes = consumed;
+            }
+            if (complete && !hasUndecodedData() && !endOfData) {
+                signalEndOfData();
+            }
+            return decoded;
+        }
+
+        /// @brief (Decode worker) True while received audio is left to decode (held back by the window, or just arrived)
+        bool hasUndecodedData() const { return !cancelled && (!encodedBuffer.empty() || !oggDrained); }
+
+        /// @brief (Decoding thread) Decode a chunk of the Ogg Opus stream directly, bypassing the byte queue
+        void processData(const void* ptr, size_t size) {
+            if (cancelled) {
+                return; // Not worth decoding any more
+            }
+            // Buffer to store the incoming Ogg data
+            char* buffer = ogg_sync_buffer(&oy, static_cast<long>(size));
+            memcpy(buffer, ptr, size);
+            decodeSynced(size);
+        }
+
+        /// @brief (Decoding thread) Resample and queue decoded samples; one bulk copy, no lock
+        void addData(const float* data, size_t size) {
+            // Convert to the device rate here, on the decoding thread, so the audio callback only copies
+            if (!resampler.isPassthrough()) {
+                const size_t needed = resampler.maxOutput(size);
+                if (resampled.size() < needed) {
+                    resampled.resize(needed);
+                    resampled16.resize(int16Window ? needed : 0);
+                }
+                size = resampler.process(data, size, resampled.data());
+                data = resampled.data();
+            }
+            size_t written = 0;
+            if (int16Window) {
+                for (size_t i = 0; i < size; ++i) {
+                    resampled16[i] = static_cast<int16_t>(std::clamp(data[i], -1.0f, 1.0f) * 32767.0f);
+                }
+                written = audioBuffer16.write(resampled16.data(), size);
+            }
+            else {
+                written = audioBuffer.write(data, size);
+            }
+            updatePeak(pcmPeak, bufferedSamples());
+            if (written < size) {
+                if (droppedSamples.load(std::memory_order_relaxed) == 0) {
+                    Base::Logger::log("TTS audio buffer full, dropping samples", Base::WARN, __FUNCTION__);
+                }
+                droppedSamples.fetch_add(size - written, std::memory_order_relaxed);
+            }
+        }
+
+        /// @brief (Audio callback) Copy up to framesPerBuffer samples out; wait-free
+        size_t getData(float* output, size_t framesPerBuffer) {
+            if (cancelled) {
+                audioBuffer.discard();
+                audioBuffer16.discard();
+                return 0;
+            }
+            if (!int16Window) {
+                return audioBuffer.read(output, framesPerBuffer); // Number of frames read
+            }
+            int16_t block[256];
+            size_t read = 0;
+            while (read < framesPerBuffer) {
+                const size_t n = audioBuffer16.read(block, std::min(framesPerBuffer - read, std::size(block)));
+                for (size_t i = 0; i < n; ++i) {
+                    output[read + i] = static_cast<float>(block[i]) / 32768.0f;
+                }
+                read += n;
+                if (n < std::size(block)) {
+                    break;
+                }
+            }
+            return read;
+        }
+
+        // Getters
+        bool isDataReady() const { return dataReady; }
+        bool isEndOfData() const { return endOfData; }
+        bool isCancelled() const { return cancelled; }
+        size_t bufferedSamples() const { return int16Window ? audioBuffer16.size() : audioBuffer.size(); } ///< Decoded and not yet played, at the output rate
+        size_t pendingEncodedBytes() const { return encodedBuffer.size(); } ///< Received and not yet decoded
+        int getOutputRate() const { return outputRate; }
+        bool isWindowed() const { return windowSamples > 0; }
+
+        /// @brief What this sentence's audio holds now and at most (any thread, snapshot)
+        AudioMemoryStats getMemoryStats() const {
+            const size_t sampleBytes = int16Window ? sizeof(int16_t) : sizeof(float);
+            AudioMemoryStats stats;
+            stats.encodedCapacityBytes = encodedBuffer.capacity();
+            stats.encodedBufferedBytes = encodedBuffer.size();
+            stats.encodedPeakBytes = encodedPeak.load(std::memory_order_relaxed);
+            stats.pcmCapacityBytes = audioBuffer.capacity() * sizeof(float) + audioBuffer16.capacity() * sizeof(int16_t);
+            stats.pcmBufferedBytes = bufferedSamples() * sampleBytes;
+            stats.pcmPeakBytes = pcmPeak.load(std::memory_order_relaxed) * sampleBytes;
+            stats.totalBytes = stats.encodedCapacityBytes + stats.pcmCapacityBytes
+                + resampled.capacity() * sizeof(float) + resampled16.capacity() * sizeof(int16_t);
+            return stats;
+        }
+
+        /// @brief Audio memory allocated by all the SharedAudioData alive (any thread)
+        static AudioMemoryTotals getMemoryTotals() {
+            AudioMemoryTotals totals;
+            totals.liveStreams = static_cast<size_t>(liveStreams.load());
+            totals.allocatedBytes = static_cast<size_t>(allocatedBytes.load());
+            totals.peakAllocatedBytes = static_cast<size_t>(peakAllocatedBytes.load());
+            return totals;
+        }
+        size_t getDroppedSamples() const { return droppedSamples.load(std::memory_order_relaxed); } ///< Lost to a full buffer
+
+        // Setters
+        void setDataReady(bool ready) { dataReady = ready; }
+        void signalEndOfData() {
+            long long notCompleted = 0;
+            completedNs.compare_exchange_strong(notCompleted, nowNs()); // Keep the download end if finishInput() set it
+            endOfData = true;
+        }
+
+        /// @brief Drop the buffered audio and end the stream; playback stops within one buffer (any thread)
+        void cancel() {
+            cancelled = true; // The consumer discards the buffer, the ring only has one reader
+            signalEndOfData();
+        }
+
+        // Request timeline (steady clock), written by the network and decoding threads and read by the scheduler/player
+        void markRequested() { requestedNs = nowNs(); }
+        bool hasFirstAudio() const { return firstAudioNs.load() != 0; }
+        std::chrono::steady_clock::time_point requestedAt() const { return toTimePoint(requestedNs.load()); }
+        std::chrono::steady_clock::time_point firstAudioAt() const { return toTimePoint(firstAudioNs.load()); } ///< First decoded samples
+        std::chrono::steady_clock::time_point completedAt() const { return toTimePoint(completedNs.load()); } ///< Download finished
+    private:
+        /// @brief Account the bytes just written into the sync buffer and decode what they complete
+        size_t decodeSynced(size_t size) {
+            ogg_sync_wrote(&oy, static_cast<long>(size));
+            oggDrained = false;
+            return decodeBuffered();
+        }
+
+        /// @brief Decode the pages and packets held by the Ogg state, stopping early once the window is full
+        size_t decodeBuffered() {
+            size_t decoded = 0;
+            while (true) {
+                // Packets of the pages already read first, so at most one page is held back
+                while (oggInitialized && !windowFull() && ogg_stream_packetout(&os, &op) == 1) {
+                    decoded += decodePacket();
+                }
+                if (windowFull()) {
+                    return decoded;
+                }
+                if (ogg_sync_pageout(&oy, &og) != 1) {
+                    oggDrained = true;
+                    return decoded;
+                }
+                if (!oggInitialized || serial_number == -1) {
+                    serial_number = ogg_page_serialno(&og);
+                    initOggStream(serial_number);
+                }
+                if (ogg_stream_pagein(&os, &og) != 0) {
+                    Base::Logger::log("Failed to read Ogg page into stream.", Base::ERR, __FUNCTION__);
+                }
+            }
+        }
+
+        /// @brief Parse or decode the packet in op, returns the samples queued
+        size_t decodePacket() {
+            // Check for header packets
+            if (op.bytes >= 19 && strncmp(reinterpret_cast<char*>(op.packet), "OpusHead", 8) == 0) {
+                Base::Logger::log("OpusHead header found.", Base::DEBUG, __FUNCTION__);
+                // The OpusHead header format:
+                // - "OpusHead" (8 bytes)
+                // - Version number (1 byte)
+                // - Channel count (1 byte)
+                // - Pre-skip (2 bytes)
+                // - Sample rate (4 bytes)
+                // - Output gain (2 bytes)
+                // - Channel mapping (1 byte)
+                unsigned char version = op.packet[8];
+                unsigned char channel_count = op.packet[9];
+                unsigned short pre_skip = *reinterpret_cast<unsigned short*>(op.packet + 10);
+                unsigned int sample_rate = *reinterpret_cast<unsigned int*>(op.packet + 12);
+                short output_gain = *reinterpret_cast<short*>(op.packet + 16);
+                unsigned char channel_mapping = op.packet[18];
+
+                Base::Logger::log("Version number: " + std::to_string(static_cast<unsigned int>(version)), Base::DEBUG, __FUNCTION__);
+                Base::Logger::log("Channel count: " + std::to_string(static_cast<unsigned int>(channel_count)), Base::DEBUG, __FUNCTION__);
+                Base::Logger::log("Pre-skip: " + std::to_string(pre_skip), Base::DEBUG, __FUNCTION__);
+                Base::Logger::log("Sample rate: " + std::to_string(sample_rate), Base::DEBUG, __FUNCTION__);
+                Base::Logger::log("Output gain: " + std::to_string(output_gain), Base::DEBUG, __FUNCTION__);
+                Base::Logger::log("Channel mapping: " + std::to_string(static_cast<unsigned int>(channel_mapping)), Base::DEBUG, __FUNCTION__);
+
+                // Pre-skip is counted at 48 kHz whatever the decoding rate; those samples are encoder priming, not speech
+                preSkipRemaining = static_cast<size_t>(pre_skip) * SAMPLE_RATE / 48000;
+
+                return 0; // Skip decoding the header packet
+            }
+
+            if (op.bytes >= 16 && strncmp(reinterpret_cast<char*>(op.packet), "OpusTags", 8) == 0) {
+                Base::Logger::log("OpusTags header found.", Base::DEBUG, __FUNCTION__);
+                // The OpusTags header format:
+                // - "OpusTags" (8 bytes)
+                // - Vendor string length (4 bytes)
+                // - Vendor string (variable length)
+                unsigned int vendor_length = *reinterpret_cast<unsigned int*>(op.packet + 8);
+                std::string vendor_string(reinterpret_cast<char*>(op.packet + 12), vendor_length);
+
+                Base::Logger::log("Vendor string: " + vendor_string, Base::DEBUG, __FUNCTION__);
+                // You might want to include more processing here to read comments
+                return 0; // Skip decoding the tag packet
+            }
+
+
+            // Decode the Opus packet
+            float decodedPCM[FRAMES_PER_BUFFER * CHANNELS];
+            int frameSize = opus_decode_float(opusDecoder, op.packet, op.bytes, decodedPCM, FRAMES_PER_BUFFER, 0);
+            if (frameSize < 0) {
+                Base::Logger::log("Opus decoding error: " + std::string(opus_strerror(frameSize)), Base::ERR, __FUNCTION__);
+                return 0;
+            }
+
+            const size_t skipped = std::min(preSkipRemaining, static_cast<size_t>(frameSize));
+            preSkipRemaining -= skipped;
+            if (skipped == static_cast<size_t>(frameSize)) {
+                return 0;
+            }
+            addData(decodedPCM + skipped * CHANNELS, (frameSize - skipped) * CHANNELS);
+            if (firstAudioNs.load() == 0) {
+                firstAudioNs = nowNs();
+            }
+            dataReady = true;
+            return frameSize - skipped;
+        }
+
+        /// @brief True while the decoded window holds enough audio (never in eager mode)
+        bool windowFull() const { return windowSamples > 0 && bufferedSamples() >= windowSamples; }
+
+        static size_t windowSamplesFor(int outputRate, const DecodeWindowConfig& window) {
+            return static_cast<size_t>(std::max(window.windowMs, 0)) * static_cast<size_t>(outputRate) / 1000 * CHANNELS;
+        }
+
+        /// @brief Decoded audio ring size: the window plus one packet (it is only topped up below the window)
+        size_t pcmCapacity() const {
+            if (windowSamples == 0) {
+                return static_cast<size_t>(outputRate) * MAX_BUFFERED_SECONDS;
+            }
+            return windowSamples + resampler.maxOutput(FRAMES_PER_BUFFER * CHANNELS);
+        }
+
+        static void updatePeak(std::atomic<size_t>& peak, size_t value) {
+            size_t current = peak.load(std::memory_order_relaxed);
+            while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+            }
+        }
+
+        static void accountAllocation(long long bytes) {
+            liveStreams.fetch_add(bytes >= 0 ? 1 : -1);
+            const long long allocated = allocatedBytes.fetch_add(bytes) + bytes;
+            long long peak = peakAllocatedBytes.load();
+            while (allocated > peak && !peakAllocatedBytes.compare_exchange_weak(peak, allocated)) {
+            }
+        }
+
+        static long long nowNs() {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+        static std::chrono::steady_clock::time_point toTimePoint(long long ns) {
+            return std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(ns)));
+        }
+
+        std::atomic<long long> requestedNs{ 0 };
+        std::atomic<long long> firstAudioNs{ 0 }; ///< 0 until the first packet is decoded
+        std::atomic<long long> completedNs{ 0 };
+
+        std::atomic<bool> dataReady{ false };
+        std::atomic<bool> endOfData{ false };
+        std::atomic<bool> cancelled{ false };
+        std::atomic<bool> inputComplete{ false }; ///< Set by finishInput()
+        const int outputRate;
+        const size_t windowSamples; ///< Decode-ahead target in windowed mode, 0 in eager mode
+        const bool int16Window; ///< Decoded audio is kept in audioBuffer16 instead of audioBuffer
+        Base::SpscRingBuffer<char> encodedBuffer; ///< Network thread -> decode worker, preallocated
+        bool oggDrained{ true }; ///< The Ogg state holds no page or packet left to decode (decoding thread)
+        std::atomic<size_t> encodedPeak{ 0 };
+        std::atomic<size_t> pcmPeak{ 0 }; ///< In samples
+        Base::PolyphaseResampler resampler; ///< SAMPLE_RATE to the player's rate
+        Base::SpscRingBuffer<float> audioBuffer; ///< Decoding thread -> audio callback, preallocated
+        Base::SpscRingBuffer<int16_t> audioBuffer16; ///< Same in 16-bit mode (only one of the two is sized)
+        std::atomic<size_t> droppedSamples{ 0 };
+        std::vector<float> resampled;       ///< Output of the resampler, reused between packets
+        std::vector<int16_t> resampled16;   ///< Its 16-bit conversion in 16-bit mode
+
+        ogg_sync_state oy;          // Ogg sync state, for syncing with the Ogg stream
+        ogg_stream_state os;        // Ogg stream state, for handling logical streams
+        ogg_page og;                // Ogg page, a single unit of data in an Ogg stream
+        ogg_packet op;              // Ogg packet, contains encoded Opus data
+        OpusDecoder* opusDecoder;   // Opus decoder state
+        int opusError;              // Error code returned by Opus functions
+        bool oggInitialized;        // Flag to track if Ogg and Opus have been initialized
+        int serial_number;          // Serial number for the Ogg stream
+        size_t preSkipRemaining{ 0 }; // Decoded samples (per channel) still to drop at the start of the stream
+
+        static inline std::atomic<long long> liveStreams{ 0 };
+        static inline std::atomic<long long> allocatedBytes{ 0 };
+        static inline std::atomic<long long> peakAllocatedBytes{ 0 };
+    };
+
+
+    /**
+    * @brief Class to handle the curl session
+    *
+    * Requests run on the HttpEngine thread (curl_multi), on handles borrowed from the HttpConnectionPool, so
+    * connections are kept alive across requests and across Session objects.
+    */
+    class Session {
+    public:
+        Session() = default;
+
+        /// @brief Set the url to make the request to
+        void setUrl(const std::string& url) { url_ = url; }
+
+        /// @brief Set the token to use for authentication
+        void setToken(const std::string& token) {
+            token_ = token;
+        }
+
+        /// @brief Set the body of the request to send
+        void setBody(const std::string& data) { body_ = data; }
+
+        /// @brief Perform the request set up by setUrl/setBody, blocking until it completes or cancelToken is cancelled
+        template <typename Data>
+        bool makeRequest(Data* data, size_t(*writeFunc)(void*, size_t, size_t, void*), std::shared_ptr<Base::CancellationToken> cancelToken = nullptr) {
+            std::lock_guard<std::mutex> lock(mutex_request_);
+            HttpRequest request = createRequest(url_, body_);
+            request.cancelToken = std::move(cancelToken);
+            request.onData = [data, writeFunc](const char* ptr, size_t size) {
+                return writeFunc(const_cast<char*>(ptr), 1, size, data) == size;
+            };
+            return HttpEngine::instance().submitAsync(std::move(request)).get().ok;
+        }
+
+        /// @brief Request with the session's authentication headers, for HttpEngine::submit
+        HttpRequest createRequest(const std::string& url, std::string body) const {
+            HttpRequest request;
+            request.url = url;
+            request.body = std::move(body);
+            request.headers = { "Authorization: Bearer " + token_, "Content-Type: application/json" };
+            return request;
+        }
+
+        /// @brief Callback function to queue the audio response for the decode worker (see DecodeWorker.h)
+        static size_t writeBinaryData(void* ptr, size_t size, size_t nmemb, void* stream) {
+            // Get real size
+            size_t realSize = size * nmemb;
+            SharedAudioData* sharedData = static_cast<SharedAudioData*>(stream);
+            if (!sharedData->pushEncoded(static_cast<const char*>(ptr), realSize)) {
+                return 0; // Aborts the transfer
+            }
+            DecodeWorker::instance().notify();
+            return realSize;
+        }
+
+        /// @brief Callback function to write the response to our Message object
+        static size_t writeStreamData(void* ptr, size_t size, size_t nmemb, void* message) {
+            size_t realsize = size * nmemb;
+            Chat::Message* msg = static_cast<Chat::Message*>(message);
+            msg->setAIResponse(std::string_view(static_cast<const char*>(ptr), realsize)); // Parsed in place, no copy
+            return realsize;
+        }
+
+    private:
+        std::string url_; ///< The url to make the request to
+        std::string body_; ///< Body of the request
+        std::string token_; ///< The token to use for authentication
+        std::mutex  mutex_request_; ///< Mutex to avoid concurrent requests
+    };
+
+    /// @brief Class to handle the OpenAI API
+    class OpenAI {
+    public:
+        /// @brief Construct a new OpenAI object
+        /// @param token The token to use for authentication (optional if set as environment variable (OPENAI_API_KEY)
+        OpenAI(const std::string& token = "")
+            : token_{ token } {
+            if (token.empty()) { // If no token is provided, try to get it from the environment variable
+                char* value = NULL;
+                size_t size = 0;
+                errno_t err = _dupenv_s(&value, &size, "OPENAI_API_KEY");
+                if (!err && value) {
+                    token_ = std::string{ value }; // Set the token from the environment variable
+                    free(value); // Don't forget to free the allocated memory
+                }
+                else { // If the environment variable is not set, log an error
+                    Base::Logger::log("OPENAI_API_KEY environment variable not set", Base::ERR, __FUNCTION__);
+                }
+            }
+            session_.setToken(token_);
+        }
+
+        OpenAI(const OpenAI&) = delete;
+        OpenAI& operator=(const OpenAI&) = delete;
+        OpenAI(OpenAI&&) = delete;
+        OpenAI& operator=(OpenAI&&) = delete;
+
+        bool post(const std::string& suffix, const std::string& data, SharedAudioData* shared_data = nullptr, Chat::Message* msg = nullptr,
+            std::shared_ptr<Base::CancellationToken> cancelToken = nullptr) {
+            auto complete_url = base_url + suffix;
+            session_.setUrl(complete_url);
+            session_.setBody(data);
+            Base::Logger::log("<< request: " + complete_url + "  " + data, Base::DEBUG, __FUNCTION__);
+            if (shared_data) {
+                return session_.makeRequest(shared_data, &Session::writeBinaryData, std::move(cancelToken));
+            }
+            else if (msg) {
+                return session_.makeRequest(msg, &Session::writeStreamData, std::move(cancelToken));
+            }
+            else {
+                Base::Logger::log("No file path or message provided", Base::ERR, __FUNCTION__);
+                return false;
+            }
+        }
+
+        bool chat(const std::string& input, Chat::Message* message, std::shared_ptr<Base::CancellationToken> cancelToken = nullptr) {
+            bool success = post("chat/completions", input, nullptr, message, cancelToken);
+            if (!success && !Base::isCancelled(cancelToken)) {
+				Base::Logger::log("Chat request failed", Base::ERR, __FUNCTION__);
+                return false;
+			}
+            return true;
+        }
+
+        /// @brief Download the speech of text, blocking; the audio is decoded by the DecodeWorker as it arrives
+        bool textToSpeech(const std::string& text, std::shared_ptr<SharedAudioData> shared_data, std::shared_ptr<Base::CancellationToken> cancelToken = nullptr) {
+            shared_data->initOpusDecoder();
+            shared_data->markRequested();
+            DecodeWorker::instance().add(shared_data);
+            bool success = post("audio/speech", speechPayload(text), shared_data.get(), nullptr, cancelToken);
+            if (Base::isCancelled(cancelToken)) {
+                shared_data->cancel();
+                return false;
+            }
+            shared_data->finishInput();
+            DecodeWorker::instance().notify();
+            if (!success) {
+				Base::Logger::log("TTS request failed", Base::ERR, __FUNCTION__);
+				return false;
+			}
+            return true;
+        }
+
+        /**
+         * @brief Start a TTS request on the HttpEngine without blocking
+         * @param text Text to synthesize
+         * @param shared_data Receives the audio, decoded by the DecodeWorker (kept alive until it is decoded)
+         * @param onComplete Called on the engine thread once the download is over (decoding may still be going on)
+         * @param cancelToken Aborts the request and cancels shared_data (optional)
+         * @return Id of the request, for HttpEngine::cancel
+         */
+        HttpEngine::RequestId textToSpeechAsync(const std::string& text, std::shared_ptr<SharedAudioData> shared_data, std::function<void(bool)> onComplete,
+            std::shared_ptr<Base::CancellationToken> cancelToken = nullptr) {
+            shared_data->initOpusDecoder();
+            HttpRequest request = session_.createRequest(base_url + "audio/speech", speechPayload(text));
+            request.cancelToken = std::move(cancelToken);
+            // Only a copy here: Ogg sync, Opus decoding and resampling run on the decode worker, off the socket reads
+            request.onData = [audio = shared_data.get()](const char* ptr, size_t size) {
+                if (!audio->pushEncoded(ptr, size)) {
+                    return false;
+                }
+                DecodeWorker::instance().notify();
+                return true;
+            };
+            request.onComplete = [shared_data, onComplete = std::move(onComplete)](const HttpResult& result) {
+                if (result.cancelled) {
+                    shared_data->cancel();
+                }
+                else {
+                    shared_data->finishInput(); // End of data follows once the worker has decoded the rest
+                }
+                DecodeWorker::instance().notify(); // Also lets the worker drop a cancelled stream
+                if (!result.ok && !result.cancelled) {
+                    Base::Logger::log("TTS request failed", Base::ERR, __FUNCTION__);
+                }
+                if (onComplete) {
+                    onComplete(result.ok);
+                }
+            };
+            shared_data->markRequested();
+            DecodeWorker::instance().add(shared_data);
+            return HttpEngine::instance().submit(std::move(request));
+        }
+
+        /// @brief Chunks of a streamed response, consumed with co_await stream->next()
+        using ChunkStream = std::shared_ptr<Base::AsyncChannel<std::string>>;
+
+        /**
+         * @brief Stream a chat completion without blocking
+         *
+         * @code
+         * auto stream = openAI.chatStream(payload, executor);
+         * while (std::optional<std::string> delta = co_await stream->next()) { ... }
+         * @endcode
+         *
+         * @param input JSON body of the chat/completions request (with "stream": true)
+         * @param executor Executor the consuming coroutine is resumed on
+         * @param id Receives the request id, for HttpEngine::cancel (optional)
+         * @param cancelToken Aborts the request (optional)
+         * @return Channel of content deltas; closed when the completion finishes, fails or is cancelled
+         */
+        ChunkStream chatStream(const std::string& input, Base::Executor& executor, HttpEngine::RequestId* id = nullptr,
+            std::shared_ptr<Base::CancellationToken> cancelToken = nullptr) {
+            auto stream = std::make_shared<Base::AsyncChannel<std::string>>(executor);
+            auto parser = std::make_shared<Chat::ChatStreamParser>();
+            HttpRequest request = session_.createRequest(base_url + "chat/completions", input);
+            request.cancelToken = std::move(cancelToken);
+            request.onData = [stream, parser](const char* ptr, size_t size) {
+                parser->feed(std::string_view(ptr, size), [&stream](std::string_view delta) { stream->push(std::string(delta)); });
+                return true;
+            };
+            request.onComplete = [stream](const HttpResult& result) {
+                if (!result.ok && !result.cancelled) {
+                    Base::Logger::log("Chat request failed", Base::ERR, __FUNCTION__);
+                }
+                stream->close();
+            };
+            const HttpEngine::RequestId requestId = HttpEngine::instance().submit(std::move(request));
+            if (id) {
+                *id = requestId;
+            }
+            return stream;
+        }
+
+        /**
+         * @brief Stream the Ogg Opus audio of a TTS request without blocking
+         *
+         * The chunks are the encoded bytes as received; feed them to SharedAudioData::processData on the consuming
+         * executor, which keeps decoding off the HTTP thread (textToSpeechAsync uses the DecodeWorker instead).
+         *
+         * @param text Text to synthesize
+         * @param executor Executor the consuming coroutine is resumed on
+         * @param id Receives the request id, for HttpEngine::cancel (optional)
+         * @param cancelToken Aborts the request (optional)
+         * @return Channel of audio chunks; closed when the download finishes, fails or is cancelled
+         */
+        ChunkStream speech(const std::string& text, Base::Executor& executor, HttpEngine::RequestId* id = nullptr,
+            std::shared_ptr<Base::CancellationToken> cancelToken = nullptr) {
+            auto stream = std::make_shared<Base::AsyncChannel<std::string>>(executor);
+            HttpRequest request = session_.createRequest(base_url + "audio/speech", speechPayload(text));
+            request.cancelToken = std::move(cancelToken);
+            request.onData = [stream](const char* ptr, size_t size) {
+                stream->push(std::string(ptr, size));
+                return true;
+            };
+            request.onComplete = [stream](const HttpResult& result) {
+                if (!result.ok && !result.cancelled) {
+                    Base::Logger::log("TTS request failed", Base::ERR, __FUNCTION__);
+                }
+                stream->close();
+            };
+            const HttpEngine::RequestId requestId = HttpEngine::instance().submit(std::move(request));
+            if (id) {
+                *id = requestId;
+            }
+            return stream;
+        }
+
+    private:
+        /// @brief Body of a TTS request
+        static std::string speechPayload(const std::string& text) {
+            nlohmann::json data;
+            data["input"] = text; // Set the input text for the TTS request
+            data["model"] = "tts-1-hd"; // Set the model to use for the TTS request
+            data["voice"] = "alloy"; // Set the voice to use for the TTS request
+            data["response_format"] = "opus"; // Set the response format to use for the TTS request
+            data["speed"] = 1.0f; // Set the speed to use for the TTS request (could be setting)
+            return data.dump();
+        }
+
+        Session session_;
+        std::string token_;
+        std::string organization_;
+        std::string base_url = "https://api.openai.com/v1/";
+    };
+
+
+} // namespace openai
+} // namespace XPlaneChatBot
+#endif // XP_OPENAI_HPP_
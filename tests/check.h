@@ -0,0 +1,48 @@
+/**
+ * @file check.h
+ * @author lc
+ * @brief Minimal assertion helpers shared by the unit tests
+ *
+ * Each test is a plain executable registered with CTest: failed checks are printed and counted, and main()
+ * returns the result of Tests::report().
+ *
+ * @version 0.1
+ * @date 2024-07-01
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#ifndef XPROTECTION_TESTS_CHECK_H
+#define XPROTECTION_TESTS_CHECK_H
+
+#include <cstdio>
+
+namespace XPlaneChatBot {
+namespace Tests {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+inline void fail(const char* expression, const char* file, int line) {
+    std::fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+    ++failures();
+}
+
+/// @brief Print the outcome and return the exit code of the test
+inline int report(const char* name) {
+    if (failures() > 0) {
+        std::fprintf(stderr, "%s: %d check(s) failed\n", name, failures());
+        return 1;
+    }
+    std::printf("%s: passed\n", name);
+    return 0;
+}
+
+} // namespace Tests
+} // namespace XPlaneChatBot
+
+#define CHECK(expression) ((expression) ? void(0) : ::XPlaneChatBot::Tests::fail(#expression, __FILE__, __LINE__))
+
+#endif // XPROTECTION_TESTS_CHECK_H
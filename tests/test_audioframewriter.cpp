@@ -0,0 +1,87 @@
+/**
+ * @file test_audioframewriter.cpp
+ * @author zah
+ * @brief Wire format and buffer reuse of the websocket audio frame writer
+ *
+ * @version 0.1
+ * @date 2024-07-01
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "check.h"
+
+#include "chatbot/AudioFrameWriter.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace XPlaneChatBot;
+
+namespace {
+    constexpr size_t kChunkSamples = 800; // 50 ms at 16 kHz
+
+    std::vector<int16_t> testSamples(size_t count) {
+        std::vector<int16_t> samples(count);
+        for (size_t i = 0; i < count; ++i) {
+            samples[i] = static_cast<int16_t>(i * 97 - 32768);
+        }
+        return samples;
+    }
+}
+
+int main() {
+    const std::vector<int16_t> samples = testSamples(kChunkSamples);
+
+    // Text frames wrap the base64 PCM in {"audio_data":"..."}
+    {
+        Chat::AudioFrameWriter writer(Chat::AudioFrameMode::Base64Json, kChunkSamples);
+        CHECK(!writer.isBinary());
+        for (size_t count : { size_t(0), size_t(1), size_t(2), size_t(3), size_t(160), kChunkSamples }) {
+            Chat::FramePool::Frame frame = writer.write(samples.data(), count);
+            const std::string& text = *frame;
+            CHECK(text.size() == writer.frameSize(count));
+            CHECK(text.rfind("{\"audio_data\":\"", 0) == 0);
+            CHECK(text.size() >= 2 && text.compare(text.size() - 2, 2, "\"}") == 0);
+
+            const std::string payload = text.substr(15, text.size() - 17);
+            std::vector<char> decoded;
+            CHECK(Base::base64_decode_into(payload.data(), payload.size(), decoded));
+            CHECK(decoded.size() == count * sizeof(int16_t));
+            CHECK(count == 0 || std::memcmp(decoded.data(), samples.data(), decoded.size()) == 0);
+        }
+        CHECK(writer.poolMisses() == 0);
+    }
+
+    // Binary frames are the raw samples
+    {
+        Chat::AudioFrameWriter writer(Chat::AudioFrameMode::BinaryPcm, kChunkSamples);
+        CHECK(writer.isBinary());
+        Chat::FramePool::Frame frame = writer.write(samples.data(), kChunkSamples);
+        CHECK(frame->size() == kChunkSamples * sizeof(int16_t));
+        CHECK(std::memcmp(frame->data(), samples.data(), frame->size()) == 0);
+    }
+
+    // Released buffers are handed out again without reallocating; the pool only allocates past its size
+    {
+        Chat::AudioFrameWriter writer(Chat::AudioFrameMode::Base64Json, kChunkSamples);
+        const char* storage = nullptr;
+        {
+            Chat::FramePool::Frame frame = writer.write(samples.data(), kChunkSamples);
+            storage = frame->data();
+        }
+        Chat::FramePool::Frame again = writer.write(samples.data(), kChunkSamples);
+        CHECK(again->data() == storage);
+        again.reset();
+
+        std::vector<Chat::FramePool::Frame> inFlight;
+        for (int i = 0; i < 4; ++i) {
+            inFlight.push_back(writer.write(samples.data(), kChunkSamples));
+        }
+        CHECK(writer.poolMisses() == 0);
+        inFlight.push_back(writer.write(samples.data(), kChunkSamples));
+        CHECK(writer.poolMisses() == 1);
+    }
+
+    return Tests::report("test_audioframewriter");
+}
@@ -0,0 +1,106 @@
+/**
+ * @file test_base64.cpp
+ * @author lc
+ * @brief The vectorized base64 encoder against a scalar reference, and decoder round trips
+ *
+ * Lengths up to a few blocks cover the SIMD loops together with every scalar tail.
+ *
+ * @version 0.1
+ * @date 2024-07-01
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "check.h"
+
+#include "base/base64.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace XPlaneChatBot;
+
+namespace {
+    /// @brief Textbook encoder the optimized one must match byte for byte
+    std::string referenceEncode(const std::vector<uint8_t>& data) {
+        static const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string out;
+        size_t i = 0;
+        for (; i + 3 <= data.size(); i += 3) {
+            const uint32_t triplet = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+            out += chars[(triplet >> 18) & 63];
+            out += chars[(triplet >> 12) & 63];
+            out += chars[(triplet >> 6) & 63];
+            out += chars[triplet & 63];
+        }
+        if (i < data.size()) {
+            const uint32_t triplet = (data[i] << 16) | (i + 1 < data.size() ? data[i + 1] << 8 : 0);
+            out += chars[(triplet >> 18) & 63];
+            out += chars[(triplet >> 12) & 63];
+            out += i + 1 < data.size() ? chars[(triplet >> 6) & 63] : '=';
+            out += '=';
+        }
+        return out;
+    }
+
+    std::vector<uint8_t> randomBytes(std::mt19937& random, size_t count) {
+        std::uniform_int_distribution<int> byte(0, 255);
+        std::vector<uint8_t> data(count);
+        for (uint8_t& value : data) {
+            value = static_cast<uint8_t>(byte(random));
+        }
+        return data;
+    }
+
+    void checkRoundTrip(const std::vector<uint8_t>& data) {
+        const std::string expected = referenceEncode(data);
+
+        std::string encoded(Base::base64_encoded_length(data.size()), '\0');
+        const size_t written = Base::base64_encode_into(data.data(), data.size(), encoded.data());
+        CHECK(written == expected.size());
+        CHECK(encoded == expected);
+
+        std::vector<char> decoded;
+        CHECK(Base::base64_decode_into(encoded.data(), encoded.size(), decoded));
+        CHECK(decoded.size() == data.size());
+        CHECK(std::equal(decoded.begin(), decoded.end(), data.begin(), data.end(),
+            [](char a, uint8_t b) { return static_cast<uint8_t>(a) == b; }));
+    }
+}
+
+int main() {
+    std::printf("base64 implementation: %s\n", Base::base64_implementation());
+    std::mt19937 random(42);
+
+    for (size_t length = 0; length <= 200; ++length) {
+        checkRoundTrip(randomBytes(random, length));
+    }
+    checkRoundTrip(randomBytes(random, 48000 * 2)); // One second of 16-bit audio at 48 kHz
+
+    // Every byte value in every position of a triplet
+    std::vector<uint8_t> all(256 * 3);
+    for (size_t i = 0; i < all.size(); ++i) {
+        all[i] = static_cast<uint8_t>(i / 3);
+    }
+    checkRoundTrip(all);
+
+    // The std::string overload resizes in place
+    std::string out;
+    out.reserve(1024);
+    const char* storage = out.data();
+    const std::vector<uint8_t> data = randomBytes(random, 300);
+    Base::base64_encode_into(data.data(), data.size(), out);
+    CHECK(out == referenceEncode(data));
+    CHECK(out.data() == storage);
+
+    // Malformed input is rejected
+    std::vector<char> decoded;
+    CHECK(!Base::base64_decode_into("abc", 3, decoded));
+    CHECK(!Base::base64_decode_into("ab!d", 4, decoded));
+    CHECK(!Base::base64_decode_into("a===", 4, decoded));
+
+    return Tests::report("test_base64");
+}
@@ -0,0 +1,126 @@
+/**
+ * @file test_cancellation.cpp
+ * @author lc
+ * @brief Cancellation token semantics and how quickly a cancel reaches blocked pipeline stages
+ *
+ * @version 0.1
+ * @date 2024-07-01
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "check.h"
+
+#include "base/boundedqueue.h"
+#include "base/cancellation.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace XPlaneChatBot;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief Generous bound for a wake-up on a loaded CI machine; a cancel normally lands in microseconds
+    constexpr std::chrono::milliseconds kMaxCancelLatency{ 100 };
+
+    /// @brief Block a thread in wait, cancel the token, and measure until the thread is released
+    template <typename Wait>
+    Clock::duration cancelLatency(Base::CancellationToken& token, Wait wait) {
+        std::atomic<bool> waiting{ false };
+        std::atomic<long long> releasedAt{ 0 };
+        std::thread worker([&] {
+            waiting = true;
+            wait();
+            releasedAt = Clock::now().time_since_epoch().count();
+        });
+        while (!waiting) {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20)); // Let it block
+        const Clock::time_point cancelledAt = Clock::now();
+        token.cancel();
+        worker.join();
+        return Clock::duration(releasedAt.load()) - cancelledAt.time_since_epoch();
+    }
+}
+
+int main() {
+    // Callbacks run once, on the cancelling thread; late registrations run right away
+    {
+        Base::CancellationToken token;
+        int calls = 0;
+        token.onCancel([&calls] { ++calls; });
+        token.onCancel([&calls] { ++calls; });
+        CHECK(!token.isCancelled());
+        CHECK(calls == 0);
+        token.cancel();
+        token.cancel();
+        CHECK(token.isCancelled());
+        CHECK(calls == 2);
+        token.onCancel([&calls] { ++calls; });
+        CHECK(calls == 3);
+    }
+
+    // A null token never cancels
+    CHECK(!Base::isCancelled(nullptr));
+    auto shared = std::make_shared<Base::CancellationToken>();
+    CHECK(!Base::isCancelled(shared));
+    shared->cancel();
+    CHECK(Base::isCancelled(shared));
+
+    // Racing cancels run the callbacks exactly once
+    for (int round = 0; round < 100; ++round) {
+        Base::CancellationToken token;
+        std::atomic<int> calls{ 0 };
+        token.onCancel([&calls] { ++calls; });
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; ++i) {
+            threads.emplace_back([&token] { token.cancel(); });
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+        CHECK(calls == 1);
+    }
+
+    // A stage waiting for input is released by the cancel
+    {
+        Base::CancellationToken token;
+        Base::BoundedQueue<int> queue(4);
+        token.onCancel([&queue] { queue.close(); });
+        bool drained = false;
+        const Clock::duration latency = cancelLatency(token, [&] { drained = !queue.pop().has_value(); });
+        CHECK(drained);
+        CHECK(latency < kMaxCancelLatency);
+    }
+
+    // So is a stage blocked on a full queue (back-pressure)
+    {
+        Base::CancellationToken token;
+        Base::BoundedQueue<int> queue(1);
+        queue.push(1);
+        token.onCancel([&queue] { queue.close(); });
+        bool rejected = false;
+        const Clock::duration latency = cancelLatency(token, [&] { rejected = !queue.push(2); });
+        CHECK(rejected);
+        CHECK(latency < kMaxCancelLatency);
+    }
+
+    // A worker polling between units of work stops within one unit
+    {
+        Base::CancellationToken token;
+        const Clock::duration latency = cancelLatency(token, [&] {
+            while (!token.isCancelled()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+        CHECK(latency < kMaxCancelLatency);
+    }
+
+    return Tests::report("test_cancellation");
+}
@@ -0,0 +1,129 @@
+/**
+ * @file test_chatstreamparser.cpp
+ * @author zah
+ * @brief Content deltas of a streamed chat completion, for any split of the bytes and either line ending
+ *
+ * @version 0.1
+ * @date 2024-07-01
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "check.h"
+
+#include "chatbot/ChatStreamParser.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace XPlaneChatBot;
+
+namespace {
+    std::string event(const std::string& json, const char* newline = "\n") {
+        return "data: " + json + newline + newline;
+    }
+
+    std::string delta(const std::string& content) {
+        return R"({"id":"chatcmpl-1","object":"chat.completion.chunk","choices":[{"index":0,"delta":{"content":")" + content
+            + R"("},"finish_reason":null}]})";
+    }
+
+    const std::string kFinish = R"({"id":"chatcmpl-1","object":"chat.completion.chunk","choices":[{"index":0,"delta":{},"finish_reason":"stop"}]})";
+
+    struct Result {
+        std::vector<std::string> deltas;
+        bool finished{ false };
+        Chat::StreamParserStats stats;
+    };
+
+    /// @brief Feed the stream in pieces of step bytes
+    Result parse(std::string_view stream, size_t step) {
+        Chat::ChatStreamParser parser;
+        Result result;
+        for (size_t i = 0; i < stream.size(); i += step) {
+            result.finished = parser.feed(stream.substr(i, step), [&result](std::string_view text) {
+                result.deltas.emplace_back(text);
+            });
+        }
+        result.stats = parser.getStats();
+        return result;
+    }
+
+    std::vector<std::string> joined(const std::vector<std::string>& deltas) {
+        std::string text;
+        for (const std::string& piece : deltas) {
+            text += piece;
+        }
+        return { text };
+    }
+}
+
+int main() {
+    const std::vector<std::string> expected = { "Cleared", " to land", ", runway \"28R\".\nWind calm", " caf\xc3\xa9" };
+    for (const char* newline : { "\n", "\r\n" }) {
+        const std::string stream = ": keep-alive" + std::string(newline) + newline
+            + event(delta("Cleared"), newline)
+            + event(delta(" to land"), newline)
+            + event(delta(R"(, runway \"28R\".\nWind calm)"), newline)
+            + event(delta(R"( café)"), newline)
+            + event(kFinish, newline)
+            + event("[DONE]", newline);
+
+        // Every split point, including inside "\r\n" and inside escapes, gives the same deltas
+        for (size_t step : { size_t(1), size_t(2), size_t(3), size_t(5), size_t(17), stream.size() }) {
+            const Result result = parse(stream, step);
+            CHECK(result.deltas == expected);
+            CHECK(result.finished);
+            CHECK(result.stats.events == 5); // [DONE] after finish_reason is not parsed
+            CHECK(result.stats.bytes == stream.size());
+        }
+
+        // Events that arrive whole are parsed in place, without buffering
+        CHECK(parse(stream, stream.size()).stats.bufferedBytes == 0);
+    }
+
+    // Mixed line endings within one stream
+    {
+        const std::string stream = "data: " + delta("one") + "\r\n\r\n" + "data: " + delta(" two") + "\n\n" + "data: [DONE]\r\n\r\n";
+        const Result result = parse(stream, 1);
+        CHECK(result.deltas == (std::vector<std::string>{ "one", " two" }));
+        CHECK(result.finished);
+    }
+
+    // A data field split over several lines is joined with newlines before parsing
+    {
+        const std::string stream = "data: {\"choices\":[{\"index\":0,\n" "data: \"delta\":{\"content\":\"Hi\"}}]}\n\n";
+        const Result result = parse(stream, 1);
+        CHECK(joined(result.deltas) == std::vector<std::string>{ "Hi" });
+    }
+
+    // The scanner does not depend on the key order
+    {
+        const std::string reordered = R"({"choices":[{"finish_reason":null,"delta":{"role":"assistant","content":"Hello"},"index":0}]})";
+        const Result result = parse(event(reordered), 4);
+        CHECK(result.deltas == std::vector<std::string>{ "Hello" });
+        CHECK(result.stats.fallbacks == 0);
+    }
+
+    // Several choices fall back to the JSON parser, which delivers all of them
+    {
+        const std::string choices = R"({"choices":[{"index":0,"delta":{"content":"A"}},{"index":1,"delta":{"content":"B"}}]})";
+        const Result result = parse(event(choices) + event("[DONE]"), 4);
+        CHECK(result.deltas == (std::vector<std::string>{ "A", "B" }));
+        CHECK(result.stats.fallbacks == 1);
+        CHECK(result.finished);
+    }
+
+    // finish_reason ends the completion without [DONE]
+    {
+        const Result result = parse(event(delta("Roger")) + event(kFinish), 1);
+        CHECK(result.deltas == std::vector<std::string>{ "Roger" });
+        CHECK(result.finished);
+    }
+
+    // An unfinished stream is not finished
+    CHECK(!parse(event(delta("Roger")) + "data: " + delta(" wil"), 1).finished);
+
+    return Tests::report("test_chatstreamparser");
+}
@@ -0,0 +1,126 @@
+/**
+ * @file test_resampler.cpp
+ * @author lc
+ * @brief The polyphase resampler gives the same stream however the input is split into blocks
+ *
+ * @version 0.1
+ * @date 2024-07-01
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "check.h"
+
+#include "base/resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace XPlaneChatBot;
+
+namespace {
+    constexpr double kPi = 3.14159265358979323846;
+
+    std::vector<float> tone(int rate, double frequency, size_t count) {
+        std::vector<float> samples(count);
+        for (size_t i = 0; i < count; ++i) {
+            samples[i] = static_cast<float>(0.5 * std::sin(2.0 * kPi * frequency * static_cast<double>(i) / rate));
+        }
+        return samples;
+    }
+
+    template <typename T>
+    std::vector<T> resample(Base::PolyphaseResampler& resampler, const std::vector<T>& in, const std::vector<size_t>& blocks) {
+        std::vector<T> out;
+        size_t offset = 0;
+        for (size_t i = 0; offset < in.size(); ++i) {
+            const size_t count = std::min(blocks[i % blocks.size()], in.size() - offset);
+            std::vector<T> block(resampler.maxOutput(count));
+            const size_t produced = resampler.process(in.data() + offset, count, block.data());
+            CHECK(produced <= block.size());
+            out.insert(out.end(), block.begin(), block.begin() + produced);
+            offset += count;
+        }
+        return out;
+    }
+
+    /// @brief RMS of a signal, skipping the filter's start-up transient
+    double rms(const std::vector<float>& samples, size_t skip) {
+        double sum = 0.0;
+        for (size_t i = skip; i < samples.size(); ++i) {
+            sum += static_cast<double>(samples[i]) * samples[i];
+        }
+        return std::sqrt(sum / static_cast<double>(samples.size() - skip));
+    }
+
+    void checkRates(int inputRate, int outputRate, std::mt19937& random) {
+        const size_t count = static_cast<size_t>(inputRate); // One second
+        const std::vector<float> input = tone(inputRate, 1000.0, count);
+
+        Base::PolyphaseResampler whole(inputRate, outputRate);
+        const std::vector<float> reference = resample(whole, input, { count });
+
+        // Output length follows the rate ratio
+        const double expected = static_cast<double>(count) * outputRate / inputRate;
+        CHECK(std::abs(static_cast<double>(reference.size()) - expected) <= 1.0);
+
+        // A 1 kHz tone is in the passband: its level survives (0.5 amplitude is 0.354 RMS)
+        CHECK(std::abs(rms(reference, reference.size() / 10) - 0.3536) < 0.01);
+
+        // Random block sizes, including empty and single-sample blocks, give the same samples
+        std::uniform_int_distribution<size_t> blockSize(0, 700);
+        std::vector<size_t> blocks(64);
+        for (size_t& block : blocks) {
+            block = blockSize(random);
+        }
+        blocks[0] = 1;
+        blocks[1] = 0;
+        Base::PolyphaseResampler split(inputRate, outputRate);
+        const std::vector<float> output = resample(split, input, blocks);
+        CHECK(output.size() == reference.size());
+        float maxError = 0.0f;
+        for (size_t i = 0; i < std::min(output.size(), reference.size()); ++i) {
+            maxError = std::max(maxError, std::abs(output[i] - reference[i]));
+        }
+        CHECK(maxError < 1e-6f);
+
+        // reset() starts an identical stream
+        split.reset();
+        CHECK(resample(split, input, { count }) == reference);
+
+        // The int16 path matches the float path to within rounding
+        std::vector<int16_t> pcm(count);
+        for (size_t i = 0; i < count; ++i) {
+            pcm[i] = static_cast<int16_t>(std::lround(input[i] * 32767.0f));
+        }
+        Base::PolyphaseResampler pcmResampler(inputRate, outputRate);
+        const std::vector<int16_t> pcmOutput = resample(pcmResampler, pcm, { 160, 333, 1 });
+        CHECK(pcmOutput.size() == reference.size());
+        int maxPcmError = 0;
+        for (size_t i = 0; i < std::min(pcmOutput.size(), reference.size()); ++i) {
+            maxPcmError = std::max(maxPcmError, std::abs(pcmOutput[i] - static_cast<int>(std::lround(reference[i] * 32767.0f))));
+        }
+        CHECK(maxPcmError <= 2);
+    }
+}
+
+int main() {
+    std::mt19937 random(7);
+    checkRates(48000, 16000, random);
+    checkRates(44100, 16000, random);
+    checkRates(16000, 48000, random);
+    checkRates(16000, 44100, random);
+    checkRates(24000, 48000, random);
+
+    // Equal rates only copy
+    Base::PolyphaseResampler passthrough(16000, 16000);
+    CHECK(passthrough.isPassthrough());
+    const std::vector<float> input = tone(16000, 440.0, 1000);
+    Base::PolyphaseResampler copy(16000, 16000);
+    CHECK(resample(copy, input, { 100, 7 }) == input);
+
+    return Tests::report("test_resampler");
+}
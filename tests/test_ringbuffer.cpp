@@ -0,0 +1,105 @@
+/**
+ * @file test_ringbuffer.cpp
+ * @author lc
+ * @brief Single-producer/single-consumer ring buffer: wrap-around, partial transfers and a threaded stream
+ *
+ * @version 0.1
+ * @date 2024-07-01
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "check.h"
+
+#include "base/ringbuffer.h"
+
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace XPlaneChatBot;
+
+int main() {
+    // Capacity is rounded up to a power of two; transfers are clipped to what fits or what is queued
+    {
+        Base::SpscRingBuffer<float> ring(100);
+        CHECK(ring.capacity() == 128);
+        CHECK(ring.empty());
+
+        std::vector<float> in(200);
+        for (size_t i = 0; i < in.size(); ++i) {
+            in[i] = static_cast<float>(i);
+        }
+        CHECK(ring.write(in.data(), 200) == 128);
+        CHECK(ring.freeSpace() == 0);
+
+        std::vector<float> out(200);
+        CHECK(ring.read(out.data(), 100) == 100);
+        CHECK(ring.size() == 28);
+
+        // This write wraps around the end of the storage
+        CHECK(ring.write(in.data() + 128, 72) == 72);
+        CHECK(ring.read(out.data() + 100, 200) == 100);
+        CHECK(out == in);
+        CHECK(ring.empty());
+    }
+
+    // Single elements are moved in and out; discard() drops everything queued
+    {
+        Base::SpscRingBuffer<std::unique_ptr<int>> ring(2);
+        CHECK(ring.push(std::make_unique<int>(1)));
+        CHECK(ring.push(std::make_unique<int>(2)));
+        CHECK(!ring.push(std::make_unique<int>(3)));
+        std::unique_ptr<int> value;
+        CHECK(ring.pop(value) && *value == 1);
+        ring.discard();
+        CHECK(ring.empty());
+        CHECK(!ring.pop(value));
+    }
+
+    // A producer and a consumer thread stream a sequence through a small ring without losing or reordering it
+    {
+        constexpr size_t kCount = 1 << 18;
+        Base::SpscRingBuffer<uint32_t> ring(256);
+        std::thread producer([&ring] {
+            uint32_t block[61];
+            uint32_t next = 0;
+            while (next < kCount) {
+                size_t count = 0;
+                while (count < 61 && next + count < kCount) {
+                    block[count] = next + static_cast<uint32_t>(count);
+                    ++count;
+                }
+                size_t written = 0;
+                while (written < count) {
+                    const size_t accepted = ring.write(block + written, count - written);
+                    if (accepted == 0) {
+                        std::this_thread::yield(); // Full
+                    }
+                    written += accepted;
+                }
+                next += static_cast<uint32_t>(count);
+            }
+        });
+
+        uint32_t expected = 0;
+        bool ordered = true;
+        uint32_t block[97];
+        while (expected < kCount) {
+            const size_t read = ring.read(block, 97);
+            if (read == 0) {
+                std::this_thread::yield(); // Empty
+            }
+            for (size_t i = 0; i < read; ++i) {
+                ordered = ordered && block[i] == expected;
+                ++expected;
+            }
+        }
+        producer.join();
+        CHECK(ordered);
+        CHECK(ring.empty());
+    }
+
+    return Tests::report("test_ringbuffer");
+}
@@ -0,0 +1,92 @@
+/**
+ * @file test_sentencesegmenter.cpp
+ * @author zah
+ * @brief Chunks cut by the sentence segmenter, fed in any split of the streamed text
+ *
+ * @version 0.1
+ * @date 2024-07-01
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "check.h"
+
+#include "chatbot/SentenceSegmenter.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace XPlaneChatBot;
+
+namespace {
+    /// @brief Stream text in pieces of step bytes, then flush
+    std::vector<std::string> segment(std::string_view text, size_t step) {
+        Chat::SentenceSegmenter segmenter;
+        std::vector<std::string> chunks;
+        for (size_t i = 0; i < text.size(); i += step) {
+            segmenter.feed(text.substr(i, step), chunks);
+        }
+        std::string tail;
+        if (segmenter.flush(tail)) {
+            chunks.push_back(tail);
+        }
+        return chunks;
+    }
+
+    /// @brief Bytes that had to be streamed before the first chunk was emitted (0 if only the flush emitted it)
+    size_t firstChunkAfter(std::string_view text) {
+        Chat::SentenceSegmenter segmenter;
+        std::vector<std::string> chunks;
+        for (size_t i = 0; i < text.size(); ++i) {
+            segmenter.feed(text.substr(i, 1), chunks);
+            if (!chunks.empty()) {
+                return i + 1;
+            }
+        }
+        return 0;
+    }
+
+    using Chunks = std::vector<std::string>;
+}
+
+int main() {
+    // The split of the stream does not matter; decimals, frequencies and abbreviations are not cut
+    const std::string reply = "Sure, I can help with that. Set the altimeter to 29.92 inches and climb to 3.5 thousand feet. "
+        "Then contact approach on 119.1, e.g. when you pass the VOR. After that, we will turn left heading two seven zero, "
+        "descend to four thousand, and expect the ILS approach for runway two eight right. Good luck!";
+    const Chunks expected = {
+        "Sure, I can help with that.",
+        "Set the altimeter to 29.92 inches and climb to 3.5 thousand feet.",
+        "Then contact approach on 119.1, e.g. when you pass the VOR. After that, we will turn left heading two seven zero, "
+            "descend to four thousand, and expect the ILS approach for runway two eight right.",
+        "Good luck!",
+    };
+    for (size_t step : { size_t(1), size_t(2), size_t(7), size_t(64), reply.size() }) {
+        CHECK(segment(reply, step) == expected);
+    }
+
+    // "No." ends a sentence on its own but not before a number
+    CHECK(segment("No. Keep the nose up. Watch the No. 2 engine and Nos. 3 and 4.", 1)
+        == (Chunks{ "No.", "Keep the nose up. Watch the No. 2 engine and Nos. 3 and 4." }));
+
+    // The first chunk is cut early: at a clause boundary once it has enough words, or at a word past the maximum
+    CHECK(segment("When you reach the final approach fix, lower the gear and set flaps thirty. Done.", 1)
+        == (Chunks{ "When you reach the final approach fix,", "lower the gear and set flaps thirty. Done." }));
+    CHECK(segment("one two three four five six seven eight nine ten eleven twelve thirteen fourteen fifteen sixteen seventeen eighteen", 1)
+        == (Chunks{ "one two three four five six seven eight nine ten eleven twelve thirteen fourteen fifteen sixteen", "seventeen eighteen" }));
+
+    // A sentence is emitted as soon as the next character confirms its end, not at the end of the stream
+    CHECK(firstChunkAfter("Roger. Climb now.") == 8);
+    CHECK(firstChunkAfter("Sure, I can help with that. Set") == 29);
+
+    // Later chunks merge short sentences
+    CHECK(segment("Roger. Climb now. Turn left. Hold short. Contact tower. Cleared to land. Wind calm.", 1)
+        == (Chunks{ "Roger.", "Climb now. Turn left. Hold short. Contact tower. Cleared to land.", "Wind calm." }));
+
+    // Whitespace only is not a chunk
+    CHECK(segment("   ", 1).empty());
+    CHECK(segment("Yes.", 1) == Chunks{ "Yes." });
+
+    return Tests::report("test_sentencesegmenter");
+}
@@ -0,0 +1,154 @@
+/**
+ * @file test_turnendpointer.cpp
+ * @author zah
+ * @brief Scripted sessions replayed through the turn endpointer on a synthetic clock
+ *
+ * @version 0.1
+ * @date 2024-07-01
+ *
+ * @copyright Copyright (c) 2024
+ *
+ */
+#include "check.h"
+
+#include "chatbot/TurnEndpointer.h"
+
+#include <string>
+
+using namespace XPlaneChatBot;
+
+namespace {
+    using Clock = Chat::TurnEndpointer::Clock;
+    using std::chrono::milliseconds;
+
+    const Clock::time_point kStart = Clock::time_point{} + std::chrono::hours(1);
+
+    Clock::time_point at(int ms) { return kStart + milliseconds(ms); }
+
+    /// @brief Poll the endpointer every 10 ms like the sender thread does; time of the end of turn, -1 if it never ends
+    int endOfTurnMs(Chat::TurnEndpointer& endpointer, int fromMs, int untilMs = 60000) {
+        for (int ms = fromMs; ms <= untilMs; ms += 10) {
+            if (endpointer.shouldEndTurn(at(ms))) {
+                return ms;
+            }
+        }
+        return -1;
+    }
+
+    /// @brief One utterance: speech from startMs to endMs, finalized as text when the speech ends
+    int replayUtterance(Chat::TurnEndpointer& endpointer, int startMs, int endMs, const std::string& text) {
+        endpointer.beginTurn(at(startMs));
+        endpointer.onSpeechStart(at(startMs));
+        endpointer.onPartial(text, at(endMs - 100));
+        endpointer.onSpeechEnd(at(endMs));
+        endpointer.onFinal(text, at(endMs + 50));
+        return endOfTurnMs(endpointer, endMs);
+    }
+
+    bool near(int actual, int expected) { return actual >= expected && actual <= expected + 10; }
+}
+
+int main() {
+    // Before any pauses are known the initial silence applies, scaled by the phrasing
+    {
+        Chat::TurnEndpointer endpointer;
+        CHECK(near(replayUtterance(endpointer, 0, 1000, "climb to flight level one two zero"), 1800));
+        CHECK(near(replayUtterance(endpointer, 5000, 6000, "what is our fuel state?"), 6480));
+        CHECK(near(replayUtterance(endpointer, 10000, 11000, "set the flaps and"), 12440));
+        CHECK(near(replayUtterance(endpointer, 15000, 16000, "you have control"), 16400));
+        CHECK(endpointer.getStats().turnsEnded == 4);
+    }
+
+    // Nothing ends a turn that has no transcript
+    {
+        Chat::TurnEndpointer endpointer;
+        endpointer.beginTurn(at(0));
+        endpointer.onSpeechStart(at(0));
+        endpointer.onSpeechEnd(at(500));
+        CHECK(endOfTurnMs(endpointer, 500, 10000) == -1);
+    }
+
+    // A changing partial is waited on even after the speech ended
+    {
+        Chat::TurnEndpointer endpointer;
+        endpointer.beginTurn(at(0));
+        endpointer.onSpeechStart(at(0));
+        endpointer.onPartial("turn left", at(700));
+        endpointer.onSpeechEnd(at(1000));
+        endpointer.onPartial("turn left heading", at(1700));
+        CHECK(endOfTurnMs(endpointer, 1000) >= 2000);
+    }
+
+    // The threshold adapts to the speaker's own pauses
+    {
+        Chat::TurnEndpointer endpointer;
+        endpointer.beginTurn(at(0));
+        int t = 0;
+        for (int i = 0; i < 8; ++i) {
+            endpointer.onSpeechStart(at(t));
+            endpointer.onSpeechEnd(at(t + 600));
+            t += 800; // 200 ms pauses
+        }
+        CHECK(endpointer.getStats().requiredSilenceMs == 350);
+        endpointer.onFinal("request vectors for the ils", at(t));
+        CHECK(near(endOfTurnMs(endpointer, t), t - 200 + 350));
+    }
+
+    // Speech after the end of a turn is a false cut-off and raises the threshold
+    {
+        Chat::TurnEndpointer endpointer;
+        CHECK(near(replayUtterance(endpointer, 0, 1000, "climb to flight level one two zero"), 1800));
+        endpointer.onSpeechStart(at(1900));
+        endpointer.onSpeechStart(at(2000)); // Counted once per turn
+        CHECK(endpointer.getStats().falseCutoffs == 1);
+        CHECK(endpointer.getStats().requiredSilenceMs == 950);
+        CHECK(near(replayUtterance(endpointer, 5000, 6000, "then descend to eight thousand"), 6950));
+    }
+
+    // The expected final of words pending at the end is not a false cut-off
+    {
+        Chat::TurnEndpointer endpointer;
+        endpointer.beginTurn(at(0));
+        endpointer.onSpeechStart(at(0));
+        endpointer.onPartial("contact departure", at(900));
+        endpointer.onSpeechEnd(at(1000));
+        CHECK(near(endOfTurnMs(endpointer, 1000), 1800));
+        endpointer.onFinal("contact departure", at(1900));
+        CHECK(endpointer.getStats().falseCutoffs == 0);
+    }
+
+    // Consecutive finals are separate words: "hand" + "over" ends with the closing phrase "over"
+    {
+        Chat::TurnEndpointer endpointer;
+        endpointer.beginTurn(at(0));
+        endpointer.onSpeechStart(at(0));
+        endpointer.onFinal("hand", at(400));
+        endpointer.onFinal("over", at(900));
+        endpointer.onSpeechEnd(at(1000));
+        CHECK(near(endOfTurnMs(endpointer, 1000), 1400));
+    }
+
+    // A detector held in speech by noise: the turn ends once the text goes stale, or after the maximum turn length
+    {
+        Chat::TurnEndpointer endpointer;
+        endpointer.beginTurn(at(0));
+        endpointer.onSpeechStart(at(0));
+        endpointer.onPartial("say again", at(500));
+        CHECK(near(endOfTurnMs(endpointer, 0), 3500));
+        CHECK(endpointer.getStats().forcedEnds == 1);
+
+        endpointer.beginTurn(at(10000));
+        endpointer.onSpeechStart(at(10000));
+        int t = 10000;
+        int ended = -1;
+        while (ended < 0 && t < 60000) {
+            endpointer.onPartial("word " + std::to_string(t), at(t));
+            t += 1000;
+            ended = endOfTurnMs(endpointer, t - 1000, t - 10);
+        }
+        CHECK(near(ended, 40000));
+        CHECK(endpointer.getStats().forcedEnds == 2);
+    }
+
+    return Tests::report("test_turnendpointer");
+}